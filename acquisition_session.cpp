@@ -0,0 +1,328 @@
+#include "acquisition_session.hpp"
+#include "working_common.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <future>
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+using json = nlohmann::json;
+
+namespace {
+
+// Time without new data after which a channel's last sub-acquisition is considered delivered
+constexpr double SETTLE_SECONDS = 0.5;
+// After REC:STOP every active channel delivers the interrupted sub-acquisition; a short quiet
+// period then confirms nothing else is in flight
+constexpr auto QUIET_PERIOD = std::chrono::milliseconds(20);
+// How long to rely on the streams alone before also asking DLT
+constexpr auto STREAM_WAIT = std::chrono::seconds(2);
+// Fallback DLT status polling interval: doubles from the first to the last value
+constexpr auto FIRST_POLL_INTERVAL = std::chrono::milliseconds(10);
+constexpr auto MAX_POLL_INTERVAL = std::chrono::milliseconds(500);
+
+double seconds_since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Ask DLT to stream `channel` to `stream_port`, over a connection of the calling thread's own
+// (REQ sockets must not be shared between threads). Returns the acquisition id.
+std::string start_dlt_stream(const std::string& tc_address, int channel, int stream_port) {
+    zmq::socket_t dlt = connect_zmq("localhost", DLT_PORT);
+    json response = dlt_exec(dlt, "start-stream --address " + tc_address +
+                                  " --channel " + std::to_string(channel) +
+                                  " --stream-port " + std::to_string(stream_port));
+    return response.contains("id") ? response["id"].get<std::string>() : std::string();
+}
+
+} // namespace
+
+AcquisitionSession::AcquisitionSession(zmq::socket_t& tc_socket, const AcquisitionSessionConfig& config)
+    : tc(tc_socket), settings(config), opened(false), files(0)
+{
+}
+
+AcquisitionSession::~AcquisitionSession() {
+    try {
+        close();
+    } catch (...) {
+        // Destructors must not throw; an explicit close() reports errors
+    }
+}
+
+void AcquisitionSession::open() {
+    if (opened) {
+        return;
+    }
+    try {
+        auto phase_start = std::chrono::steady_clock::now();
+        dlt = dlt_connect(settings.output_dir);
+
+        // Close any prior acquisitions (clean slate)
+        close_active_acquisitions(dlt);
+        double cleanup_seconds = seconds_since(phase_start);
+
+        // Configure the Time Controller for the whole session in a single SCPI round trip: no external
+        // timestamp reference on each channel (needed for merging), the recording settings, and
+        // cleared error counters
+        ScpiBatch setup(tc);
+        for (int ch : settings.channels) {
+            setup.add("RAW" + std::to_string(ch) + ":REF:LINK NONE");
+        }
+        setup.add("REC:TRIG:ARM:MODE MANUal")  // manual trigger mode
+             .add("REC:ENABle ON")             // enable the Record generator
+             .add("REC:STOP")                  // ensure no acquisition is currently running
+             .add("REC:NUM " + settings.record_count)
+             .add("REC:PWID " + std::to_string(settings.pwid_ps) + ";PPER " + std::to_string(settings.pper_ps));
+        for (int ch : settings.channels) {
+            setup.add("RAW" + std::to_string(ch) + ":ERRORS:CLEAR");  // reset error counter on channel
+        }
+        setup.execute();
+
+        // Start a stream client per channel; they only bind and wait for DLT to connect
+        phase_start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < settings.channels.size(); ++i) {
+            int ch = settings.channels[i];
+            StreamOptions options = settings.stream_options;
+            options.placement.fifo_priority = settings.receivers.fifo_priority;
+            if (!settings.receivers.cpus.empty()) {
+                options.placement.cpus = {settings.receivers.cpus[i % settings.receivers.cpus.size()]};
+            }
+            BufferStreamClient* client = new BufferStreamClient(ch, options);
+            clients.push_back(client);
+            client->set_activity_signal(&activity);
+            client->start();
+        }
+        double clients_seconds = seconds_since(phase_start);
+
+        // Open a streamed acquisition per channel, all channels at once; they stay open until close()
+        phase_start = std::chrono::steady_clock::now();
+        std::vector<std::future<std::string>> stream_ids;
+        for (size_t i = 0; i < settings.channels.size(); ++i) {
+            stream_ids.push_back(std::async(std::launch::async, start_dlt_stream,
+                                            settings.tc_address, settings.channels[i], clients[i]->port));
+        }
+        std::exception_ptr stream_error;
+        for (size_t i = 0; i < stream_ids.size(); ++i) {
+            try {
+                std::string id = stream_ids[i].get();
+                if (!id.empty()) {
+                    acquisitions_id[settings.channels[i]] = id;
+                }
+            } catch (...) {
+                // Keep collecting so that close() stops the streams that did start
+                if (!stream_error) {
+                    stream_error = std::current_exception();
+                }
+            }
+        }
+        if (stream_error) {
+            std::rethrow_exception(stream_error);
+        }
+        double streams_seconds = seconds_since(phase_start);
+
+        // Tell the Time Controller to send timestamps from every channel
+        ScpiBatch send_on(tc);
+        for (int ch : settings.channels) {
+            send_on.add("RAW" + std::to_string(ch) + ":SEND ON");
+        }
+        send_on.execute();
+
+        std::ostringstream report;
+        report.setf(std::ios::fixed);
+        report.precision(1);
+        report << "Acquisition session opened for " << settings.channels.size() << " channels:"
+               << " DLT cleanup " << cleanup_seconds * 1e3 << " ms,"
+               << " TC setup " << setup.seconds() * 1e3 << " ms,"
+               << " stream clients " << clients_seconds * 1e3 << " ms,"
+               << " DLT streams " << streams_seconds * 1e3 << " ms,"
+               << " SEND ON " << send_on.seconds() * 1e3 << " ms";
+        std::cout << report.str() << std::endl;
+        opened = true;
+        files = 0;
+    } catch (...) {
+        opened = true;  // let close() release whatever was set up
+        try {
+            close();
+        } catch (...) {
+        }
+        throw;
+    }
+}
+
+std::map<int, int> AcquisitionSession::sub_acquisition_counts() {
+    std::map<int, int> counts;
+    for (const auto& [ch, id] : acquisitions_id) {
+        json status = dlt_exec(dlt, "status --id " + id);
+        counts[ch] = status.contains("acquisitions_count") ? status["acquisitions_count"].get<int>() : 0;
+    }
+    return counts;
+}
+
+uint64_t AcquisitionSession::stream_activity() const {
+    uint64_t total = 0;
+    for (BufferStreamClient* client : clients) {
+        total += client->messages() + (client->stream_ended() ? 1 : 0);
+    }
+    return total;
+}
+
+bool AcquisitionSession::streams_complete(std::chrono::steady_clock::time_point stop_time) const {
+    // A numeric REC:NUM gives the exact number of sub-acquisitions per file. Free-running
+    // (REC:NUM INF), the file holds every sub-acquisition started between REC:PLAY and REC:STOP,
+    // the interrupted one included: at least ceil((stop - play) / period) of them, as play_time is
+    // taken after the Time Controller started and stop_time before it stopped.
+    uint64_t expected = 0;
+    const bool free_running =
+        settings.record_count.find_first_not_of("0123456789") != std::string::npos || settings.record_count.empty();
+    if (!free_running) {
+        expected = std::stoull(settings.record_count);
+    } else if (settings.pper_ps > 0) {
+        double periods = std::chrono::duration<double, std::pico>(stop_time - play_time).count() / settings.pper_ps;
+        expected = static_cast<uint64_t>(std::max(1.0, std::ceil(periods)));
+    }
+    // A channel has delivered the file's last sub-acquisition once it has received that many, the
+    // last one after REC:STOP when free-running. Channels that saw no events in some
+    // sub-acquisitions send fewer; they are done once the sub-acquisition window has passed since
+    // the first channel delivered the last one.
+    auto now = std::chrono::steady_clock::now();
+    bool pending = false;
+    bool delivered_any = false;
+    std::chrono::steady_clock::time_point first_delivery;
+    for (size_t i = 0; i < clients.size(); ++i) {
+        const BufferStreamClient* client = clients[i];
+        if (client->stream_ended()) {
+            continue;  // DLT ended the stream; nothing more will come
+        }
+        uint64_t received = client->messages() - (i < messages_at_play.size() ? messages_at_play[i] : 0);
+        auto last = client->last_message_time();
+        bool delivered = received >= std::max<uint64_t>(expected, 1) && (!free_running || last >= stop_time);
+        if (!delivered) {
+            pending = true;
+            continue;
+        }
+        if (free_running && now - last < QUIET_PERIOD) {
+            return false;
+        }
+        if (!delivered_any || last < first_delivery) {
+            first_delivery = last;
+        }
+        delivered_any = true;
+    }
+    return !pending || (delivered_any && now >= first_delivery + sub_acquisition_window(settings.pper_ps));
+}
+
+void AcquisitionSession::play() {
+    if (!opened) {
+        throw std::runtime_error("Acquisition session is not open");
+    }
+    // Anything still queued arrived after the previous file was merged (e.g. a sub-acquisition
+    // delivered late); it must not be merged into this one
+    for (size_t i = 0; i < clients.size(); ++i) {
+        size_t discarded = clients[i]->discard_queued();
+        if (discarded > 0) {
+            std::cerr << "[channel " << settings.channels[i] << "] discarded " << discarded
+                      << " message(s) left over from the previous file" << std::endl;
+        }
+    }
+    counts_at_play = sub_acquisition_counts();
+    messages_at_play.clear();
+    for (BufferStreamClient* client : clients) {
+        messages_at_play.push_back(client->messages());
+    }
+    zmq_exec(tc, "REC:PLAY");
+    play_time = std::chrono::steady_clock::now();
+}
+
+void AcquisitionSession::stop(double timeout_seconds) {
+    auto stop_time = std::chrono::steady_clock::now();
+    zmq_exec(tc, "REC:STOP");
+    ++files;
+    auto deadline = stop_time + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                                    std::chrono::duration<double>(timeout_seconds));
+
+    // Wait on the stream clients: every message or end of stream wakes this thread, and the quiet
+    // period is re-checked when it has elapsed
+    auto stream_deadline = std::min(deadline, stop_time + STREAM_WAIT);
+    while (!streams_complete(stop_time)) {
+        auto now = std::chrono::steady_clock::now();
+        if (now >= stream_deadline) {
+            std::cerr << "Streams did not confirm the end of the sub-acquisitions, asking DLT" << std::endl;
+            poll_dlt_until_settled(deadline);
+            return;
+        }
+        uint64_t seen = stream_activity();
+        activity.wait_until(std::min(stream_deadline, now + QUIET_PERIOD),
+                            [this, seen] { return stream_activity() != seen; });
+    }
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - stop_time).count();
+    std::cout << "All channels delivered their data " << static_cast<int>(elapsed * 1e3)
+              << " ms after REC:STOP" << std::endl;
+}
+
+void AcquisitionSession::poll_dlt_until_settled(std::chrono::steady_clock::time_point deadline) {
+    std::map<int, bool> done;
+    for (const auto& [ch, id] : acquisitions_id) {
+        done[ch] = false;
+    }
+    auto interval = std::chrono::duration_cast<std::chrono::steady_clock::duration>(FIRST_POLL_INTERVAL);
+    while (std::chrono::steady_clock::now() < deadline) {
+        if (std::all_of(done.begin(), done.end(), [](const auto& entry) { return entry.second; })) {
+            return;
+        }
+        for (const auto& [ch, id] : acquisitions_id) {
+            if (done[ch]) {
+                continue;
+            }
+            try {
+                json status = dlt_exec(dlt, "status --id " + id);
+                if (status.contains("error") && !status["error"].is_null()) {
+                    std::cerr << "[channel " << ch << "] DLT error, marking as done" << std::endl;
+                    done[ch] = true;
+                    continue;
+                }
+                int count = status.contains("acquisitions_count") ? status["acquisitions_count"].get<int>() : 0;
+                double inactivity = status.contains("inactivity") ? status["inactivity"].get<double>() : 0.0;
+                if (count > counts_at_play[ch] && inactivity > SETTLE_SECONDS) {
+                    done[ch] = true;
+                }
+            } catch (const std::exception& e) {
+                std::cerr << "[channel " << ch << "] Error getting status: " << e.what() << ", marking as done" << std::endl;
+                done[ch] = true;
+            }
+        }
+        if (std::all_of(done.begin(), done.end(), [](const auto& entry) { return entry.second; })) {
+            return;
+        }
+        std::this_thread::sleep_for(interval);
+        interval = std::min<std::chrono::steady_clock::duration>(interval * 2, MAX_POLL_INTERVAL);
+    }
+    std::cerr << "Timed out waiting for the end of the sub-acquisitions" << std::endl;
+}
+
+bool AcquisitionSession::close() {
+    if (!opened) {
+        return true;
+    }
+    opened = false;
+    bool success = true;
+    try {
+        if (!acquisitions_id.empty()) {
+            success = close_timestamps_acquisition(tc, dlt, acquisitions_id);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error closing timestamp acquisitions: " << e.what() << std::endl;
+        success = false;
+    }
+    acquisitions_id.clear();
+    for (BufferStreamClient* client : clients) {
+        client->set_activity_signal(nullptr);
+        client->join();
+        delete client;
+    }
+    clients.clear();
+    dlt.close();
+    return success;
+}
@@ -0,0 +1,92 @@
+#ifndef ACQUISITION_SESSION_HPP
+#define ACQUISITION_SESSION_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <string>
+#include <vector>
+#include <zmq.hpp>
+#include "streams.hpp"
+
+// Settings that require reopening the session when they change
+struct AcquisitionSessionConfig {
+    std::string tc_address;            // Time Controller the DLT streams from
+    std::vector<int> channels;
+    std::filesystem::path output_dir;  // DLT target folder
+    long long pwid_ps = 0;             // sub-acquisition width
+    long long pper_ps = 0;             // sub-acquisition period
+    std::string record_count = "INF";  // REC:NUM argument
+    StreamOptions stream_options;
+    ThreadPlacement receivers;         // receiver threads; with several CPUs, one per channel in turn
+
+    bool operator==(const AcquisitionSessionConfig& other) const {
+        return tc_address == other.tc_address && channels == other.channels && output_dir == other.output_dir &&
+               pwid_ps == other.pwid_ps && pper_ps == other.pper_ps && record_count == other.record_count &&
+               stream_options.ring_slots == other.stream_options.ring_slots &&
+               stream_options.zero_copy == other.stream_options.zero_copy &&
+               stream_options.memory_budget == other.stream_options.memory_budget &&
+               stream_options.process_memory_budget == other.stream_options.process_memory_budget &&
+               stream_options.spill_dir == other.stream_options.spill_dir && receivers == other.receivers;
+    }
+    bool operator!=(const AcquisitionSessionConfig& other) const { return !(*this == other); }
+};
+
+// Long-lived acquisition setup reused across files: the DataLinkTargetService connection, one
+// DLT stream and BufferStreamClient per channel, and the Time Controller's REC:* configuration.
+// Opening it costs seconds (DLT cleanup, SCPI configuration, stream start-up); each file then
+// only needs play() and stop(), with a fresh TimestampsMergerThread attached to streams().
+//
+// stop() returns as soon as the file's last sub-acquisition is in the stream clients' rings, so the
+// merger can be joined with all of the file's data. Completion is detected from the streams
+// themselves (see streams_complete()); DLT status polling is only a fallback.
+class AcquisitionSession {
+public:
+    // `tc_socket` (SCPI) must outlive the session
+    AcquisitionSession(zmq::socket_t& tc_socket, const AcquisitionSessionConfig& config);
+    ~AcquisitionSession();
+
+    AcquisitionSession(const AcquisitionSession&) = delete;
+    AcquisitionSession& operator=(const AcquisitionSession&) = delete;
+
+    // Connect to DLT, configure the Time Controller and start the streams. Throws on failure
+    // (the session is left closed).
+    void open();
+    bool is_open() const { return opened; }
+    const AcquisitionSessionConfig& config() const { return settings; }
+
+    // Start recording the next file (REC:PLAY). Messages still queued in the stream clients' rings
+    // belong to the previous file and are discarded, so call it before starting the file's merger.
+    void play();
+    // Stop recording and wait up to `timeout_seconds` for the rest of the file's data
+    void stop(double timeout_seconds);
+    // Stop the DLT streams and the stream clients; returns false if DLT or the Time Controller
+    // reported acquisition errors
+    bool close();
+
+    const std::vector<BufferStreamClient*>& streams() const { return clients; }
+    // Files recorded since open()
+    unsigned files_recorded() const { return files; }
+
+private:
+    std::map<int, int> sub_acquisition_counts();
+    // Whether every channel has delivered the file's last sub-acquisition (see stop())
+    bool streams_complete(std::chrono::steady_clock::time_point stop_time) const;
+    uint64_t stream_activity() const;
+    void poll_dlt_until_settled(std::chrono::steady_clock::time_point deadline);
+
+    zmq::socket_t& tc;
+    AcquisitionSessionConfig settings;
+    zmq::socket_t dlt;
+    std::map<int, std::string> acquisitions_id;
+    std::vector<BufferStreamClient*> clients;
+    std::map<int, int> counts_at_play;
+    std::vector<uint64_t> messages_at_play;  // per stream client
+    std::chrono::steady_clock::time_point play_time;  // when the Time Controller acknowledged REC:PLAY
+    MergeSignal activity;                    // notified by the stream clients on every message
+    bool opened;
+    unsigned files;
+};
+
+#endif // ACQUISITION_SESSION_HPP
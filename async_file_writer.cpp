@@ -0,0 +1,390 @@
+#include "async_file_writer.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#define TT_HAVE_IO_URING 1
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+
+namespace {
+
+constexpr size_t BUFFER_ALIGNMENT = 4096;
+
+// Write the whole range with pwrite(), retrying on short writes and EINTR
+void pwrite_all(int fd, const char* data, size_t size, uint64_t offset, const std::string& path) {
+    while (size > 0) {
+        ssize_t n = ::pwrite(fd, data, size, static_cast<off_t>(offset));
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            throw std::runtime_error("Failed to write file " + path + ": " + strerror(errno));
+        }
+        data += n;
+        size -= static_cast<size_t>(n);
+        offset += static_cast<uint64_t>(n);
+    }
+}
+
+} // namespace
+
+#ifdef TT_HAVE_IO_URING
+
+// Minimal io_uring submission/completion ring driven through the raw syscalls (no liburing
+// dependency). Only IORING_OP_WRITE is used; the writer thread is the only user of the ring.
+struct AsyncFileWriter::Uring {
+    int ring_fd = -1;
+    unsigned entries = 0;
+    void* sq_ptr = MAP_FAILED;
+    size_t sq_len = 0;
+    void* cq_ptr = MAP_FAILED;
+    size_t cq_len = 0;
+    io_uring_sqe* sqes = static_cast<io_uring_sqe*>(MAP_FAILED);
+    size_t sqes_len = 0;
+    unsigned* sq_tail = nullptr;
+    unsigned* sq_mask = nullptr;
+    unsigned* sq_array = nullptr;
+    unsigned* cq_head = nullptr;
+    unsigned* cq_tail = nullptr;
+    unsigned* cq_mask = nullptr;
+    io_uring_cqe* cqes = nullptr;
+
+    // Returns false when the kernel (or a seccomp policy) does not allow io_uring
+    bool init(unsigned depth) {
+        io_uring_params params;
+        memset(&params, 0, sizeof(params));
+        ring_fd = static_cast<int>(syscall(__NR_io_uring_setup, depth, &params));
+        if (ring_fd < 0) {
+            return false;
+        }
+        entries = params.sq_entries;
+        sq_len = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cq_len = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        sqes_len = params.sq_entries * sizeof(io_uring_sqe);
+
+        sq_ptr = mmap(nullptr, sq_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQ_RING);
+        cq_ptr = mmap(nullptr, cq_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_CQ_RING);
+        sqes = static_cast<io_uring_sqe*>(mmap(nullptr, sqes_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                                               ring_fd, IORING_OFF_SQES));
+        if (sq_ptr == MAP_FAILED || cq_ptr == MAP_FAILED || sqes == MAP_FAILED) {
+            return false;
+        }
+        char* sq = static_cast<char*>(sq_ptr);
+        char* cq = static_cast<char*>(cq_ptr);
+        sq_tail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        sq_mask = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        sq_array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+        cq_head = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        cq_tail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        cq_mask = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+        return true;
+    }
+
+    ~Uring() {
+        if (sqes != MAP_FAILED) munmap(sqes, sqes_len);
+        if (cq_ptr != MAP_FAILED) munmap(cq_ptr, cq_len);
+        if (sq_ptr != MAP_FAILED) munmap(sq_ptr, sq_len);
+        if (ring_fd >= 0) ::close(ring_fd);
+    }
+
+    // Queue one write; the caller never queues more than `entries` before reaping
+    void prepare_write(int fd, const char* data, size_t size, uint64_t offset, uint64_t user_data) {
+        unsigned tail = __atomic_load_n(sq_tail, __ATOMIC_RELAXED);
+        unsigned index = tail & *sq_mask;
+        io_uring_sqe& sqe = sqes[index];
+        memset(&sqe, 0, sizeof(sqe));
+        sqe.opcode = IORING_OP_WRITE;
+        sqe.fd = fd;
+        sqe.addr = reinterpret_cast<uint64_t>(data);
+        sqe.len = static_cast<uint32_t>(size);
+        sqe.off = offset;
+        sqe.user_data = user_data;
+        sq_array[index] = index;
+        __atomic_store_n(sq_tail, tail + 1, __ATOMIC_RELEASE);
+    }
+
+    // Submit `count` queued writes and block until `count` completions are available
+    void submit_and_wait(unsigned count) {
+        unsigned to_submit = count;
+        unsigned completions = 0;
+        while (to_submit > 0 || available() < count) {
+            int ret = static_cast<int>(syscall(__NR_io_uring_enter, ring_fd, to_submit, count - completions,
+                                               IORING_ENTER_GETEVENTS, nullptr, 0));
+            if (ret < 0) {
+                if (errno == EINTR) continue;
+                throw std::runtime_error(std::string("io_uring_enter failed: ") + strerror(errno));
+            }
+            to_submit -= std::min<unsigned>(to_submit, static_cast<unsigned>(ret));
+            completions = available();
+        }
+    }
+
+    unsigned available() const {
+        return __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE) - __atomic_load_n(cq_head, __ATOMIC_RELAXED);
+    }
+
+    io_uring_cqe pop_completion() {
+        unsigned head = __atomic_load_n(cq_head, __ATOMIC_RELAXED);
+        io_uring_cqe cqe = cqes[head & *cq_mask];
+        __atomic_store_n(cq_head, head + 1, __ATOMIC_RELEASE);
+        return cqe;
+    }
+};
+
+#else
+
+struct AsyncFileWriter::Uring {};
+
+#endif
+
+AsyncFileWriter::AsyncFileWriter(const std::string& path_, size_t buffer_size_, size_t buffer_count)
+    : path(path_), fd(-1), buffer_size(buffer_size_), next_offset(0), in_flight(0), stopping(false),
+      uring_enabled(false), total_bytes(0), started(false), closed(false)
+{
+    if (buffer_size == 0 || buffer_count < 2) {
+        throw std::invalid_argument("AsyncFileWriter needs a non-zero buffer size and at least two buffers");
+    }
+    buffer_size = (buffer_size + BUFFER_ALIGNMENT - 1) & ~(BUFFER_ALIGNMENT - 1);
+
+    fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        throw std::runtime_error("Cannot open output file: " + path + ": " + strerror(errno));
+    }
+    for (size_t i = 0; i < buffer_count; ++i) {
+        void* memory = nullptr;
+        if (posix_memalign(&memory, BUFFER_ALIGNMENT, buffer_size) != 0) {
+            for (char* buffer : storage) free(buffer);
+            ::close(fd);
+            throw std::bad_alloc();
+        }
+        storage.push_back(static_cast<char*>(memory));
+    }
+    free_list = storage;
+
+#ifdef TT_HAVE_IO_URING
+    uring.reset(new Uring());
+    if (uring->init(static_cast<unsigned>(buffer_count))) {
+        uring_enabled.store(true, std::memory_order_relaxed);
+    } else {
+        uring.reset();
+    }
+#endif
+
+    writer_thread = std::thread(&AsyncFileWriter::writer_loop, this);
+}
+
+AsyncFileWriter::~AsyncFileWriter() {
+    try {
+        close();
+    } catch (...) {
+        // Destructors must not throw; an explicit close() reports errors
+    }
+    for (char* buffer : storage) {
+        free(buffer);
+    }
+}
+
+void AsyncFileWriter::write(const void* data, size_t size) {
+    if (closed) {
+        throw std::logic_error("AsyncFileWriter::write after close: " + path);
+    }
+    if (!started) {
+        first_write = std::chrono::steady_clock::now();
+        started = true;
+    }
+    const char* src = static_cast<const char*>(data);
+    while (size > 0) {
+        if (!current.data) {
+            std::unique_lock<std::mutex> lock(mutex);
+            cv.wait(lock, [this] { return !free_list.empty() || !error.empty(); });
+            if (!error.empty()) {
+                throw std::runtime_error(error);
+            }
+            current.data = free_list.back();
+            free_list.pop_back();
+            current.used = 0;
+            current.offset = next_offset;
+        }
+        size_t n = std::min(size, buffer_size - current.used);
+        memcpy(current.data + current.used, src, n);
+        current.used += n;
+        next_offset += n;
+        src += n;
+        size -= n;
+        if (current.used == buffer_size) {
+            hand_off_current();
+        }
+    }
+}
+
+void AsyncFileWriter::hand_off_current() {
+    if (!current.data || current.used == 0) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        full.push_back(current);
+    }
+    cv.notify_all();
+    current = Buffer();
+}
+
+void AsyncFileWriter::flush() {
+    if (closed) {
+        return;
+    }
+    hand_off_current();
+    std::unique_lock<std::mutex> lock(mutex);
+    cv.wait(lock, [this] { return (full.empty() && in_flight == 0) || !error.empty(); });
+    if (!error.empty()) {
+        throw std::runtime_error(error);
+    }
+}
+
+void AsyncFileWriter::write_at(uint64_t offset, const void* data, size_t size) {
+    if (closed) {
+        throw std::logic_error("AsyncFileWriter::write_at after close: " + path);
+    }
+    flush();
+    pwrite_all(fd, static_cast<const char*>(data), size, offset, path);
+    next_offset = std::max(next_offset, offset + size);
+}
+
+void AsyncFileWriter::close() {
+    if (closed) {
+        return;
+    }
+    hand_off_current();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    cv.notify_all();
+    if (writer_thread.joinable()) {
+        writer_thread.join();
+    }
+    // Return a buffer still held by the caller (only possible after a failed write)
+    if (current.data) {
+        free_list.push_back(current.data);
+        current = Buffer();
+    }
+    closed = true;
+    closed_at = std::chrono::steady_clock::now();
+    int ret = ::close(fd);
+    fd = -1;
+    check_error();
+    if (ret != 0) {
+        throw std::runtime_error("Failed to close file " + path + ": " + strerror(errno));
+    }
+}
+
+void AsyncFileWriter::check_error() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!error.empty()) {
+        throw std::runtime_error(error);
+    }
+}
+
+void AsyncFileWriter::write_buffer_sync(const Buffer& buffer) {
+    pwrite_all(fd, buffer.data, buffer.used, buffer.offset, path);
+}
+
+void AsyncFileWriter::writer_loop() {
+    std::vector<Buffer> batch;
+    for (;;) {
+        batch.clear();
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            cv.wait(lock, [this] { return !full.empty() || stopping; });
+            if (full.empty()) {
+                break;  // stopping and drained
+            }
+            while (!full.empty()) {
+                batch.push_back(full.front());
+                full.pop_front();
+            }
+            in_flight = batch.size();
+        }
+
+        std::string failure;
+        try {
+#ifdef TT_HAVE_IO_URING
+            if (uring_enabled.load(std::memory_order_relaxed)) {
+                // All buffers of the batch are in the kernel at once
+                for (size_t i = 0; i < batch.size(); ++i) {
+                    uring->prepare_write(fd, batch[i].data, batch[i].used, batch[i].offset, i);
+                }
+                uring->submit_and_wait(static_cast<unsigned>(batch.size()));
+                for (size_t i = 0; i < batch.size(); ++i) {
+                    io_uring_cqe cqe = uring->pop_completion();
+                    const Buffer& buffer = batch[cqe.user_data];
+                    if (cqe.res < 0) {
+                        if (cqe.res == -EINVAL || cqe.res == -EOPNOTSUPP) {
+                            // Kernel without IORING_OP_WRITE: switch to pwrite for the rest of the file
+                            uring_enabled.store(false, std::memory_order_relaxed);
+                            write_buffer_sync(buffer);
+                            continue;
+                        }
+                        throw std::runtime_error("Failed to write file " + path + ": " + strerror(-cqe.res));
+                    }
+                    size_t written = static_cast<size_t>(cqe.res);
+                    if (written < buffer.used) {
+                        pwrite_all(fd, buffer.data + written, buffer.used - written, buffer.offset + written, path);
+                    }
+                }
+            } else
+#endif
+            {
+                for (const Buffer& buffer : batch) {
+                    write_buffer_sync(buffer);
+                }
+            }
+        } catch (const std::exception& e) {
+            failure = e.what();
+        }
+
+        uint64_t batch_bytes = 0;
+        for (const Buffer& buffer : batch) {
+            batch_bytes += buffer.used;
+        }
+        total_bytes.fetch_add(batch_bytes, std::memory_order_relaxed);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (const Buffer& buffer : batch) {
+                free_list.push_back(buffer.data);
+            }
+            in_flight = 0;
+            if (!failure.empty() && error.empty()) {
+                error = failure;
+            }
+        }
+        cv.notify_all();
+    }
+}
+
+double AsyncFileWriter::throughput_mbps() const {
+    if (!started) {
+        return 0.0;
+    }
+    auto end = closed ? closed_at : std::chrono::steady_clock::now();
+    double seconds = std::chrono::duration<double>(end - first_write).count();
+    return seconds > 0.0 ? bytes_written() / seconds / 1e6 : 0.0;
+}
+
+const char* AsyncFileWriter::backend() const {
+    return uring_enabled.load(std::memory_order_relaxed) ? "io_uring" : "pwrite";
+}
+
+std::string AsyncFileWriter::summary() const {
+    std::ostringstream oss;
+    oss << bytes_written() / 1e6 << " MB at " << throughput_mbps() << " MB/s (" << backend() << ")";
+    return oss.str();
+}
@@ -0,0 +1,92 @@
+#ifndef ASYNC_FILE_WRITER_HPP
+#define ASYNC_FILE_WRITER_HPP
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Sequential file writer that fills large page-aligned buffers on the caller's thread and writes
+// them out on a background thread, so the caller only pays a memcpy per write() and is never
+// blocked by the disk unless every buffer is in flight.
+//
+// Writes are issued with io_uring when the kernel supports it (several buffers can be in flight
+// at once) and fall back to pwrite() otherwise.
+class AsyncFileWriter {
+public:
+    explicit AsyncFileWriter(const std::string& path,
+                             size_t buffer_size = 4 << 20,
+                             size_t buffer_count = 4);
+    ~AsyncFileWriter();
+
+    AsyncFileWriter(const AsyncFileWriter&) = delete;
+    AsyncFileWriter& operator=(const AsyncFileWriter&) = delete;
+
+    // Append bytes at the current end of file
+    void write(const void* data, size_t size);
+
+    // Write bytes at an absolute offset (e.g. to patch a header); waits for queued data first
+    void write_at(uint64_t offset, const void* data, size_t size);
+
+    // Hand off the partially filled buffer and wait until everything queued is on disk
+    void flush();
+
+    // Flush and close the file (idempotent); throws if any write failed
+    void close();
+
+    bool is_open() const { return fd >= 0; }
+    uint64_t bytes_written() const { return total_bytes.load(std::memory_order_relaxed); }
+    // Achieved throughput in MB/s between the first write and close()/now
+    double throughput_mbps() const;
+    // Name of the I/O backend in use ("io_uring" or "pwrite")
+    const char* backend() const;
+    // One-line summary for logs: bytes, throughput and backend
+    std::string summary() const;
+
+private:
+    struct Buffer {
+        char* data = nullptr;
+        size_t used = 0;
+        uint64_t offset = 0;     // file offset of data[0]
+    };
+    struct Uring;                // io_uring state (defined in the .cpp)
+
+    void writer_loop();
+    void write_buffer_sync(const Buffer& buffer);
+    void hand_off_current();
+    void check_error();
+
+    std::string path;
+    int fd;
+    size_t buffer_size;
+    std::vector<char*> storage;        // all aligned allocations (freed in destructor)
+    Buffer current;                    // buffer being filled by the caller
+    uint64_t next_offset;              // file offset of the next appended byte
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::deque<Buffer> full;           // buffers waiting to be written
+    std::vector<char*> free_list;      // empty buffers
+    size_t in_flight;                  // buffers taken by the writer thread
+    bool stopping;
+    std::string error;                 // first write error (reported to the caller)
+
+    std::unique_ptr<Uring> uring;
+    std::atomic<bool> uring_enabled;
+    std::thread writer_thread;
+
+    std::atomic<uint64_t> total_bytes;
+    std::chrono::steady_clock::time_point first_write;
+    std::chrono::steady_clock::time_point closed_at;
+    bool started;
+    bool closed;
+};
+
+#endif // ASYNC_FILE_WRITER_HPP
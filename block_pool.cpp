@@ -0,0 +1,107 @@
+#include "block_pool.hpp"
+#include <new>
+#include <sstream>
+
+namespace {
+
+void* allocate_aligned(size_t bytes) {
+    return ::operator new(bytes, std::align_val_t(BlockPool::kAlignment));
+}
+
+void free_aligned(void* ptr) {
+    ::operator delete(ptr, std::align_val_t(BlockPool::kAlignment));
+}
+
+} // namespace
+
+PooledBlock& PooledBlock::operator=(PooledBlock&& other) noexcept {
+    if (this != &other) {
+        reset();
+        owner = other.owner;
+        ptr = other.ptr;
+        bytes = other.bytes;
+        size_class = other.size_class;
+        other.owner = nullptr;
+        other.ptr = nullptr;
+        other.bytes = 0;
+        other.size_class = -1;
+    }
+    return *this;
+}
+
+void PooledBlock::reset() {
+    if (ptr != nullptr) {
+        owner->release(ptr, bytes, size_class);
+        owner = nullptr;
+        ptr = nullptr;
+        bytes = 0;
+        size_class = -1;
+    }
+}
+
+BlockPool::BlockPool(size_t max_cached_bytes)
+    : max_cached(max_cached_bytes), cached(0), hit_count(0), miss_count(0)
+{
+}
+
+BlockPool::~BlockPool() {
+    for (FreeList& list : lists) {
+        for (void* block : list.blocks) {
+            free_aligned(block);
+        }
+    }
+}
+
+BlockPool& BlockPool::shared() {
+    static BlockPool pool;
+    return pool;
+}
+
+PooledBlock BlockPool::acquire(size_t bytes) {
+    if (bytes > kMaxBlockSize) {
+        miss_count.fetch_add(1, std::memory_order_relaxed);
+        size_t rounded = (bytes + kAlignment - 1) & ~(kAlignment - 1);
+        return PooledBlock(this, allocate_aligned(rounded), rounded, -1);
+    }
+    int size_class = 0;
+    size_t capacity = kMinBlockSize;
+    while (capacity < bytes) {
+        capacity <<= 1;
+        ++size_class;
+    }
+    {
+        FreeList& list = lists[size_class];
+        std::lock_guard<std::mutex> lock(list.mutex);
+        if (!list.blocks.empty()) {
+            void* block = list.blocks.back();
+            list.blocks.pop_back();
+            cached.fetch_sub(capacity, std::memory_order_relaxed);
+            hit_count.fetch_add(1, std::memory_order_relaxed);
+            return PooledBlock(this, block, capacity, size_class);
+        }
+    }
+    miss_count.fetch_add(1, std::memory_order_relaxed);
+    return PooledBlock(this, allocate_aligned(capacity), capacity, size_class);
+}
+
+void BlockPool::release(void* ptr, size_t bytes, int size_class) {
+    if (size_class >= 0 && cached.load(std::memory_order_relaxed) + bytes <= max_cached) {
+        FreeList& list = lists[size_class];
+        std::lock_guard<std::mutex> lock(list.mutex);
+        list.blocks.push_back(ptr);
+        cached.fetch_add(bytes, std::memory_order_relaxed);
+        return;
+    }
+    free_aligned(ptr);
+}
+
+std::string BlockPool::summary() const {
+    uint64_t hit = hits();
+    uint64_t total = hit + misses();
+    std::ostringstream oss;
+    oss.setf(std::ios::fixed);
+    oss.precision(1);
+    oss << (total > 0 ? 100.0 * hit / total : 0.0) << "% hits (" << total << " acquired, " << misses()
+        << " allocated), " << cached_bytes() / 1e6 << " MB cached";
+    return oss.str();
+}
@@ -0,0 +1,90 @@
+#ifndef BLOCK_POOL_HPP
+#define BLOCK_POOL_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+class BlockPool;
+
+// A 64-byte-aligned buffer borrowed from a BlockPool; returned to it when destroyed (move-only)
+class PooledBlock {
+public:
+    PooledBlock() = default;
+    ~PooledBlock() { reset(); }
+
+    PooledBlock(PooledBlock&& other) noexcept { *this = std::move(other); }
+    PooledBlock& operator=(PooledBlock&& other) noexcept;
+    PooledBlock(const PooledBlock&) = delete;
+    PooledBlock& operator=(const PooledBlock&) = delete;
+
+    void* data() const { return ptr; }
+    size_t capacity() const { return bytes; }
+    explicit operator bool() const { return ptr != nullptr; }
+
+    // Give the buffer back to the pool now
+    void reset();
+
+private:
+    friend class BlockPool;
+    PooledBlock(BlockPool* pool, void* ptr, size_t bytes, int size_class)
+        : owner(pool), ptr(ptr), bytes(bytes), size_class(size_class) {}
+
+    BlockPool* owner = nullptr;
+    void* ptr = nullptr;
+    size_t bytes = 0;
+    int size_class = -1;  // -1: larger than the largest class, freed on release
+};
+
+// Recycling pool of message buffers shared by the stream receivers (which fill them) and the merger
+// (which releases them). Blocks come in power-of-two size classes from kMinBlockSize to
+// kMaxBlockSize, aligned to a cache line; a released block goes back on its class's free list, so
+// once the pool has warmed up to the acquisition's message sizes, receiving and merging allocate
+// nothing. Free lists keep at most `max_cached_bytes` in total; the excess is freed.
+class BlockPool {
+public:
+    static constexpr size_t kAlignment = 64;
+    static constexpr size_t kMinBlockSize = size_t(4) << 10;
+    static constexpr size_t kMaxBlockSize = size_t(64) << 20;
+    static constexpr size_t kDefaultMaxCachedBytes = size_t(256) << 20;
+
+    explicit BlockPool(size_t max_cached_bytes = kDefaultMaxCachedBytes);
+    ~BlockPool();
+
+    BlockPool(const BlockPool&) = delete;
+    BlockPool& operator=(const BlockPool&) = delete;
+
+    // Process-wide pool used by the stream clients
+    static BlockPool& shared();
+
+    // A block of at least `bytes` bytes (a recycled one when available)
+    PooledBlock acquire(size_t bytes);
+
+    uint64_t hits() const { return hit_count.load(std::memory_order_relaxed); }
+    uint64_t misses() const { return miss_count.load(std::memory_order_relaxed); }
+    size_t cached_bytes() const { return cached.load(std::memory_order_relaxed); }
+    // e.g. "98.5% hits (12000 acquired, 180 allocated), 48 MB cached"
+    std::string summary() const;
+
+private:
+    friend class PooledBlock;
+    static constexpr int kClassCount = 15;  // 4 KiB ... 64 MiB
+
+    void release(void* ptr, size_t bytes, int size_class);
+
+    struct FreeList {
+        std::mutex mutex;
+        std::vector<void*> blocks;
+    };
+
+    size_t max_cached;
+    FreeList lists[kClassCount];
+    std::atomic<size_t> cached;
+    std::atomic<uint64_t> hit_count;
+    std::atomic<uint64_t> miss_count;
+};
+
+#endif // BLOCK_POOL_HPP
@@ -0,0 +1,328 @@
+#include "coincidence.hpp"
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+CoincidenceCounter::CoincidenceCounter(const CoincidenceConfig& config_)
+    : config(config_), dims(config_.channels), bins(0), threads(config_.threads),
+      job_generation(0), job_workers(0), job_ready(0), job_per_worker(0), job_limit(0),
+      pending_workers(0), stopping(false), total_events(0), skipped(0), busy(0.0)
+{
+    if (config.window < 0 || config.bin_width <= 0 || dims <= 1 || dims > 255) {
+        throw std::invalid_argument("Invalid coincidence configuration");
+    }
+    bins = static_cast<size_t>((2 * config.window) / config.bin_width) + 1;
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    totals.counts.assign(dims * dims, 0);
+    totals.histograms.assign(dims * dims * bins, 0);
+    thread_tables.resize(threads, totals);
+}
+
+CoincidenceCounter::~CoincidenceCounter() {
+    {
+        std::lock_guard<std::mutex> lock(pool_mutex);
+        stopping = true;
+    }
+    job_cv.notify_all();
+    for (std::thread& worker : pool) {
+        worker.join();
+    }
+}
+
+void CoincidenceCounter::worker_loop(unsigned w, uint64_t seen) {
+    while (true) {
+        size_t begin;
+        size_t end;
+        size_t limit;
+        {
+            std::unique_lock<std::mutex> lock(pool_mutex);
+            job_cv.wait(lock, [this, seen]() { return stopping || job_generation != seen; });
+            if (stopping) {
+                return;
+            }
+            seen = job_generation;
+            if (w >= job_workers) {
+                continue;  // this block is split across fewer workers
+            }
+            begin = std::min(job_ready, w * job_per_worker);
+            end = std::min(job_ready, begin + job_per_worker);
+            limit = job_limit;
+        }
+        count_range(begin, end, limit, thread_tables[w]);
+        {
+            std::lock_guard<std::mutex> lock(pool_mutex);
+            if (--pending_workers == 0) {
+                done_cv.notify_one();
+            }
+        }
+    }
+}
+
+void CoincidenceCounter::process(const uint64_t* timestamps, const uint8_t* channels, size_t count) {
+    auto start = std::chrono::steady_clock::now();
+    work_timestamps.reserve(work_timestamps.size() + count);
+    work_channels.reserve(work_channels.size() + count);
+    for (size_t i = 0; i < count; ++i) {
+        if (channels[i] < dims) {
+            work_timestamps.push_back(timestamps[i]);
+            work_channels.push_back(channels[i]);
+        } else {
+            ++skipped;
+        }
+    }
+    total_events += count;
+    run_block(false);
+    busy += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+void CoincidenceCounter::process(const std::vector<uint64_t>& timestamps, const std::vector<int>& channels) {
+    std::vector<uint8_t> narrow(channels.size());
+    for (size_t i = 0; i < channels.size(); ++i) {
+        // Out-of-range channels map to a value that process() skips
+        narrow[i] = (channels[i] >= 0 && channels[i] < dims) ? static_cast<uint8_t>(channels[i]) : 255;
+    }
+    process(timestamps.data(), narrow.data(), std::min(timestamps.size(), narrow.size()));
+}
+
+void CoincidenceCounter::finish() {
+    auto start = std::chrono::steady_clock::now();
+    run_block(true);
+    busy += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+void CoincidenceCounter::count_range(size_t begin, size_t end, size_t limit, Tables& tables) const {
+    const uint64_t* ts = work_timestamps.data();
+    const uint8_t* ch = work_channels.data();
+    const uint64_t window = static_cast<uint64_t>(config.window);
+    const int64_t bin_width = config.bin_width;
+    uint64_t* counts = tables.counts.data();
+    uint64_t* histograms = tables.histograms.data();
+    for (size_t i = begin; i < end; ++i) {
+        const uint64_t ti = ts[i];
+        const int ci = ch[i];
+        for (size_t j = i + 1; j < limit && ts[j] - ti <= window; ++j) {
+            const int cj = ch[j];
+            if (cj == ci) {
+                continue;
+            }
+            const int64_t d = static_cast<int64_t>(ts[j] - ti);
+            size_t pair;
+            int64_t delay;
+            if (ci < cj) {
+                pair = static_cast<size_t>(ci * dims + cj);
+                delay = d;
+            } else {
+                pair = static_cast<size_t>(cj * dims + ci);
+                delay = -d;
+            }
+            ++counts[pair];
+            ++histograms[pair * bins + static_cast<size_t>((delay + config.window) / bin_width)];
+        }
+    }
+}
+
+void CoincidenceCounter::run_block(bool final_block) {
+    const size_t n = work_timestamps.size();
+    if (n == 0) {
+        return;
+    }
+    // Events whose window may reach into the next block are carried over, unless this is the end
+    size_t ready = n;
+    if (!final_block) {
+        const uint64_t last = work_timestamps.back();
+        const uint64_t horizon = last >= static_cast<uint64_t>(config.window) ? last - config.window : 0;
+        // Later blocks only hold timestamps >= last, so every partner of an event earlier than
+        // last - window is already in the buffers
+        ready = static_cast<size_t>(std::lower_bound(work_timestamps.begin(), work_timestamps.end(), horizon) -
+                                    work_timestamps.begin());
+    }
+
+    if (ready > 0) {
+        // Split the ready events into contiguous (and therefore time-ordered) ranges, one per thread;
+        // each thread only reads the shared buffers and writes its own tables
+        unsigned workers = static_cast<unsigned>(std::min<size_t>(threads, std::max<size_t>(1, ready / config.min_events_per_thread)));
+        if (workers <= 1) {
+            count_range(0, ready, n, thread_tables[0]);
+        } else {
+            // The pool is started with the first block that needs it and then kept
+            for (unsigned w = static_cast<unsigned>(pool.size()) + 1; w < threads; ++w) {
+                pool.emplace_back(&CoincidenceCounter::worker_loop, this, w, job_generation);
+            }
+            const size_t per_worker = (ready + workers - 1) / workers;
+            {
+                std::lock_guard<std::mutex> lock(pool_mutex);
+                job_workers = workers;
+                job_ready = ready;
+                job_per_worker = per_worker;
+                job_limit = n;
+                pending_workers = workers - 1;
+                ++job_generation;
+            }
+            job_cv.notify_all();
+            count_range(0, std::min(ready, per_worker), n, thread_tables[0]);
+            std::unique_lock<std::mutex> lock(pool_mutex);
+            done_cv.wait(lock, [this]() { return pending_workers == 0; });
+        }
+        // Fold the per-thread tables into the totals
+        for (Tables& tables : thread_tables) {
+            for (size_t k = 0; k < tables.counts.size(); ++k) {
+                totals.counts[k] += tables.counts[k];
+                tables.counts[k] = 0;
+            }
+            for (size_t k = 0; k < tables.histograms.size(); ++k) {
+                totals.histograms[k] += tables.histograms[k];
+                tables.histograms[k] = 0;
+            }
+        }
+    }
+
+    work_timestamps.erase(work_timestamps.begin(), work_timestamps.begin() + ready);
+    work_channels.erase(work_channels.begin(), work_channels.begin() + ready);
+}
+
+uint64_t CoincidenceCounter::count(int a, int b) const {
+    if (a > b) std::swap(a, b);
+    if (a < 0 || b >= dims || a == b) return 0;
+    return totals.counts[a * dims + b];
+}
+
+const uint64_t* CoincidenceCounter::histogram(int a, int b) const {
+    if (a > b) std::swap(a, b);
+    if (a < 0 || b >= dims || a == b) return nullptr;
+    return totals.histograms.data() + static_cast<size_t>(a * dims + b) * bins;
+}
+
+std::string CoincidenceCounter::summary() const {
+    std::ostringstream oss;
+    oss << total_events << " events in " << busy << " s (" << events_per_second() / 1e6
+        << " Mevents/s, " << threads << " threads)";
+    if (skipped > 0) {
+        oss << ", " << skipped << " events on channels >= " << dims << " skipped";
+    }
+    return oss.str();
+}
+
+void CoincidenceCounter::write_report(const std::string& path) const {
+    std::ofstream file(path);
+    if (!file) {
+        throw std::runtime_error("Failed to open file for writing: " + path);
+    }
+    file << "Coincidence Report" << std::endl;
+    file << "==================" << std::endl;
+    file << "Window: +/-" << config.window << " ps, histogram bin: " << config.bin_width << " ps" << std::endl;
+    file << "Processed: " << summary() << std::endl;
+    file << std::endl;
+    file << "channel_a;channel_b;coincidences;peak_delay_ps" << std::endl;
+    for (int a = 0; a < dims; ++a) {
+        for (int b = a + 1; b < dims; ++b) {
+            uint64_t pair_count = count(a, b);
+            if (pair_count == 0) {
+                continue;
+            }
+            const uint64_t* hist = histogram(a, b);
+            size_t peak = static_cast<size_t>(std::max_element(hist, hist + bins) - hist);
+            int64_t peak_delay = -config.window + static_cast<int64_t>(peak) * config.bin_width + config.bin_width / 2;
+            file << a << ";" << b << ";" << pair_count << ";" << peak_delay << std::endl;
+        }
+    }
+}
+
+void CoincidenceCounter::write_histograms_csv(const std::string& path) const {
+    std::ofstream file(path);
+    if (!file) {
+        throw std::runtime_error("Failed to open file for writing: " + path);
+    }
+    file << "channel_a;channel_b;delay_ps;count" << std::endl;
+    for (int a = 0; a < dims; ++a) {
+        for (int b = a + 1; b < dims; ++b) {
+            if (count(a, b) == 0) {
+                continue;
+            }
+            const uint64_t* hist = histogram(a, b);
+            for (size_t i = 0; i < bins; ++i) {
+                if (hist[i] != 0) {
+                    file << a << ";" << b << ";" << -config.window + static_cast<int64_t>(i) * config.bin_width
+                         << ";" << hist[i] << "\n";
+                }
+            }
+        }
+    }
+}
+
+CoincidenceCounterThread::CoincidenceCounterThread(CoincidenceCounter& counter_, size_t max_queued_events)
+    : counter(counter_), max_queued(max_queued_events), queued_events(0), finishing(false), wait_count(0)
+{
+    thread = std::thread(&CoincidenceCounterThread::run, this);
+}
+
+CoincidenceCounterThread::~CoincidenceCounterThread() {
+    finish();
+}
+
+void CoincidenceCounterThread::submit(const uint64_t* timestamps, const uint8_t* channels, size_t count) {
+    if (count == 0) {
+        return;
+    }
+    Block block;
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        // A block larger than the limit still goes through once the queue is empty
+        if (queued_events > 0 && queued_events + count > max_queued) {
+            ++wait_count;
+            cv.wait(lock, [this, count]() { return queued_events == 0 || queued_events + count <= max_queued; });
+        }
+        if (!spare.empty()) {
+            block = std::move(spare.back());
+            spare.pop_back();
+        }
+    }
+    block.timestamps.assign(timestamps, timestamps + count);
+    block.channels.assign(channels, channels + count);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        queue.push_back(std::move(block));
+        queued_events += count;
+    }
+    cv.notify_all();
+}
+
+void CoincidenceCounterThread::finish() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        finishing = true;
+    }
+    cv.notify_all();
+    if (thread.joinable()) {
+        thread.join();
+    }
+}
+
+void CoincidenceCounterThread::run() {
+    while (true) {
+        Block block;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            cv.wait(lock, [this]() { return finishing || !queue.empty(); });
+            if (queue.empty()) {
+                break;  // finishing, and everything queued has been counted
+            }
+            block = std::move(queue.front());
+            queue.pop_front();
+        }
+        counter.process(block.timestamps.data(), block.channels.data(), block.timestamps.size());
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            queued_events -= block.timestamps.size();
+            if (spare.size() < 4) {
+                spare.push_back(std::move(block));
+            }
+        }
+        cv.notify_all();
+    }
+    counter.finish();
+}
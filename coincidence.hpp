@@ -0,0 +1,154 @@
+#ifndef COINCIDENCE_HPP
+#define COINCIDENCE_HPP
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Coincidence counting on a merged, time-ordered (channel, timestamp) stream.
+//
+// Two events on different channels a < b are coincident when |t_b - t_a| <= window. For every such
+// pair the counter increments count(a, b) and a histogram of the delay t_b - t_a over
+// [-window, window]. Each pair is counted once, from its earlier event.
+//
+// Input arrives in blocks (a merger batch, a .tsm block, a chunk of a .bin file). Events near the
+// end of a block whose window reaches into the next block are carried over, so results do not
+// depend on block boundaries. Large blocks are split by time across worker threads; each thread
+// counts into private tables that are summed at the end of the block. The workers are started with
+// the first block large enough to need them and kept for the counter's lifetime.
+//
+// CoincidenceCounterThread runs a counter on its own thread, so a producer that must not stall (the
+// merger) only pays a copy of each block.
+
+struct CoincidenceConfig {
+    int64_t window = 1000;        // coincidence window in timestamp units (ps)
+    int64_t bin_width = 10;       // delay histogram bin
+    int channels = 9;             // channel numbers 0..channels-1 are counted (TC channels are 1..8; at most 255)
+    unsigned threads = 0;         // worker threads per block (0: hardware concurrency)
+    size_t min_events_per_thread = size_t(1) << 18;  // smaller blocks use fewer threads
+};
+
+class CoincidenceCounter {
+public:
+    explicit CoincidenceCounter(const CoincidenceConfig& config = CoincidenceConfig());
+    ~CoincidenceCounter();
+
+    CoincidenceCounter(const CoincidenceCounter&) = delete;
+    CoincidenceCounter& operator=(const CoincidenceCounter&) = delete;
+
+    // Feed the next block of events; timestamps must be non-decreasing across calls
+    void process(const uint64_t* timestamps, const uint8_t* channels, size_t count);
+
+    // Convenience overload for int channel vectors (as used by the controllers)
+    void process(const std::vector<uint64_t>& timestamps, const std::vector<int>& channels);
+
+    // Count the pairs of the carried-over tail (call once after the last block)
+    void finish();
+
+    uint64_t count(int a, int b) const;
+    // Delay histogram of channel pair (a, b), a < b; bin i covers
+    // [-window + i * bin_width, -window + (i + 1) * bin_width)
+    const uint64_t* histogram(int a, int b) const;
+    size_t histogram_bins() const { return bins; }
+
+    uint64_t events() const { return total_events; }
+    uint64_t skipped_events() const { return skipped; }
+    double busy_seconds() const { return busy; }
+    // Events processed per second of counting time
+    double events_per_second() const { return busy > 0.0 ? total_events / busy : 0.0; }
+
+    // Per-pair counts, a one-line throughput summary and (optionally) the delay histograms as CSV
+    void write_report(const std::string& path) const;
+    void write_histograms_csv(const std::string& path) const;
+    std::string summary() const;
+
+private:
+    struct Tables {
+        std::vector<uint64_t> counts;      // channels * channels (only a < b used)
+        std::vector<uint64_t> histograms;  // channels * channels * bins
+    };
+
+    // Count pairs whose earlier event has index in [begin, end) of the working buffers; partners
+    // are searched up to index `limit`
+    void count_range(size_t begin, size_t end, size_t limit, Tables& tables) const;
+    void run_block(bool final_block);
+    // Worker w (>= 1) counts its range of each job after `seen` into thread_tables[w]; range 0 is
+    // the caller's
+    void worker_loop(unsigned w, uint64_t seen);
+
+    CoincidenceConfig config;
+    int dims;
+    size_t bins;
+    unsigned threads;
+    Tables totals;
+
+    // Working buffers: events carried over from earlier blocks followed by the current block
+    std::vector<uint64_t> work_timestamps;
+    std::vector<uint8_t> work_channels;
+
+    std::vector<Tables> thread_tables;
+
+    // Worker pool and the job it is counting: the ready events [0, job_ready) in ranges of
+    // job_per_worker, partners searched up to job_limit
+    std::vector<std::thread> pool;
+    std::mutex pool_mutex;
+    std::condition_variable job_cv;      // a new job was posted, or the pool is stopping
+    std::condition_variable done_cv;     // a worker finished its range
+    uint64_t job_generation;
+    unsigned job_workers;
+    size_t job_ready;
+    size_t job_per_worker;
+    size_t job_limit;
+    unsigned pending_workers;
+    bool stopping;
+
+    uint64_t total_events;
+    uint64_t skipped;
+    double busy;
+};
+
+class CoincidenceCounterThread {
+public:
+    // `counter` must outlive this object and is used only by the counting thread until finish()
+    // returns. At most `max_queued_events` events wait to be counted before submit() blocks.
+    explicit CoincidenceCounterThread(CoincidenceCounter& counter, size_t max_queued_events = size_t(1) << 22);
+    ~CoincidenceCounterThread();
+
+    CoincidenceCounterThread(const CoincidenceCounterThread&) = delete;
+    CoincidenceCounterThread& operator=(const CoincidenceCounterThread&) = delete;
+
+    // Queue a copy of the next block (same ordering rule as CoincidenceCounter::process); waits
+    // only while the counter is more than max_queued_events behind
+    void submit(const uint64_t* timestamps, const uint8_t* channels, size_t count);
+    // Count every queued block and the carried-over tail, then stop the thread (idempotent)
+    void finish();
+
+    // Times submit() had to wait for the counter to catch up
+    uint64_t waits() const { return wait_count; }
+
+private:
+    struct Block {
+        std::vector<uint64_t> timestamps;
+        std::vector<uint8_t> channels;
+    };
+
+    void run();
+
+    CoincidenceCounter& counter;
+    size_t max_queued;
+    std::mutex mutex;
+    std::condition_variable cv;      // a block was queued or counted, or finish() was called
+    std::deque<Block> queue;
+    std::vector<Block> spare;        // counted blocks, reused by submit() to avoid reallocating
+    size_t queued_events;
+    bool finishing;
+    uint64_t wait_count;
+    std::thread thread;
+};
+
+#endif // COINCIDENCE_HPP
@@ -0,0 +1,104 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <filesystem>
+#include "coincidence.hpp"
+#include "timestamp_file.hpp"
+#include "timestamp_file_view.hpp"
+
+// Offline coincidence counting on a merged acquisition file.
+// Usage: coincidence_counter FILE [--window PS] [--bin PS] [--threads N] [--channels N]
+//                                 [--report FILE] [--histograms FILE]
+//   FILE is a merger output (.tsm) or a 12-byte record file (.bin); events must be time-ordered.
+
+namespace fs = std::filesystem;
+
+namespace {
+
+void print_usage() {
+    std::cerr << "Usage: coincidence_counter FILE [--window PS] [--bin PS] [--threads N] [--channels N]"
+              << " [--report FILE] [--histograms FILE]" << std::endl;
+}
+
+// Feed a .tsm file block by block (the blocks are already columnar)
+void count_merged_file(const std::string& path, CoincidenceCounter& counter) {
+    MergedTimestampReader reader(path);
+    std::vector<uint64_t> timestamps;
+    std::vector<uint8_t> channels;
+    while (reader.read_block(timestamps, channels)) {
+        counter.process(timestamps.data(), channels.data(), timestamps.size());
+    }
+}
+
+// Feed a .bin record file through a mapping, converted to columns a chunk at a time
+void count_record_file(const std::string& path, CoincidenceCounter& counter) {
+    TimestampFileView view(path);
+    const size_t chunk = size_t(1) << 22;
+    std::vector<uint64_t> timestamps(std::min(chunk, view.size()));
+    std::vector<uint8_t> channels(timestamps.size());
+    for (size_t start = 0; start < view.size(); start += chunk) {
+        size_t count = std::min(chunk, view.size() - start);
+        for (size_t i = 0; i < count; ++i) {
+            timestamps[i] = view.timestamp(start + i);
+            int channel = view.channel(start + i);
+            channels[i] = (channel >= 0 && channel < 255) ? static_cast<uint8_t>(channel) : 255;
+        }
+        counter.process(timestamps.data(), channels.data(), count);
+        view.release_range(start, start + count);
+    }
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        print_usage();
+        return 1;
+    }
+    std::string input = argv[1];
+    CoincidenceConfig config;
+    std::string report_file = fs::path(input).replace_extension("").string() + "_coincidences.txt";
+    std::string histogram_file;
+
+    for (int i = 2; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--window" && i + 1 < argc) {
+            config.window = std::stoll(argv[++i]);
+        } else if (arg == "--bin" && i + 1 < argc) {
+            config.bin_width = std::stoll(argv[++i]);
+        } else if (arg == "--threads" && i + 1 < argc) {
+            config.threads = static_cast<unsigned>(std::stoul(argv[++i]));
+        } else if (arg == "--channels" && i + 1 < argc) {
+            config.channels = std::stoi(argv[++i]);
+        } else if (arg == "--report" && i + 1 < argc) {
+            report_file = argv[++i];
+        } else if (arg == "--histograms" && i + 1 < argc) {
+            histogram_file = argv[++i];
+        } else {
+            print_usage();
+            return 1;
+        }
+    }
+
+    try {
+        CoincidenceCounter counter(config);
+        if (fs::path(input).extension() == ".tsm") {
+            count_merged_file(input, counter);
+        } else {
+            count_record_file(input, counter);
+        }
+        counter.finish();
+
+        std::cout << "Processed " << counter.summary() << std::endl;
+        counter.write_report(report_file);
+        std::cout << "Coincidence report written to " << report_file << std::endl;
+        if (!histogram_file.empty()) {
+            counter.write_histograms_csv(histogram_file);
+            std::cout << "Delay histograms written to " << histogram_file << std::endl;
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "ERROR: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,164 @@
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include "coincidence.hpp"
+
+// Compares CoincidenceCounter with a brute-force pair count over several block sizes, with one and
+// several worker threads, fed directly and through CoincidenceCounterThread.
+
+namespace {
+
+int failures = 0;
+
+void check(bool condition, const std::string& what) {
+    if (!condition) {
+        std::cerr << "FAIL: " << what << std::endl;
+        ++failures;
+    }
+}
+
+struct Events {
+    std::vector<uint64_t> timestamps;
+    std::vector<uint8_t> channels;
+};
+
+// Correlated groups (a source seen on several channels with small delays) over uncorrelated
+// background, including equal timestamps and an out-of-range channel
+Events make_events(size_t groups, int channels) {
+    std::mt19937_64 rng(2024);
+    std::uniform_int_distribution<uint64_t> gap(0, 3000);
+    std::uniform_int_distribution<int> channel(1, channels - 1);
+    std::uniform_int_distribution<int> delay(-400, 400);
+    std::uniform_int_distribution<int> extra(0, 3);
+    std::vector<std::pair<uint64_t, uint8_t>> events;
+    uint64_t t = 1000000;
+    for (size_t g = 0; g < groups; ++g) {
+        t += gap(rng);
+        events.emplace_back(t, static_cast<uint8_t>(channel(rng)));
+        for (int k = extra(rng); k > 0; --k) {
+            events.emplace_back(t + 1000 + delay(rng), static_cast<uint8_t>(channel(rng)));
+        }
+        if (g % 97 == 0) {
+            events.emplace_back(t, static_cast<uint8_t>(channels + 3));  // skipped by the counter
+        }
+    }
+    std::stable_sort(events.begin(), events.end(),
+                     [](const std::pair<uint64_t, uint8_t>& a, const std::pair<uint64_t, uint8_t>& b) { return a.first < b.first; });
+    Events out;
+    for (const auto& event : events) {
+        out.timestamps.push_back(event.first);
+        out.channels.push_back(event.second);
+    }
+    return out;
+}
+
+struct Reference {
+    std::vector<uint64_t> counts;      // dims * dims
+    std::vector<uint64_t> histograms;  // dims * dims * bins
+};
+
+Reference brute_force(const Events& events, const CoincidenceConfig& config) {
+    const int dims = config.channels;
+    const size_t bins = static_cast<size_t>((2 * config.window) / config.bin_width) + 1;
+    Reference ref;
+    ref.counts.assign(dims * dims, 0);
+    ref.histograms.assign(dims * dims * bins, 0);
+    const size_t n = events.timestamps.size();
+    for (size_t i = 0; i < n; ++i) {
+        for (size_t j = 0; j < n; ++j) {
+            int a = events.channels[i];
+            int b = events.channels[j];
+            if (a >= b || b >= dims) {
+                continue;
+            }
+            int64_t delay = static_cast<int64_t>(events.timestamps[j] - events.timestamps[i]);
+            if (delay < -config.window || delay > config.window) {
+                continue;
+            }
+            ++ref.counts[a * dims + b];
+            ++ref.histograms[(a * dims + b) * bins + static_cast<size_t>((delay + config.window) / config.bin_width)];
+        }
+    }
+    return ref;
+}
+
+void compare(const CoincidenceCounter& counter, const Reference& ref, const CoincidenceConfig& config,
+             const std::string& what) {
+    const int dims = config.channels;
+    bool counts_match = true;
+    bool histograms_match = true;
+    for (int a = 0; a < dims; ++a) {
+        for (int b = a + 1; b < dims; ++b) {
+            if (counter.count(a, b) != ref.counts[a * dims + b]) {
+                counts_match = false;
+            }
+            const uint64_t* hist = counter.histogram(a, b);
+            if (!std::equal(hist, hist + counter.histogram_bins(),
+                            ref.histograms.begin() + static_cast<size_t>(a * dims + b) * counter.histogram_bins())) {
+                histograms_match = false;
+            }
+        }
+    }
+    check(counts_match, what + ": pair counts match the brute-force count");
+    check(histograms_match, what + ": delay histograms match the brute-force count");
+}
+
+void test_block_sizes_and_threads() {
+    CoincidenceConfig config;
+    config.window = 1500;
+    config.bin_width = 25;
+    config.channels = 5;
+    config.min_events_per_thread = 64;  // split even small blocks across the workers
+    const Events events = make_events(6000, config.channels);
+    const Reference ref = brute_force(events, config);
+    const size_t n = events.timestamps.size();
+
+    uint64_t total_pairs = 0;
+    for (uint64_t count : ref.counts) {
+        total_pairs += count;
+    }
+    check(total_pairs > 1000, "the test data has coincidences to count");
+
+    for (unsigned threads : {1u, 4u}) {
+        for (size_t block : {size_t(1), size_t(7), size_t(1000), n}) {
+            config.threads = threads;
+            const std::string what = std::to_string(threads) + " thread(s), blocks of " + std::to_string(block);
+
+            CoincidenceCounter direct(config);
+            for (size_t start = 0; start < n; start += block) {
+                size_t count = std::min(block, n - start);
+                direct.process(events.timestamps.data() + start, events.channels.data() + start, count);
+            }
+            direct.finish();
+            compare(direct, ref, config, what);
+            check(direct.events() == n, what + ": every event is seen");
+
+            CoincidenceCounter threaded(config);
+            {
+                // A small queue limit makes submit() wait for the counter now and then
+                CoincidenceCounterThread counting(threaded, 2000);
+                for (size_t start = 0; start < n; start += block) {
+                    size_t count = std::min(block, n - start);
+                    counting.submit(events.timestamps.data() + start, events.channels.data() + start, count);
+                }
+                counting.finish();
+            }
+            compare(threaded, ref, config, what + ", counter thread");
+        }
+    }
+}
+
+} // namespace
+
+int main() {
+    test_block_sizes_and_threads();
+    if (failures > 0) {
+        std::cerr << failures << " check(s) failed" << std::endl;
+        return 1;
+    }
+    std::cout << "coincidence_test: all checks passed" << std::endl;
+    return 0;
+}
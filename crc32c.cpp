@@ -0,0 +1,119 @@
+#include "crc32c.hpp"
+#include <cstring>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <nmmintrin.h>
+#define TT_CRC32C_X86 1
+#elif defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#define TT_CRC32C_ARM 1
+#endif
+
+namespace {
+
+constexpr uint32_t kPolynomial = 0x82F63B78;  // reflected Castagnoli polynomial
+
+struct Tables {
+    uint32_t t[8][256];
+
+    Tables() {
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t crc = i;
+            for (int k = 0; k < 8; ++k) {
+                crc = (crc >> 1) ^ ((crc & 1) ? kPolynomial : 0);
+            }
+            t[0][i] = crc;
+        }
+        for (uint32_t i = 0; i < 256; ++i) {
+            for (int s = 1; s < 8; ++s) {
+                t[s][i] = (t[s - 1][i] >> 8) ^ t[0][t[s - 1][i] & 0xFF];
+            }
+        }
+    }
+};
+
+// Slicing-by-8: eight table lookups per 8 input bytes
+uint32_t update_table(const uint8_t* p, size_t size, uint32_t crc) {
+    static const Tables tables;
+    const auto& t = tables.t;
+    while (size >= 8) {
+        uint64_t word;
+        std::memcpy(&word, p, 8);
+        word ^= crc;
+        crc = t[7][word & 0xFF] ^ t[6][(word >> 8) & 0xFF] ^ t[5][(word >> 16) & 0xFF] ^
+              t[4][(word >> 24) & 0xFF] ^ t[3][(word >> 32) & 0xFF] ^ t[2][(word >> 40) & 0xFF] ^
+              t[1][(word >> 48) & 0xFF] ^ t[0][word >> 56];
+        p += 8;
+        size -= 8;
+    }
+    while (size-- > 0) {
+        crc = (crc >> 8) ^ t[0][(crc ^ *p++) & 0xFF];
+    }
+    return crc;
+}
+
+#if defined(TT_CRC32C_X86)
+__attribute__((target("sse4.2")))
+uint32_t update_hardware(const uint8_t* p, size_t size, uint32_t crc) {
+    uint64_t crc64 = crc;
+    while (size >= 8) {
+        uint64_t word;
+        std::memcpy(&word, p, 8);
+        crc64 = _mm_crc32_u64(crc64, word);
+        p += 8;
+        size -= 8;
+    }
+    uint32_t crc32 = static_cast<uint32_t>(crc64);
+    while (size-- > 0) {
+        crc32 = _mm_crc32_u8(crc32, *p++);
+    }
+    return crc32;
+}
+
+bool have_hardware() {
+    static const bool supported = __builtin_cpu_supports("sse4.2");
+    return supported;
+}
+#elif defined(TT_CRC32C_ARM)
+uint32_t update_hardware(const uint8_t* p, size_t size, uint32_t crc) {
+    while (size >= 8) {
+        uint64_t word;
+        std::memcpy(&word, p, 8);
+        crc = __crc32cd(crc, word);
+        p += 8;
+        size -= 8;
+    }
+    while (size-- > 0) {
+        crc = __crc32cb(crc, *p++);
+    }
+    return crc;
+}
+
+bool have_hardware() { return true; }
+#else
+uint32_t update_hardware(const uint8_t* p, size_t size, uint32_t crc) { return update_table(p, size, crc); }
+
+bool have_hardware() { return false; }
+#endif
+
+} // namespace
+
+uint32_t crc32c(const void* data, size_t size, uint32_t crc) {
+    return have_hardware() ? crc32c_hardware(data, size, crc) : crc32c_table(data, size, crc);
+}
+
+uint32_t crc32c_table(const void* data, size_t size, uint32_t crc) {
+    return ~update_table(static_cast<const uint8_t*>(data), size, ~crc);
+}
+
+uint32_t crc32c_hardware(const void* data, size_t size, uint32_t crc) {
+    return ~update_hardware(static_cast<const uint8_t*>(data), size, ~crc);
+}
+
+bool crc32c_have_hardware() {
+    return have_hardware();
+}
+
+const char* crc32c_backend() {
+    return have_hardware() ? "hardware" : "table";
+}
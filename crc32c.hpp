@@ -0,0 +1,23 @@
+#ifndef CRC32C_HPP
+#define CRC32C_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+// CRC-32C (Castagnoli), as used by iSCSI/ext4/SCTP. Uses the SSE4.2 crc32 instruction on x86-64 or
+// the ARMv8 CRC extension when available, and a slicing-by-8 table otherwise.
+//
+// `crc` is the value returned for the preceding data, so a buffer can be checksummed in pieces:
+// crc32c(b, nb, crc32c(a, na)) == crc32c(ab, na + nb).
+uint32_t crc32c(const void* data, size_t size, uint32_t crc = 0);
+
+// "hardware" or "table"
+const char* crc32c_backend();
+
+// The two backends crc32c() chooses between, for tests; same arguments and result as crc32c().
+// crc32c_hardware() may only be called when crc32c_have_hardware() is true.
+uint32_t crc32c_table(const void* data, size_t size, uint32_t crc = 0);
+uint32_t crc32c_hardware(const void* data, size_t size, uint32_t crc = 0);
+bool crc32c_have_hardware();
+
+#endif // CRC32C_HPP
@@ -0,0 +1,100 @@
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "crc32c.hpp"
+
+// Checks both CRC-32C backends (slicing-by-8 table and the CPU instruction, when present) against
+// the standard check value and against each other, whole and in pieces.
+
+namespace {
+
+int failures = 0;
+
+void check(bool condition, const std::string& what) {
+    if (!condition) {
+        std::cerr << "FAIL: " << what << std::endl;
+        ++failures;
+    }
+}
+
+std::string hex(uint32_t value) {
+    std::ostringstream oss;
+    oss << "0x" << std::hex << std::setw(8) << std::setfill('0') << value;
+    return oss.str();
+}
+
+using Backend = uint32_t (*)(const void*, size_t, uint32_t);
+
+void test_check_value(Backend crc, const std::string& name) {
+    // CRC-32C check value (RFC 3720, B.4): the CRC of the ASCII digits "123456789"
+    const char* digits = "123456789";
+    const uint32_t value = crc(digits, 9, 0);
+    check(value == 0xE3069283, name + ": check value of \"123456789\" is 0xe3069283, got " + hex(value));
+    check(crc(digits, 0, 0) == 0, name + ": empty input");
+
+    // 32 zero bytes (RFC 3720, B.4)
+    const std::vector<uint8_t> zeros(32, 0);
+    check(crc(zeros.data(), zeros.size(), 0) == 0x8A9136AA, name + ": 32 zero bytes");
+}
+
+void test_pieces(Backend crc, const std::string& name) {
+    std::mt19937_64 rng(3);
+    std::vector<uint8_t> buffer(4099);
+    for (uint8_t& byte : buffer) {
+        byte = static_cast<uint8_t>(rng());
+    }
+    const uint32_t whole = crc(buffer.data(), buffer.size(), 0);
+    bool same = true;
+    for (size_t cut : {size_t(0), size_t(1), size_t(7), size_t(8), size_t(13), size_t(2048), buffer.size()}) {
+        uint32_t first = crc(buffer.data(), cut, 0);
+        same = same && crc(buffer.data() + cut, buffer.size() - cut, first) == whole;
+    }
+    check(same, name + ": checksum in pieces equals the checksum of the whole buffer");
+}
+
+void test_backends_agree() {
+    if (!crc32c_have_hardware()) {
+        std::cout << "crc32c_test: no CRC-32C instruction on this CPU, hardware backend not checked" << std::endl;
+        return;
+    }
+    // Every length up to a few words, at every alignment, so the 8-byte loop and the byte tail both run
+    std::mt19937_64 rng(5);
+    std::vector<uint8_t> buffer(1024 + 8);
+    for (uint8_t& byte : buffer) {
+        byte = static_cast<uint8_t>(rng());
+    }
+    bool same = true;
+    for (size_t align = 0; align < 8; ++align) {
+        for (size_t size = 0; size <= 1024; size += (size < 64 ? 1 : 61)) {
+            uint32_t seed = static_cast<uint32_t>(rng());
+            same = same && crc32c_table(buffer.data() + align, size, seed) ==
+                           crc32c_hardware(buffer.data() + align, size, seed);
+        }
+    }
+    check(same, "table and hardware backends agree on random buffers");
+    check(crc32c(buffer.data(), buffer.size()) == crc32c_table(buffer.data(), buffer.size()),
+          "crc32c() agrees with the table backend");
+}
+
+} // namespace
+
+int main() {
+    test_check_value(crc32c_table, "table");
+    test_pieces(crc32c_table, "table");
+    if (crc32c_have_hardware()) {
+        test_check_value(crc32c_hardware, "hardware");
+        test_pieces(crc32c_hardware, "hardware");
+    }
+    test_check_value(crc32c, std::string("crc32c (") + crc32c_backend() + ")");
+    test_backends_agree();
+    if (failures > 0) {
+        std::cerr << failures << " check(s) failed" << std::endl;
+        return 1;
+    }
+    std::cout << "crc32c_test: all checks passed (" << crc32c_backend() << " backend)" << std::endl;
+    return 0;
+}
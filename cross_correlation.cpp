@@ -0,0 +1,202 @@
+#include "cross_correlation.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <complex>
+#include <sstream>
+
+namespace {
+
+using Complex = std::complex<double>;
+
+// In-place iterative radix-2 FFT; `inverse` computes the unscaled inverse transform
+void fft(std::vector<Complex>& data, bool inverse) {
+    const size_t n = data.size();
+    for (size_t i = 1, j = 0; i < n; ++i) {
+        size_t bit = n >> 1;
+        for (; j & bit; bit >>= 1) {
+            j ^= bit;
+        }
+        j ^= bit;
+        if (i < j) {
+            std::swap(data[i], data[j]);
+        }
+    }
+    for (size_t len = 2; len <= n; len <<= 1) {
+        const double angle = 2.0 * M_PI / static_cast<double>(len) * (inverse ? 1.0 : -1.0);
+        const Complex step(std::cos(angle), std::sin(angle));
+        const size_t half = len / 2;
+        // Twiddles for this stage, computed once and shared by all butterflies of the stage
+        std::vector<Complex> twiddle(half);
+        twiddle[0] = 1.0;
+        for (size_t k = 1; k < half; ++k) {
+            twiddle[k] = (k % 64 == 0) ? std::polar(1.0, angle * static_cast<double>(k)) : twiddle[k - 1] * step;
+        }
+        for (size_t i = 0; i < n; i += len) {
+            for (size_t k = 0; k < half; ++k) {
+                Complex u = data[i + k];
+                Complex v = data[i + k + half] * twiddle[k];
+                data[i + k] = u + v;
+                data[i + k + half] = u - v;
+            }
+        }
+    }
+}
+
+size_t next_power_of_two(size_t value) {
+    size_t n = 1;
+    while (n < value) {
+        n <<= 1;
+    }
+    return n;
+}
+
+} // namespace
+
+CrossCorrelationResult estimate_clock_offset(const std::vector<uint64_t>& master,
+                                             const std::vector<uint64_t>& slave,
+                                             const CrossCorrelationConfig& config) {
+    auto start_time = std::chrono::steady_clock::now();
+    CrossCorrelationResult result;
+    result.master_events = master.size();
+    result.slave_events = slave.size();
+    auto finish = [&](const std::string& message) {
+        result.message = message;
+        result.elapsed_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+        return result;
+    };
+
+    if (master.size() < 2 || slave.size() < 2) {
+        return finish("not enough events");
+    }
+    if (config.coarse_bin <= 0 || config.fine_bin <= 0 || config.max_fft_size < 4) {
+        return finish("invalid configuration");
+    }
+
+    // --- Coarse pass: FFT cross-correlation of binned count series ---
+    const int64_t master_origin = static_cast<int64_t>(master.front());
+    const int64_t slave_origin = static_cast<int64_t>(slave.front());
+    const int64_t span = std::max(static_cast<int64_t>(master.back()) - master_origin,
+                                  static_cast<int64_t>(slave.back()) - slave_origin);
+    // The FFT must hold both series back to back so the circular correlation has no wrap-around
+    int64_t bin = config.coarse_bin;
+    const int64_t min_bin = (2 * (span + 1)) / static_cast<int64_t>(config.max_fft_size) + 1;
+    bin = std::max(bin, min_bin);
+    const size_t series_bins = static_cast<size_t>(span / bin) + 1;
+    const size_t n = next_power_of_two(2 * series_bins);
+    result.coarse_bin = bin;
+
+    // Pack master counts into the real part and slave counts into the imaginary part so one
+    // forward transform yields both spectra
+    std::vector<Complex> series(n);
+    for (uint64_t ts : master) {
+        series[static_cast<size_t>((static_cast<int64_t>(ts) - master_origin) / bin)] += Complex(1.0, 0.0);
+    }
+    for (uint64_t ts : slave) {
+        series[static_cast<size_t>((static_cast<int64_t>(ts) - slave_origin) / bin)] += Complex(0.0, 1.0);
+    }
+    // Remove the means over the occupied bins so the flat accidental background does not favour
+    // lags with the largest overlap
+    const double master_mean = static_cast<double>(master.size()) / static_cast<double>(series_bins);
+    const double slave_mean = static_cast<double>(slave.size()) / static_cast<double>(series_bins);
+    for (size_t k = 0; k < series_bins; ++k) {
+        series[k] -= Complex(master_mean, slave_mean);
+    }
+    fft(series, false);
+
+    // Cross spectrum conj(A) * B, with A and B separated from the packed transform
+    std::vector<Complex> cross(n);
+    for (size_t k = 0; k < n; ++k) {
+        Complex z = series[k];
+        Complex z_mirror = std::conj(series[(n - k) & (n - 1)]);
+        Complex a = (z + z_mirror) * 0.5;
+        Complex b = (z - z_mirror) * Complex(0.0, -0.5);
+        cross[k] = std::conj(a) * b;
+    }
+    fft(cross, true);
+
+    // Peak over the allowed lags (lag l: slave bin k + l pairs with master bin k)
+    const int64_t max_lag = config.max_offset > 0
+        ? std::min<int64_t>(config.max_offset / bin + 1, static_cast<int64_t>(n / 2) - 1)
+        : static_cast<int64_t>(n / 2) - 1;
+    int64_t best_lag = 0;
+    double best_value = -1e300;
+    for (int64_t lag = -max_lag; lag <= max_lag; ++lag) {
+        double value = cross[static_cast<size_t>(lag) & (n - 1)].real();
+        if (value > best_value) {
+            best_value = value;
+            best_lag = lag;
+        }
+    }
+    // slave_time - master_time = (slave_origin - master_origin) + (slave_rel - master_rel)
+    // and slave_rel ~ master_rel + lag * bin (slave bin k + lag pairs with master bin k)
+    const int64_t coarse_offset = (slave_origin - master_origin) + best_lag * bin;
+    result.coarse_offset = coarse_offset;
+
+    // --- Fine pass: time-difference histogram around the coarse offset ---
+    const int64_t half_window = 2 * bin;
+    const int64_t fine_bin = std::min(config.fine_bin, bin);
+    const size_t fine_bins = static_cast<size_t>((2 * half_window) / fine_bin);
+    std::vector<uint64_t> histogram(fine_bins, 0);
+    size_t first = 0;
+    for (uint64_t m : master) {
+        const int64_t low = static_cast<int64_t>(m) + coarse_offset - half_window;
+        while (first < slave.size() && static_cast<int64_t>(slave[first]) < low) {
+            ++first;
+        }
+        for (size_t j = first; j < slave.size(); ++j) {
+            const int64_t index = (static_cast<int64_t>(slave[j]) - low) / fine_bin;
+            if (index >= static_cast<int64_t>(fine_bins)) {
+                break;
+            }
+            ++histogram[static_cast<size_t>(index)];
+        }
+    }
+
+    const size_t peak = static_cast<size_t>(std::max_element(histogram.begin(), histogram.end()) - histogram.begin());
+    // Background: median bin count (robust against the peak itself)
+    std::vector<uint64_t> sorted_counts(histogram);
+    std::nth_element(sorted_counts.begin(), sorted_counts.begin() + sorted_counts.size() / 2, sorted_counts.end());
+    const double background = static_cast<double>(sorted_counts[sorted_counts.size() / 2]);
+    result.background = background;
+    result.significance = (static_cast<double>(histogram[peak]) - background) / std::sqrt(std::max(background, 1.0));
+
+    // Background-subtracted centroid around the peak
+    const size_t low_bin = peak >= static_cast<size_t>(config.centroid_half_width) ? peak - config.centroid_half_width : 0;
+    const size_t high_bin = std::min(fine_bins - 1, peak + config.centroid_half_width);
+    double weight_sum = 0.0;
+    double weighted_position = 0.0;
+    uint64_t peak_counts = 0;
+    for (size_t i = low_bin; i <= high_bin; ++i) {
+        double weight = std::max(0.0, static_cast<double>(histogram[i]) - background);
+        double center = -static_cast<double>(half_window) + (static_cast<double>(i) + 0.5) * static_cast<double>(fine_bin);
+        weight_sum += weight;
+        weighted_position += weight * center;
+        peak_counts += histogram[i];
+    }
+    result.peak_counts = peak_counts;
+
+    if (weight_sum <= 0.0 || result.significance < config.min_significance) {
+        result.offset = static_cast<double>(coarse_offset);
+        return finish("no significant correlation peak");
+    }
+    result.offset = static_cast<double>(coarse_offset) + weighted_position / weight_sum;
+    result.found = true;
+    return finish("");
+}
+
+std::string CrossCorrelationResult::summary() const {
+    std::ostringstream oss;
+    oss << std::fixed;
+    oss.precision(1);
+    if (found) {
+        oss << "offset " << offset << " (coarse " << coarse_offset << ", coarse bin " << coarse_bin << ")"
+            << ", peak " << peak_counts << " counts over background " << background
+            << " (" << significance << " sigma)";
+    } else {
+        oss << "no offset found: " << message;
+    }
+    oss << ", " << master_events << " master / " << slave_events << " slave events, "
+        << elapsed_seconds << " s";
+    return oss.str();
+}
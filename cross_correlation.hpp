@@ -0,0 +1,57 @@
+#ifndef CROSS_CORRELATION_HPP
+#define CROSS_CORRELATION_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Clock-offset estimation between two time-ordered timestamp streams (e.g. master and slave Time
+// Controllers observing correlated events), based on the cross-correlation of their event trains.
+//
+// 1. Coarse: both streams are binned into count series (each relative to its own first event) and
+//    cross-correlated with an FFT; the peak gives the offset to within one coarse bin.
+// 2. Fine: a time-difference histogram (slave - master - coarse offset) with fine bins is built with
+//    a two-pointer sweep restricted to a few coarse bins around the peak.
+// 3. The background-subtracted centroid of the fine peak gives a sub-bin estimate.
+//
+// All values are in timestamp units (picoseconds for Time Controller data).
+
+struct CrossCorrelationConfig {
+    // Only offsets within +/- max_offset of the streams' first-event difference are searched
+    // (0: any lag the data allows)
+    int64_t max_offset = 0;
+    // Smallest coarse bin; widened automatically so the FFT stays within max_fft_size
+    int64_t coarse_bin = 1000;
+    // Fine histogram bin
+    int64_t fine_bin = 50;
+    // Largest FFT (power of two) used for the coarse pass
+    size_t max_fft_size = size_t(1) << 21;
+    // Bins on each side of the fine peak used for the centroid
+    int centroid_half_width = 3;
+    // Minimum peak significance, in standard deviations over the background, to accept a result
+    double min_significance = 5.0;
+};
+
+struct CrossCorrelationResult {
+    bool found = false;
+    double offset = 0.0;              // slave - master, i.e. slave_time ~ master_time + offset
+    int64_t coarse_offset = 0;
+    int64_t coarse_bin = 0;           // coarse bin actually used
+    uint64_t peak_counts = 0;         // coincidences in the fine peak window
+    double background = 0.0;          // mean fine-bin count away from the peak
+    double significance = 0.0;        // (peak bin - background) / sqrt(background)
+    size_t master_events = 0;
+    size_t slave_events = 0;
+    double elapsed_seconds = 0.0;
+    std::string message;              // reason when !found
+
+    std::string summary() const;
+};
+
+// Both inputs must be sorted ascending
+CrossCorrelationResult estimate_clock_offset(const std::vector<uint64_t>& master,
+                                             const std::vector<uint64_t>& slave,
+                                             const CrossCorrelationConfig& config = CrossCorrelationConfig());
+
+#endif // CROSS_CORRELATION_HPP
@@ -0,0 +1,99 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include "cross_correlation.hpp"
+
+// Checks estimate_clock_offset on synthetic streams: a slave that sees a fraction of the master's
+// events shifted by a known offset with timing jitter, among uncorrelated background on both sides,
+// must give that offset to within a few fine bins; independent streams must give no result.
+
+namespace {
+
+int failures = 0;
+
+void check(bool condition, const std::string& what) {
+    if (!condition) {
+        std::cerr << "FAIL: " << what << std::endl;
+        ++failures;
+    }
+}
+
+// Poisson process with the given mean gap (ps), starting at `origin`
+std::vector<uint64_t> poisson_events(std::mt19937_64& rng, size_t count, double mean_gap, uint64_t origin) {
+    std::exponential_distribution<double> gap(1.0 / mean_gap);
+    std::vector<uint64_t> events(count);
+    double t = static_cast<double>(origin);
+    for (uint64_t& event : events) {
+        t += gap(rng);
+        event = static_cast<uint64_t>(t);
+    }
+    return events;
+}
+
+// Add `background` events spread uniformly over the span of `events`, and sort
+void add_background(std::mt19937_64& rng, std::vector<uint64_t>& events, size_t background) {
+    std::uniform_int_distribution<uint64_t> anywhere(events.front(), events.back());
+    for (size_t i = 0; i < background; ++i) {
+        events.push_back(anywhere(rng));
+    }
+    std::sort(events.begin(), events.end());
+}
+
+void test_known_offset(int64_t offset, double jitter_ps, uint64_t seed) {
+    const std::string what = "offset " + std::to_string(offset) + " ps";
+    std::mt19937_64 rng(seed);
+    std::normal_distribution<double> jitter(0.0, jitter_ps);
+    std::bernoulli_distribution detected(0.5);
+
+    // 20000 events at 1 per microsecond on average; the slave detects half of them
+    std::vector<uint64_t> master = poisson_events(rng, 20000, 1e6, 1000000000ULL);
+    std::vector<uint64_t> slave;
+    for (uint64_t m : master) {
+        if (detected(rng)) {
+            slave.push_back(static_cast<uint64_t>(static_cast<int64_t>(m) + offset + std::llround(jitter(rng))));
+        }
+    }
+    add_background(rng, master, 10000);
+    add_background(rng, slave, 10000);
+
+    CrossCorrelationConfig config;
+    const CrossCorrelationResult result = estimate_clock_offset(master, slave, config);
+    check(result.found, what + ": found (" + result.summary() + ")");
+    check(std::abs(result.offset - static_cast<double>(offset)) <= 3.0 * config.fine_bin,
+          what + ": estimate within three fine bins (" + result.summary() + ")");
+    check(result.significance >= config.min_significance, what + ": significant peak");
+    check(result.master_events == master.size() && result.slave_events == slave.size(), what + ": event counts");
+}
+
+void test_no_correlation() {
+    // Dense enough for a background of a few tens of counts per fine bin: with only a count or two
+    // per bin, a chance cluster of a handful of events can look significant
+    std::mt19937_64 rng(21);
+    std::vector<uint64_t> master = poisson_events(rng, 100000, 2e5, 1000000000ULL);
+    std::vector<uint64_t> slave = poisson_events(rng, 100000, 2e5, 1000000000ULL + 12345678);
+    const CrossCorrelationResult result = estimate_clock_offset(master, slave);
+    check(!result.found, "independent streams: no offset found (" + result.summary() + ")");
+    check(!result.message.empty(), "independent streams: reason given");
+
+    const CrossCorrelationResult too_few = estimate_clock_offset({5}, slave);
+    check(!too_few.found && too_few.message == "not enough events", "single master event: not enough events");
+}
+
+} // namespace
+
+int main() {
+    test_known_offset(3456789, 60.0, 1);             // slave clock ahead
+    test_known_offset(-987654321, 100.0, 2);         // slave clock behind by about a millisecond
+    test_known_offset(12, 20.0, 3);                  // clocks nearly aligned
+    test_no_correlation();
+    if (failures > 0) {
+        std::cerr << failures << " check(s) failed" << std::endl;
+        return 1;
+    }
+    std::cout << "cross_correlation_test: all checks passed" << std::endl;
+    return 0;
+}
@@ -0,0 +1,439 @@
+#include "file_transfer.hpp"
+#include "crc32c.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <deque>
+#include <fcntl.h>
+#include <sstream>
+#include <stdexcept>
+#include <unistd.h>
+
+namespace {
+
+void put_u32(uint8_t* out, uint32_t value) { std::memcpy(out, &value, sizeof(value)); }
+void put_u64(uint8_t* out, uint64_t value) { std::memcpy(out, &value, sizeof(value)); }
+uint32_t get_u32(const uint8_t* in) { uint32_t value; std::memcpy(&value, in, sizeof(value)); return value; }
+uint64_t get_u64(const uint8_t* in) { uint64_t value; std::memcpy(&value, in, sizeof(value)); return value; }
+
+double seconds_since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Receive one [header][payload] chunk; false on timeout before the header
+bool recv_chunk(zmq::socket_t& socket, FileChunkHeader& header, zmq::message_t& payload) {
+    zmq::message_t header_msg;
+    if (!socket.recv(header_msg, zmq::recv_flags::none).has_value()) {
+        return false;
+    }
+    header = FileChunkHeader::decode(header_msg.data(), header_msg.size());
+    if (!header_msg.more()) {
+        throw std::runtime_error("File chunk without payload");
+    }
+    if (!socket.recv(payload, zmq::recv_flags::none).has_value()) {
+        throw std::runtime_error("Timed out receiving file chunk payload");
+    }
+    if (payload.size() != header.size) {
+        throw std::runtime_error("File chunk payload size mismatch");
+    }
+    return true;
+}
+
+} // namespace
+
+const char* file_kind_name(FileKind kind) {
+    switch (kind) {
+        case FileKind::PartialData: return "partial data";
+        case FileKind::FullData: return "full data";
+        case FileKind::TextData: return "text data";
+        default: return "unknown";
+    }
+}
+
+void FileDescriptor::encode(void* out) const {
+    uint8_t* p = static_cast<uint8_t*>(out);
+    p[0] = static_cast<uint8_t>(kind);
+    p[1] = 0;
+    std::memcpy(p + 2, &format_version, sizeof(format_version));
+    put_u32(p + 4, sequence);
+    put_u64(p + 8, channel_mask);
+    put_u64(p + 16, record_count);
+}
+
+FileDescriptor FileDescriptor::decode(const void* data) {
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    FileDescriptor descriptor;
+    descriptor.kind = static_cast<FileKind>(p[0]);
+    std::memcpy(&descriptor.format_version, p + 2, sizeof(descriptor.format_version));
+    descriptor.sequence = get_u32(p + 4);
+    descriptor.channel_mask = get_u64(p + 8);
+    descriptor.record_count = get_u64(p + 16);
+    return descriptor;
+}
+
+void FileChunkHeader::encode(void* out) const {
+    uint8_t* p = static_cast<uint8_t*>(out);
+    put_u32(p, magic);
+    put_u32(p + 4, flags);
+    put_u64(p + 8, transfer_id);
+    put_u64(p + 16, offset);
+    put_u64(p + 24, total_size);
+    put_u32(p + 32, size);
+    put_u32(p + 36, index);
+    put_u32(p + 40, chunk_size);
+    put_u32(p + 44, crc);
+    descriptor.encode(p + 48);
+}
+
+FileChunkHeader FileChunkHeader::decode(const void* data, size_t size) {
+    if (size < kEncodedSize) {
+        throw std::runtime_error("File chunk header too short");
+    }
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    FileChunkHeader header;
+    header.magic = get_u32(p);
+    if (header.magic != kMagic) {
+        throw std::runtime_error("Not a file chunk header");
+    }
+    header.flags = get_u32(p + 4);
+    header.transfer_id = get_u64(p + 8);
+    header.offset = get_u64(p + 16);
+    header.total_size = get_u64(p + 24);
+    header.size = get_u32(p + 32);
+    header.index = get_u32(p + 36);
+    header.chunk_size = get_u32(p + 40);
+    header.crc = get_u32(p + 44);
+    header.descriptor = FileDescriptor::decode(p + 48);
+    return header;
+}
+
+void FileChunkCredit::encode(void* out) const {
+    uint8_t* p = static_cast<uint8_t*>(out);
+    put_u64(p, transfer_id);
+    put_u64(p + 8, offset);
+    put_u32(p + 16, flags);
+    put_u32(p + 20, 0);
+}
+
+FileChunkCredit FileChunkCredit::decode(const void* data, size_t size) {
+    if (size < kEncodedSize) {
+        throw std::runtime_error("File chunk credit too short");
+    }
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    FileChunkCredit credit;
+    credit.transfer_id = get_u64(p);
+    credit.offset = get_u64(p + 8);
+    credit.flags = get_u32(p + 16);
+    return credit;
+}
+
+std::string FileTransferStats::summary() const {
+    std::ostringstream oss;
+    oss.setf(std::ios::fixed);
+    oss.precision(1);
+    oss << bytes << " bytes in " << chunks << " chunks, " << seconds << " s (" << throughput_mbps() << " MB/s)";
+    if (resent_chunks > 0) {
+        oss << ", " << resent_chunks << " chunks resent";
+    }
+    if (checksum_errors > 0) {
+        oss << ", " << checksum_errors << " checksum errors";
+    }
+    return oss.str();
+}
+
+uint64_t ReceivedFile::resume_offset() const {
+    for (size_t i = 0; i < written.size(); ++i) {
+        if (!written[i]) {
+            return static_cast<uint64_t>(i) * chunk_size;
+        }
+    }
+    return total_size;
+}
+
+FileSender::FileSender(zmq::socket_t& data_socket_, zmq::socket_t& credit_socket_, const FileTransferConfig& config_)
+    : data_socket(data_socket_), credit_socket(credit_socket_), config(config_)
+{
+    if (config.chunk_size == 0 || config.chunk_size > UINT32_MAX || config.window == 0) {
+        throw std::invalid_argument("Invalid file transfer configuration");
+    }
+}
+
+uint64_t FileSender::new_transfer_id() {
+    static std::atomic<uint64_t> counter{0};
+    uint64_t now = static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+    return (now << 8) ^ (static_cast<uint64_t>(::getpid()) << 40) ^ ++counter;
+}
+
+FileTransferStats FileSender::send(std::vector<OutgoingFile>& files) {
+    auto start = std::chrono::steady_clock::now();
+
+    // Per-transfer state; chunks of all transfers share the sockets
+    struct Job {
+        OutgoingFile* file = nullptr;
+        int fd = -1;
+        uint64_t total_size = 0;
+        uint64_t next_offset = 0;
+        unsigned in_flight = 0;
+        std::deque<uint64_t> resend;   // offsets of rejected chunks
+        bool announce_empty = false;   // an empty file still goes out as one zero-size last chunk
+
+        bool has_chunk() const { return next_offset < total_size || announce_empty || !resend.empty(); }
+        bool finished() const { return !has_chunk() && in_flight == 0; }
+    };
+    std::vector<Job> jobs(files.size());
+    struct JobsGuard {
+        std::vector<Job>& jobs;
+        ~JobsGuard() { for (Job& job : jobs) if (job.fd >= 0) ::close(job.fd); }
+    } guard{jobs};
+
+    for (size_t i = 0; i < files.size(); ++i) {
+        OutgoingFile& file = files[i];
+        Job& job = jobs[i];
+        job.file = &file;
+        if (file.transfer_id == 0) {
+            file.transfer_id = new_transfer_id();
+        }
+        if (file.start_offset % config.chunk_size != 0) {
+            throw std::invalid_argument("Transfer start offset is not a multiple of the chunk size");
+        }
+        job.fd = ::open(file.path.c_str(), O_RDONLY);
+        if (job.fd < 0) {
+            throw std::runtime_error("Could not open file: " + file.path);
+        }
+        off_t end = ::lseek(job.fd, 0, SEEK_END);
+        if (end < 0) {
+            throw std::runtime_error("Could not determine size of file: " + file.path);
+        }
+        job.total_size = static_cast<uint64_t>(end);
+        job.announce_empty = job.total_size == 0;
+        job.next_offset = file.start_offset;
+        ::posix_fadvise(job.fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    }
+
+    FileTransferStats stats;
+    credit_socket.set(zmq::sockopt::rcvtimeo, config.credit_timeout_ms);
+    auto take_credit = [&]() {
+        zmq::message_t msg;
+        if (!credit_socket.recv(msg, zmq::recv_flags::none).has_value()) {
+            throw std::runtime_error("Timed out waiting for transfer credit from master");
+        }
+        FileChunkCredit credit = FileChunkCredit::decode(msg.data(), msg.size());
+        for (Job& job : jobs) {
+            if (job.file->transfer_id != credit.transfer_id || job.in_flight == 0) {
+                continue;
+            }
+            --job.in_flight;
+            if (credit.flags & FileChunkCredit::kRejected) {
+                if (stats.resent_chunks + job.resend.size() >= config.max_resends) {
+                    throw std::runtime_error("Too many rejected chunks sending " + job.file->path);
+                }
+                job.resend.push_back(credit.offset);
+            }
+            return;
+        }
+        // Credits of earlier (abandoned) transfers are dropped
+    };
+
+    size_t turn = 0;
+    while (!std::all_of(jobs.begin(), jobs.end(), [](const Job& job) { return job.finished(); })) {
+        // Round-robin over the transfers that may send; wait for a credit when none can
+        Job* job = nullptr;
+        for (size_t k = 0; k < jobs.size(); ++k) {
+            Job& candidate = jobs[(turn + k) % jobs.size()];
+            if (candidate.has_chunk() && candidate.in_flight < config.window) {
+                job = &candidate;
+                turn = (turn + k + 1) % jobs.size();
+                break;
+            }
+        }
+        if (job == nullptr) {
+            take_credit();
+            continue;
+        }
+
+        const bool is_resend = !job->resend.empty();
+        const uint64_t offset = is_resend ? job->resend.front() : job->next_offset;
+        if (is_resend) {
+            job->resend.pop_front();
+        }
+
+        FileChunkHeader header;
+        header.transfer_id = job->file->transfer_id;
+        header.total_size = job->total_size;
+        header.offset = offset;
+        header.chunk_size = static_cast<uint32_t>(config.chunk_size);
+        header.index = static_cast<uint32_t>(offset / config.chunk_size);
+        header.size = static_cast<uint32_t>(std::min<uint64_t>(config.chunk_size, job->total_size - offset));
+        header.flags = offset + header.size == job->total_size ? FileChunkHeader::kLastChunk : 0;
+        header.descriptor = job->file->descriptor;
+
+        // Read straight into the message buffer; ZeroMQ takes ownership of it on send
+        zmq::message_t payload(header.size);
+        size_t done = 0;
+        while (done < header.size) {
+            ssize_t n = ::pread(job->fd, static_cast<char*>(payload.data()) + done, header.size - done,
+                                static_cast<off_t>(offset + done));
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n <= 0) {
+                throw std::runtime_error("Failed to read file content: " + job->file->path);
+            }
+            done += static_cast<size_t>(n);
+        }
+        header.crc = crc32c(payload.data(), payload.size());
+
+        zmq::message_t header_msg(FileChunkHeader::kEncodedSize);
+        header.encode(header_msg.data());
+        if (!data_socket.send(header_msg, zmq::send_flags::sndmore).has_value() ||
+            !data_socket.send(payload, zmq::send_flags::none).has_value()) {
+            throw std::runtime_error("Failed to send file chunk to master");
+        }
+        ++job->in_flight;
+        job->announce_empty = false;
+        if (is_resend) {
+            ++stats.resent_chunks;
+        } else {
+            job->next_offset += header.size;
+            ++stats.chunks;
+            stats.bytes += header.size;
+        }
+    }
+    stats.seconds = seconds_since(start);
+    return stats;
+}
+
+FileReceiver::FileReceiver(zmq::socket_t& data_socket_, zmq::socket_t& credit_socket_, PathSelector select_path_)
+    : data_socket(data_socket_), credit_socket(credit_socket_), select_path(std::move(select_path_))
+{
+}
+
+FileReceiver::~FileReceiver() {
+    for (auto& entry : active) {
+        close_file(entry.second);
+    }
+}
+
+void FileReceiver::close_file(Active& transfer) {
+    if (transfer.fd >= 0) {
+        ::close(transfer.fd);
+        transfer.fd = -1;
+    }
+}
+
+void FileReceiver::send_credit(uint64_t transfer_id, uint64_t offset, uint32_t flags) {
+    FileChunkCredit credit;
+    credit.transfer_id = transfer_id;
+    credit.offset = offset;
+    credit.flags = flags;
+    zmq::message_t msg(FileChunkCredit::kEncodedSize);
+    credit.encode(msg.data());
+    // A lost credit only makes the sender time out; never block the receiver on it
+    credit_socket.send(msg, zmq::send_flags::dontwait);
+}
+
+bool FileReceiver::poll(std::vector<ReceivedFile>& completed) {
+    FileChunkHeader header;
+    zmq::message_t payload;
+    if (!recv_chunk(data_socket, header, payload)) {
+        return false;
+    }
+
+    auto it = active.find(header.transfer_id);
+    if (it == active.end()) {
+        // Only the first chunk starts a transfer; anything else belongs to an abandoned attempt
+        if (header.offset != 0 || retired.count(header.transfer_id) != 0) {
+            return true;
+        }
+        // An empty file arrives as a single zero-size chunk flagged as the last one
+        if (header.chunk_size == 0 ||
+            (header.total_size == 0 && (header.size != 0 || !(header.flags & FileChunkHeader::kLastChunk)))) {
+            throw std::runtime_error("Invalid file chunk header");
+        }
+        Active transfer;
+        transfer.file.transfer_id = header.transfer_id;
+        transfer.file.descriptor = header.descriptor;
+        transfer.file.total_size = header.total_size;
+        transfer.file.chunk_size = header.chunk_size;
+        transfer.file.written.assign(std::max<size_t>(1, static_cast<size_t>((header.total_size + header.chunk_size - 1) / header.chunk_size)), false);
+        transfer.file.path = select_path(header);
+        transfer.started = std::chrono::steady_clock::now();
+        transfer.fd = ::open(transfer.file.path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (transfer.fd < 0) {
+            throw std::runtime_error("Failed to open file for writing: " + transfer.file.path);
+        }
+        it = active.emplace(header.transfer_id, std::move(transfer)).first;
+    }
+
+    ReceivedFile& file = it->second.file;
+    if (header.chunk_size != file.chunk_size || header.index >= file.written.size() ||
+        header.offset != static_cast<uint64_t>(header.index) * file.chunk_size ||
+        header.offset + header.size > file.total_size) {
+        throw std::runtime_error("Inconsistent file chunk for " + file.path);
+    }
+    if (crc32c(payload.data(), payload.size()) != header.crc) {
+        ++file.stats.checksum_errors;
+        send_credit(header.transfer_id, header.offset, FileChunkCredit::kRejected);
+        return true;
+    }
+    size_t done = 0;
+    while (done < header.size) {
+        ssize_t n = ::pwrite(it->second.fd, static_cast<const char*>(payload.data()) + done, header.size - done,
+                             static_cast<off_t>(header.offset + done));
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            throw std::runtime_error("Failed to write received chunk to " + file.path + ": " + std::strerror(errno));
+        }
+        done += static_cast<size_t>(n);
+    }
+    send_credit(header.transfer_id, header.offset, 0);
+    if (!file.written[header.index]) {
+        file.written[header.index] = true;
+        file.bytes_written += header.size;
+        ++file.stats.chunks;
+    }
+
+    if (file.bytes_written == file.total_size) {
+        close_file(it->second);
+        file.complete = true;
+        file.stats.bytes = file.bytes_written;
+        file.stats.seconds = seconds_since(it->second.started);
+        completed.push_back(std::move(file));
+        retired.insert(it->first);
+        active.erase(it);
+    }
+    return true;
+}
+
+std::vector<ReceivedFile> FileReceiver::incomplete() const {
+    std::vector<ReceivedFile> files;
+    for (const auto& entry : active) {
+        files.push_back(entry.second.file);
+    }
+    return files;
+}
+
+void FileReceiver::resume(uint64_t transfer_id, uint64_t resume_id) {
+    auto it = active.find(transfer_id);
+    if (it == active.end() || resume_id == transfer_id) {
+        return;
+    }
+    Active transfer = std::move(it->second);
+    active.erase(it);
+    retired.insert(transfer_id);
+    transfer.file.transfer_id = resume_id;
+    active.emplace(resume_id, std::move(transfer));
+}
+
+void FileReceiver::abandon(uint64_t transfer_id) {
+    auto it = active.find(transfer_id);
+    if (it != active.end()) {
+        close_file(it->second);
+        active.erase(it);
+        retired.insert(transfer_id);
+    }
+}
@@ -0,0 +1,195 @@
+#ifndef FILE_TRANSFER_HPP
+#define FILE_TRANSFER_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+#include <zmq.hpp>
+
+// Chunked file transfer between slave and master over ZeroMQ.
+//
+// A file is sent as a sequence of two-part messages on the data socket (PUSH -> PULL):
+//   [FileChunkHeader (72 bytes)][payload (header.size bytes)]
+// Every chunk carries its byte offset, the total file size, a CRC-32C of the payload and a
+// FileDescriptor saying what the file is (kind, acquisition sequence, channels, record count and
+// format version), so the receiver can route it and write it in place (pwrite) as soon as it
+// arrives. Chunks of several transfers may be interleaved on the socket; they are told apart by
+// transfer id. An empty file (e.g. an acquisition without events) is a single zero-size chunk
+// flagged kLastChunk.
+//
+// Flow control is credit based: each transfer may have at most `window` chunks unacknowledged. The
+// receiver returns one credit per chunk, on a separate socket (PUSH -> PULL in the other
+// direction); a credit flagged kRejected asks for the chunk again (checksum mismatch). The sender
+// waits for all credits before returning, so a completed send() means the master has the files
+// on disk.
+//
+// Interrupted transfers are resumed rather than restarted: the receiver keeps track of the chunks
+// it has written, and the master asks the slave (resume_transfer command) to send the file again
+// from ReceivedFile::resume_offset() under a new transfer id.
+
+enum class FileKind : uint8_t {
+    Unknown = 0,
+    PartialData = 1,   // leading part of the slave records, for the synchronization calculation
+    FullData = 2,      // all slave records (.bin)
+    TextData = 3,      // human-readable export (.txt)
+};
+
+const char* file_kind_name(FileKind kind);
+
+struct FileDescriptor {
+    static constexpr uint16_t kRecordFormat = 1;  // packed 12-byte records (uint64 timestamp, int32 channel)
+    static constexpr uint16_t kCompressedRecordFormat = 2;  // .tsc blocks, see timestamp_codec.hpp
+    static constexpr uint16_t kTextFormat = 3;    // one "channel;timestamp" line per event (write_merged_as_text)
+    static constexpr size_t kEncodedSize = 24;
+
+    FileKind kind = FileKind::Unknown;
+    uint16_t format_version = 0;
+    uint32_t sequence = 0;        // acquisition sequence the file belongs to
+    uint64_t channel_mask = 0;    // bit n set: channel n present
+    uint64_t record_count = 0;    // timestamps in the file (0: unknown)
+
+    void encode(void* out) const;
+    static FileDescriptor decode(const void* data);
+};
+
+struct FileChunkHeader {
+    static constexpr uint32_t kMagic = 0x43465454;  // "TTFC"
+    static constexpr uint32_t kLastChunk = 1u << 0;
+    static constexpr size_t kEncodedSize = 48 + FileDescriptor::kEncodedSize;
+
+    uint32_t magic = kMagic;
+    uint32_t flags = 0;
+    uint64_t transfer_id = 0;
+    uint64_t offset = 0;        // byte offset of the payload in the file
+    uint64_t total_size = 0;    // size of the whole file
+    uint32_t size = 0;          // payload bytes in this chunk
+    uint32_t index = 0;         // offset / chunk_size
+    uint32_t chunk_size = 0;    // nominal chunk size of the transfer (only the last chunk is shorter)
+    uint32_t crc = 0;           // CRC-32C of the payload
+    FileDescriptor descriptor;
+
+    void encode(void* out) const;
+    // Throws std::runtime_error on a short buffer or bad magic
+    static FileChunkHeader decode(const void* data, size_t size);
+};
+
+// Credit returned by the receiver for one chunk
+struct FileChunkCredit {
+    static constexpr uint32_t kRejected = 1u << 0;  // checksum mismatch, send the chunk again
+    static constexpr size_t kEncodedSize = 24;
+
+    uint64_t transfer_id = 0;
+    uint64_t offset = 0;
+    uint32_t flags = 0;
+
+    void encode(void* out) const;
+    static FileChunkCredit decode(const void* data, size_t size);
+};
+
+struct FileTransferConfig {
+    size_t chunk_size = size_t(1) << 20;  // payload bytes per chunk
+    unsigned window = 8;                  // chunks in flight per transfer before waiting for a credit
+    int credit_timeout_ms = 10000;        // give up when no credit arrives for this long
+    unsigned max_resends = 16;            // rejected chunks tolerated per send() before giving up
+};
+
+struct FileTransferStats {
+    uint64_t bytes = 0;
+    uint64_t chunks = 0;
+    uint64_t resent_chunks = 0;   // sender: chunks sent again after a rejection
+    uint64_t checksum_errors = 0; // receiver: chunks rejected for a CRC mismatch
+    double seconds = 0.0;
+
+    double throughput_mbps() const { return seconds > 0.0 ? bytes / seconds / 1e6 : 0.0; }
+    std::string summary() const;
+};
+
+struct OutgoingFile {
+    std::string path;
+    FileDescriptor descriptor;
+    uint64_t transfer_id = 0;     // 0: assigned by send()
+    uint64_t start_offset = 0;    // resume point, a multiple of the chunk size
+    bool temporary = false;       // the sender's caller deletes the file once it has been sent
+};
+
+class FileSender {
+public:
+    FileSender(zmq::socket_t& data_socket, zmq::socket_t& credit_socket,
+               const FileTransferConfig& config = FileTransferConfig());
+
+    // Send the files concurrently, interleaving their chunks on the data socket; assigns missing
+    // transfer ids. Throws std::runtime_error on I/O errors, a credit timeout or too many rejections.
+    FileTransferStats send(std::vector<OutgoingFile>& files);
+
+    // Reasonably unique per process and call, so credits of an abandoned transfer are not mistaken
+    // for credits of the next one
+    static uint64_t new_transfer_id();
+
+private:
+    zmq::socket_t& data_socket;
+    zmq::socket_t& credit_socket;
+    FileTransferConfig config;
+};
+
+struct ReceivedFile {
+    std::string path;
+    uint64_t transfer_id = 0;   // id of the latest (possibly resumed) attempt
+    FileDescriptor descriptor;
+    uint64_t total_size = 0;
+    uint64_t chunk_size = 0;
+    uint64_t bytes_written = 0; // payload bytes verified and on disk
+    bool complete = false;
+    std::vector<bool> written;  // per chunk index
+    FileTransferStats stats;
+
+    // First byte the sender has to send again after an interruption
+    uint64_t resume_offset() const;
+};
+
+class FileReceiver {
+public:
+    // Chooses the output path of a transfer from its first chunk
+    using PathSelector = std::function<std::string(const FileChunkHeader& first_chunk)>;
+
+    FileReceiver(zmq::socket_t& data_socket, zmq::socket_t& credit_socket, PathSelector select_path);
+    ~FileReceiver();
+
+    FileReceiver(const FileReceiver&) = delete;
+    FileReceiver& operator=(const FileReceiver&) = delete;
+
+    // Wait for the next chunk (up to the data socket's receive timeout), verify it and write it.
+    // Returns false on timeout. A file completed by the chunk is appended to `completed`.
+    // Throws std::runtime_error on write errors.
+    bool poll(std::vector<ReceivedFile>& completed);
+
+    // Transfers that have started but not completed (e.g. after poll() timed out)
+    std::vector<ReceivedFile> incomplete() const;
+    // Continue transfer `transfer_id` with the chunks the sender now sends under `resume_id`;
+    // chunks already on disk are rewritten harmlessly if they are sent again
+    void resume(uint64_t transfer_id, uint64_t resume_id);
+    // Stop tracking a transfer; the partial file stays on disk
+    void abandon(uint64_t transfer_id);
+
+private:
+    struct Active {
+        ReceivedFile file;
+        int fd = -1;
+        std::chrono::steady_clock::time_point started;
+    };
+
+    void send_credit(uint64_t transfer_id, uint64_t offset, uint32_t flags);
+    void close_file(Active& transfer);
+
+    zmq::socket_t& data_socket;
+    zmq::socket_t& credit_socket;
+    PathSelector select_path;
+    std::map<uint64_t, Active> active;
+    std::set<uint64_t> retired;   // ids of interrupted or abandoned attempts; late chunks are dropped
+};
+
+#endif // FILE_TRANSFER_HPP
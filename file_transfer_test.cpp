@@ -0,0 +1,316 @@
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+#include <zmq.hpp>
+#include "file_transfer.hpp"
+
+// Sends files with FileSender to a FileReceiver over an inproc PUSH/PULL pair (data one way,
+// credits the other), with the sender on its own thread as on the slave, and compares the
+// received files with the originals: several files at once, an empty file, a chunk corrupted on
+// the way (rejected and sent again), and a transfer interrupted and then resumed.
+
+namespace fs = std::filesystem;
+
+namespace {
+
+int failures = 0;
+
+void check(bool condition, const std::string& what) {
+    if (!condition) {
+        std::cerr << "FAIL: " << what << std::endl;
+        ++failures;
+    }
+}
+
+std::vector<char> read_file(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    return std::vector<char>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+void write_random_file(const std::string& path, size_t size, uint64_t seed) {
+    std::mt19937_64 rng(seed);
+    std::vector<char> bytes(size);
+    for (char& byte : bytes) {
+        byte = static_cast<char>(rng());
+    }
+    std::ofstream file(path, std::ios::binary);
+    file.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+}
+
+// Both ends of a transfer; the receiver side binds, as the master does. The data travels through
+// a proxy thread that can corrupt one chunk or stop forwarding, to stand in for a faulty link.
+struct Link {
+    static constexpr size_t kForwardAll = SIZE_MAX;
+
+    zmq::context_t context;
+    zmq::socket_t sender_data;
+    zmq::socket_t sender_credit;
+    zmq::socket_t receiver_data;
+    zmq::socket_t receiver_credit;
+    zmq::socket_t proxy_in;
+    zmq::socket_t proxy_out;
+    std::atomic<size_t> corrupt_chunk{kForwardAll};  // flip a payload byte of this chunk (counted from 0), once
+    std::atomic<size_t> forward_limit{kForwardAll};  // drop every chunk after this many have been forwarded
+    std::atomic<size_t> forwarded{0};
+    std::atomic<bool> stopping{false};
+    std::thread proxy;
+
+    explicit Link(const std::string& name)
+        : sender_data(context, zmq::socket_type::push), sender_credit(context, zmq::socket_type::pull),
+          receiver_data(context, zmq::socket_type::pull), receiver_credit(context, zmq::socket_type::push),
+          proxy_in(context, zmq::socket_type::pull), proxy_out(context, zmq::socket_type::push)
+    {
+        receiver_data.bind("inproc://" + name + "-data");
+        receiver_credit.bind("inproc://" + name + "-credit");
+        proxy_in.bind("inproc://" + name + "-proxy");
+        proxy_out.connect("inproc://" + name + "-data");
+        sender_data.connect("inproc://" + name + "-proxy");
+        sender_credit.connect("inproc://" + name + "-credit");
+        receiver_data.set(zmq::sockopt::rcvtimeo, 100);
+        proxy_in.set(zmq::sockopt::rcvtimeo, 50);
+        for (zmq::socket_t* socket : {&sender_data, &sender_credit, &receiver_data, &receiver_credit, &proxy_in, &proxy_out}) {
+            socket->set(zmq::sockopt::linger, 0);
+        }
+        proxy = std::thread(&Link::forward, this);
+    }
+
+    ~Link() {
+        stopping = true;
+        proxy.join();
+    }
+
+    void forward() {
+        size_t chunk = 0;
+        while (!stopping) {
+            zmq::message_t header;
+            if (!proxy_in.recv(header, zmq::recv_flags::none).has_value()) {
+                continue;
+            }
+            zmq::message_t payload;
+            if (!header.more() || !proxy_in.recv(payload, zmq::recv_flags::none).has_value()) {
+                continue;
+            }
+            if (forwarded >= forward_limit) {
+                continue;  // the link is down
+            }
+            if (chunk++ == corrupt_chunk && payload.size() > 0) {
+                static_cast<char*>(payload.data())[payload.size() / 2] ^= 0x10;
+                corrupt_chunk = kForwardAll;
+            }
+            proxy_out.send(header, zmq::send_flags::sndmore);
+            proxy_out.send(payload, zmq::send_flags::none);
+            ++forwarded;
+        }
+    }
+};
+
+// Send `files` on a thread while the receiver polls until `expected` files are complete or the
+// sender has given up; returns the completed files by transfer id
+std::map<uint64_t, ReceivedFile> transfer(Link& link, FileReceiver& receiver, std::vector<OutgoingFile>& files,
+                                          const FileTransferConfig& config, size_t expected,
+                                          FileTransferStats& sender_stats, std::string& sender_error) {
+    std::atomic<bool> sender_failed(false);
+    std::thread sender_thread([&]() {
+        try {
+            FileSender sender(link.sender_data, link.sender_credit, config);
+            sender_stats = sender.send(files);
+        } catch (const std::exception& e) {
+            sender_error = e.what();
+            sender_failed = true;
+        }
+    });
+
+    std::map<uint64_t, ReceivedFile> received;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(20);
+    while (received.size() < expected && std::chrono::steady_clock::now() < deadline) {
+        std::vector<ReceivedFile> completed;
+        if (!receiver.poll(completed) && sender_failed) {
+            break;  // nothing more is coming
+        }
+        for (ReceivedFile& file : completed) {
+            received[file.transfer_id] = std::move(file);
+        }
+    }
+    sender_thread.join();
+    return received;
+}
+
+void test_files_and_empty_file(const fs::path& dir) {
+    Link link("files");
+    FileReceiver receiver(link.receiver_data, link.receiver_credit, [&](const FileChunkHeader& first) {
+        return (dir / ("received_" + std::to_string(first.transfer_id))).string();
+    });
+
+    FileTransferConfig config;
+    config.chunk_size = 4096;
+    config.window = 2;  // several files and a small window: chunks interleave and wait for credits
+
+    const std::string multi = (dir / "multi.bin").string();
+    const std::string exact = (dir / "exact.bin").string();
+    const std::string empty = (dir / "empty.bin").string();
+    write_random_file(multi, 10 * config.chunk_size + 123, 1);
+    write_random_file(exact, 3 * config.chunk_size, 2);
+    write_random_file(empty, 0, 3);
+
+    std::vector<OutgoingFile> files(3);
+    files[0].path = multi;
+    files[1].path = exact;
+    files[2].path = empty;
+    for (size_t i = 0; i < files.size(); ++i) {
+        files[i].descriptor.kind = FileKind::FullData;
+        files[i].descriptor.format_version = FileDescriptor::kRecordFormat;
+        files[i].descriptor.sequence = static_cast<uint32_t>(40 + i);
+        files[i].descriptor.record_count = fs::file_size(files[i].path) / 12;
+    }
+
+    FileTransferStats stats;
+    std::string error;
+    std::map<uint64_t, ReceivedFile> received = transfer(link, receiver, files, config, files.size(), stats, error);
+    check(error.empty(), "files: sender succeeded (" + error + ")");
+    check(received.size() == files.size(), "files: every file completed");
+    check(stats.chunks == 11 + 3 + 1, "files: one chunk per started chunk size, and one for the empty file");
+    check(stats.bytes == fs::file_size(multi) + fs::file_size(exact), "files: sent bytes");
+    check(receiver.incomplete().empty(), "files: nothing left incomplete");
+
+    for (const OutgoingFile& file : files) {
+        const std::string name = fs::path(file.path).filename().string();
+        auto it = received.find(file.transfer_id);
+        if (it == received.end()) {
+            check(false, name + ": received");
+            continue;
+        }
+        const ReceivedFile& got = it->second;
+        check(got.complete && got.total_size == fs::file_size(file.path), name + ": complete with the right size");
+        check(got.descriptor.kind == FileKind::FullData && got.descriptor.sequence == file.descriptor.sequence &&
+              got.descriptor.record_count == file.descriptor.record_count, name + ": descriptor");
+        check(fs::exists(got.path) && read_file(got.path) == read_file(file.path), name + ": contents");
+        check(got.resume_offset() == got.total_size, name + ": nothing to resume");
+    }
+}
+
+void test_resume_offset() {
+    ReceivedFile file;
+    file.total_size = 350;
+    file.chunk_size = 100;
+    file.written = {true, true, false, true};
+    check(file.resume_offset() == 200, "resume_offset: first chunk not yet written");
+    file.written = {false, true, true, true};
+    check(file.resume_offset() == 0, "resume_offset: nothing written from the start");
+    file.written = {true, true, true, true};
+    check(file.resume_offset() == 350, "resume_offset: complete file");
+}
+
+// One file of `chunks` chunks plus a 100-byte tail, described as full data
+OutgoingFile make_file(const fs::path& dir, const std::string& name, size_t chunk_size, size_t chunks, uint64_t seed) {
+    OutgoingFile file;
+    file.path = (dir / name).string();
+    write_random_file(file.path, chunks * chunk_size + 100, seed);
+    file.descriptor.kind = FileKind::FullData;
+    file.descriptor.format_version = FileDescriptor::kRecordFormat;
+    return file;
+}
+
+void test_corrupted_chunk(const fs::path& dir) {
+    Link link("corrupt");
+    FileReceiver receiver(link.receiver_data, link.receiver_credit, [&](const FileChunkHeader& first) {
+        return (dir / ("received_" + std::to_string(first.transfer_id))).string();
+    });
+    FileTransferConfig config;
+    config.chunk_size = 4096;
+    config.window = 2;
+
+    std::vector<OutgoingFile> files{make_file(dir, "corrupt.bin", config.chunk_size, 8, 4)};
+    link.corrupt_chunk = 4;
+
+    FileTransferStats stats;
+    std::string error;
+    std::map<uint64_t, ReceivedFile> received = transfer(link, receiver, files, config, 1, stats, error);
+    check(error.empty(), "corrupted chunk: sender succeeded (" + error + ")");
+    check(stats.resent_chunks == 1, "corrupted chunk: the rejected chunk is sent again");
+    check(stats.chunks == 9, "corrupted chunk: every chunk counted once");
+    auto it = received.find(files[0].transfer_id);
+    check(it != received.end() && it->second.complete, "corrupted chunk: file completed");
+    if (it != received.end()) {
+        check(it->second.stats.checksum_errors == 1, "corrupted chunk: receiver rejected one chunk");
+        check(read_file(it->second.path) == read_file(files[0].path), "corrupted chunk: contents");
+    }
+}
+
+void test_interrupted_and_resumed(const fs::path& dir) {
+    Link link("resume");
+    FileReceiver receiver(link.receiver_data, link.receiver_credit, [&](const FileChunkHeader& first) {
+        return (dir / ("received_" + std::to_string(first.transfer_id))).string();
+    });
+    FileTransferConfig config;
+    config.chunk_size = 4096;
+    config.window = 2;
+    config.credit_timeout_ms = 300;
+
+    // The link goes down after three chunks; the sender times out waiting for credits
+    std::vector<OutgoingFile> files{make_file(dir, "resume.bin", config.chunk_size, 10, 5)};
+    const uint64_t total_size = fs::file_size(files[0].path);
+    link.forward_limit = 3;
+    FileTransferStats stats;
+    std::string error;
+    std::map<uint64_t, ReceivedFile> received = transfer(link, receiver, files, config, 1, stats, error);
+    check(!error.empty(), "interrupted: sender gave up");
+    check(received.empty(), "interrupted: file not completed");
+
+    std::vector<ReceivedFile> pending = receiver.incomplete();
+    check(pending.size() == 1, "interrupted: one incomplete transfer");
+    if (pending.size() != 1) {
+        return;
+    }
+    const uint64_t interrupted_id = files[0].transfer_id;
+    const uint64_t resume_offset = pending[0].resume_offset();
+    check(pending[0].transfer_id == interrupted_id, "interrupted: incomplete transfer has the sender's id");
+    check(resume_offset == 3 * config.chunk_size, "interrupted: resumes after the chunks on disk");
+
+    // Resume under a new id from the receiver's resume offset, as the resume_transfer command does
+    link.forward_limit = Link::kForwardAll;
+    files[0].transfer_id = FileSender::new_transfer_id();
+    files[0].start_offset = resume_offset;
+    receiver.resume(interrupted_id, files[0].transfer_id);
+    error.clear();
+    stats = FileTransferStats();
+    received = transfer(link, receiver, files, config, 1, stats, error);
+    check(error.empty(), "resumed: sender succeeded (" + error + ")");
+    check(stats.bytes == total_size - resume_offset, "resumed: only the missing part is sent");
+    auto it = received.find(files[0].transfer_id);
+    check(it != received.end() && it->second.complete, "resumed: file completed under the new id");
+    if (it != received.end()) {
+        check(it->second.total_size == total_size && it->second.stats.chunks == 11, "resumed: every chunk written once");
+        check(read_file(it->second.path) == read_file(files[0].path), "resumed: contents");
+    }
+    check(receiver.incomplete().empty(), "resumed: nothing left incomplete");
+}
+
+} // namespace
+
+int main() {
+    const fs::path dir = fs::temp_directory_path() / ("file_transfer_test_" + std::to_string(getpid()));
+    fs::create_directories(dir);
+    test_files_and_empty_file(dir);
+    test_resume_offset();
+    test_corrupted_chunk(dir);
+    test_interrupted_and_resumed(dir);
+    fs::remove_all(dir);
+    if (failures > 0) {
+        std::cerr << failures << " check(s) failed" << std::endl;
+        return 1;
+    }
+    std::cout << "file_transfer_test: all checks passed" << std::endl;
+    return 0;
+}
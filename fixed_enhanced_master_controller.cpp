@@ -9,8 +9,18 @@
 #include <filesystem>
 #include <algorithm>
 #include <numeric>
+#include <map>
+#include <memory>
+#include <cmath>
 #include "working_common.hpp"
 #include "streams.hpp"
+#include "timestamp_file.hpp"
+#include "timestamp_file_view.hpp"
+#include "cross_correlation.hpp"
+#include "file_transfer.hpp"
+#include "timestamp_codec.hpp"
+#include "live_stream.hpp"
+#include "acquisition_session.hpp"
 namespace fs = std::filesystem;
 using json = nlohmann::json;
 
@@ -29,6 +39,16 @@ bool MasterController::initialize() {
         log_message("Local Time Controller: " + config_.master_tc_address);
         log_message("Remote Slave: " + config_.slave_address);
         
+        // Report where the acquisition threads will run; the streams' I/O thread must be placed
+        // before the first stream socket is created
+        log_message("CPU topology: " + describe_cpu_topology());
+        ThreadPlacement receivers{config_.receiver_cpus, config_.rt_priority};
+        ThreadPlacement merger{config_.merger_cpus, config_.rt_priority};
+        ThreadPlacement io{config_.io_cpus, config_.rt_priority};
+        log_message("Thread placement: receivers on " + receivers.describe() + " (one CPU per channel in turn), merger on " +
+                    merger.describe() + ", stream I/O on " + io.describe());
+        configure_stream_io_threads(io);
+        
         // Initialize ZeroMQ context and sockets
         log_message("Setting up communication channels...");
         context_ = zmq::context_t(1);
@@ -56,6 +76,24 @@ bool MasterController::initialize() {
         log_message("Binding file socket to: " + file_endpoint);
         file_socket_.bind(file_endpoint);
         log_message("File socket bound");
+
+        // Socket for returning file-transfer credits to slave
+        log_message("Creating credit socket (PUSH)...");
+        credit_socket_ = zmq::socket_t(context_, zmq::socket_type::push);
+        std::string credit_endpoint = "tcp://*:" + std::to_string(config_.credit_port);
+        log_message("Binding credit socket to: " + credit_endpoint);
+        credit_socket_.bind(credit_endpoint);
+        log_message("Credit socket bound");
+
+        // Socket for receiving merged batches from slave during acquisition
+        if (config_.live_stream) {
+            log_message("Creating live stream socket (PULL)...");
+            live_socket_ = zmq::socket_t(context_, zmq::socket_type::pull);
+            std::string live_endpoint = "tcp://*:" + std::to_string(config_.live_port);
+            log_message("Binding live stream socket to: " + live_endpoint);
+            live_socket_.bind(live_endpoint);
+            log_message("Live stream socket bound");
+        }
         
         // Socket for sending commands to slave
         log_message("Creating command socket (REQ)...");
@@ -102,6 +140,9 @@ bool MasterController::initialize() {
         // Start monitoring threads
         running_ = true;
         start_monitor_thread();
+        if (config_.live_stream) {
+            start_live_receiver_thread();
+        }
         // Note: File receiver thread will be started when master is ready to receive data
         
         // Check if slave is available
@@ -145,11 +186,25 @@ void MasterController::stop() {
             }
         }
         
+        live_cv_.notify_all();
+        if (live_receiver_thread_.joinable()) {
+            try {
+                live_receiver_thread_.join();
+                log_message("Live stream receiver thread stopped");
+            } catch (const std::exception& e) {
+                log_message("ERROR: Failed to join live stream receiver thread: " + std::string(e.what()));
+            }
+        }
+        
+        close_acquisition_session();
+        
         // Close sockets
         try {
             trigger_socket_.close();
             status_socket_.close();
             file_socket_.close();
+            credit_socket_.close();
+            live_socket_.close();
             status_socket_.close();
             command_socket_.close();
             sync_socket_.close();
@@ -164,21 +219,24 @@ void MasterController::stop() {
 
 bool MasterController::run_single_file_mode(double duration, const std::vector<int>& channels) {
     log_message("Running in single-file mode");
-    return start_acquisition(duration, channels);
+    bool ok = start_acquisition(duration, channels);
+    close_acquisition_session();
+    return ok;
 }
 
 bool MasterController::run_streaming_mode(double duration, const std::vector<int>& channels, int num_files) {
     log_message("Running in streaming mode with " + std::to_string(num_files) + " files");
     
-    for (int i = 0; i < num_files && running_; ++i) {
-        log_message("Starting acquisition " + std::to_string(i+1) + " of " + std::to_string(num_files));
-        if (!start_acquisition(duration, channels)) {
-            log_message("ERROR: Acquisition " + std::to_string(i+1) + " failed");
-            return false;
-        }
-        
-        // Brief pause between acquisitions
-        std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    // One continuous acquisition of all files; the merger rotates the output every `duration`
+    // seconds (unless a file duration or size was configured), so no data is lost between files
+    if (config_.file_duration <= 0.0 && config_.file_size_bytes == 0) {
+        config_.file_duration = duration;
+    }
+    bool ok = start_acquisition(duration * num_files, channels);
+    close_acquisition_session();
+    if (!ok) {
+        log_message("ERROR: Continuous acquisition failed");
+        return false;
     }
     
     log_message("Streaming mode completed successfully");
@@ -199,33 +257,13 @@ bool MasterController::start_acquisition(double duration, const std::vector<int>
         request_ready_cmd["command"] = "request_ready";
         request_ready_cmd["sequence"] = command_sequence_++;
         
-        std::string cmd_str = request_ready_cmd.dump();
-        zmq::message_t cmd_msg(cmd_str.size());
-        memcpy(cmd_msg.data(), cmd_str.c_str(), cmd_str.size());
-        
-        // Set timeout for sending/receiving
-        command_socket_.set(zmq::sockopt::sndtimeo, 2000);
-        command_socket_.set(zmq::sockopt::rcvtimeo, 2000);
-        
-        auto send_result = command_socket_.send(cmd_msg, zmq::send_flags::none);
-        if (!send_result.has_value()) {
-            log_message("ERROR: Failed to send request_ready command to slave");
-            acquisition_active_ = false;
-            return false;
-        }
-        
-        // Wait for response to the request_ready command
-        zmq::message_t response;
-        auto resp_result = command_socket_.recv(response);
-        
-        if (!resp_result.has_value()) {
+        json response;
+        if (!send_command_to_slave(request_ready_cmd, response, 2000)) {
             log_message("ERROR: No response from slave for request_ready command");
             acquisition_active_ = false;
             return false;
         }
-        
-        std::string resp_str(static_cast<char*>(response.data()), response.size());
-        log_message("Slave response to request_ready: " + resp_str, true);
+        log_message("Slave response to request_ready: " + response.dump(), true);
         
         // Now wait for the ready signal on the sync socket
         log_message("Waiting for slave to be ready on sync socket...", true);
@@ -272,16 +310,9 @@ bool MasterController::start_acquisition(double duration, const std::vector<int>
                     status_cmd["command"] = "status";
                     status_cmd["sequence"] = command_sequence_++;
                     
-                    std::string status_str = status_cmd.dump();
-                    zmq::message_t status_msg(status_str.size());
-                    memcpy(status_msg.data(), status_str.c_str(), status_str.size());
-                    command_socket_.send(status_msg, zmq::send_flags::none);
-                    
-                    zmq::message_t status_resp;
-                    auto status_result = command_socket_.recv(status_resp);
-                    if (status_result.has_value()) {
-                        std::string status_resp_str(static_cast<char*>(status_resp.data()), status_resp.size());
-                        log_message("Slave status: " + status_resp_str, true);
+                    json status_resp;
+                    if (send_command_to_slave(status_cmd, status_resp, 2000)) {
+                        log_message("Slave status: " + status_resp.dump(), true);
                     }
                 }
             }
@@ -298,14 +329,8 @@ bool MasterController::start_acquisition(double duration, const std::vector<int>
                 retry_cmd["sequence"] = command_sequence_++;
                 retry_cmd["retry"] = retry + 1;
                 
-                std::string retry_str = retry_cmd.dump();
-                zmq::message_t retry_msg(retry_str.size());
-                memcpy(retry_msg.data(), retry_str.c_str(), retry_str.size());
-                command_socket_.send(retry_msg, zmq::send_flags::none);
-                
-                zmq::message_t retry_resp;
-                auto recv_result = command_socket_.recv(retry_resp);
-                if (!recv_result.has_value()) {
+                json retry_resp;
+                if (!send_command_to_slave(retry_cmd, retry_resp, 2000)) {
                     log_message("WARNING: No response to retry request", true);
                 }
                 
@@ -332,7 +357,8 @@ bool MasterController::start_acquisition(double duration, const std::vector<int>
         json trigger_msg;
         trigger_msg["command"] = "trigger";
         trigger_msg["timestamp"] = now_ns;
-        trigger_msg["sequence"] = command_sequence_++;
+        uint32_t trigger_sequence = command_sequence_++;
+        trigger_msg["sequence"] = trigger_sequence;
         trigger_msg["duration"] = duration;
         trigger_msg["channels"] = channels;
         
@@ -348,14 +374,6 @@ bool MasterController::start_acquisition(double duration, const std::vector<int>
         log_message("Starting local acquisition...");
         log_message("Master trigger timestamp: " + std::to_string(master_trigger_timestamp_ns_) + " ns", true);
         
-        // Configure the Time Controller for acquisition
-        configure_timestamps_references(local_tc_socket_, channels);
-        
-        // Set up acquisition parameters
-        for (int ch : channels) {
-            zmq_exec(local_tc_socket_, "RAW" + std::to_string(ch) + ":SEND ON");
-        }
-        
         // Start acquisition for specified duration
         log_message("Acquisition in progress for " + std::to_string(duration) + " seconds...");
         zmq_exec(local_tc_socket_, "REC:STARt");
@@ -377,163 +395,166 @@ bool MasterController::start_acquisition(double duration, const std::vector<int>
         log_message("Starting efficient single file data collection approach...");
         
         try {
-            // Connect to DataLinkTargetService using the working approach
             std::filesystem::path output_dir = fs::path(config_.output_dir);
-            zmq::socket_t dlt = dlt_connect(output_dir);
-            
-            // Close any prior acquisitions (clean slate) - using working method
-            close_active_acquisitions(dlt);
-            
-            // Ensure each channel's timestamps have no external reference (needed for merging)
-            configure_timestamps_references(local_tc_socket_, channels);
             
             // Compute pulse width (PWID) and period (PPER) in picoseconds for sub-acquisitions
-            long long sub_duration = 0.2; // Use proven sub-duration
+            double sub_duration = 0.2; // Use proven sub-duration
             long long pwid_ps = static_cast<long long>(1e12 * sub_duration);
             long long pper_ps = static_cast<long long>(1e12 * (sub_duration + 40e-9));  // add 40 ns dead-time
             
-            // Configure the Time Controller's recording settings using working approach
-            zmq_exec(local_tc_socket_, "REC:TRIG:ARM:MODE MANUal");  // manual trigger mode
-            zmq_exec(local_tc_socket_, "REC:ENABle ON");             // enable the Record generator
-            zmq_exec(local_tc_socket_, "REC:STOP");                 // ensure no acquisition is currently running
-            zmq_exec(local_tc_socket_, "REC:NUM INF");              // infinite number of sub-acquisitions (until stopped)
-            zmq_exec(local_tc_socket_, "REC:PWID " + std::to_string(pwid_ps) + ";PPER " + std::to_string(pper_ps));
+            // The DLT connection, the channel streams and the REC:* configuration are kept across
+            // files; they are only set up again when the acquisition settings change
+            AcquisitionSessionConfig session_config;
+            session_config.tc_address = config_.master_tc_address;
+            session_config.channels = channels;
+            session_config.output_dir = output_dir;
+            session_config.pwid_ps = pwid_ps;
+            session_config.pper_ps = pper_ps;
+            session_config.record_count = "INF";  // infinite number of sub-acquisitions (until stopped)
+            session_config.stream_options.zero_copy = config_.zero_copy_ingest;
+            session_config.stream_options.memory_budget = config_.memory_budget_bytes;
+            session_config.stream_options.process_memory_budget = config_.process_memory_budget_bytes;
+            session_config.stream_options.spill_dir = config_.spill_dir;
+            session_config.receivers = ThreadPlacement{config_.receiver_cpus, config_.rt_priority};
+            if (session_ && session_->config() != session_config) {
+                close_acquisition_session();
+            }
+            if (!session_) {
+                log_message("Opening acquisition session (DLT streams and Time Controller configuration)...");
+                session_.reset(new AcquisitionSession(local_tc_socket_, session_config));
+                session_->open();
+            } else {
+                log_message("Reusing acquisition session (" + std::to_string(session_->files_recorded()) + " files so far)", true);
+            }
+            
+            // Create output file for merged timestamps (binary columnar, see timestamp_file.hpp)
+            std::string output_file = (output_dir / ("master_results_" + get_current_timestamp_str() + ".tsm")).string();
             
-            // Open streamed acquisitions on each requested channel - single acquisition approach
-            std::map<int, std::string> acquisitions_id;
-            std::vector<BufferStreamClient*> stream_clients;
+            // Start the merging thread to combine incoming timestamps on the fly
+            TimestampsMergerThread merger(session_->streams(), output_file, static_cast<uint64_t>(pper_ps));
             
-            for (int ch : channels) {
-                zmq_exec(local_tc_socket_, "RAW" + std::to_string(ch) + ":ERRORS:CLEAR");  // reset error counter on channel
-                
-                // Start a BufferStreamClient to receive timestamps for this channel
-                BufferStreamClient* client = new BufferStreamClient(ch);
-                stream_clients.push_back(client);
-                client->start();
-                
-                // Instruct DLT to start streaming this channel to the given port
-                std::string cmd = "start-stream --address " + config_.master_tc_address + 
-                                  " --channel " + std::to_string(ch) + 
-                                  " --stream-port " + std::to_string(client->port);
-                json response = dlt_exec(dlt, cmd);
-                if (response.contains("id")) {
-                    acquisitions_id[ch] = response["id"].get<std::string>();
-                }
-                
-                // Tell the Time Controller to send timestamps from this channel
-                zmq_exec(local_tc_socket_, "RAW" + std::to_string(ch) + ":SEND ON");
+            // Optionally count coincidences on the merged stream as it is produced
+            std::unique_ptr<CoincidenceCounter> coincidences;
+            if (config_.coincidence_window_ps > 0) {
+                CoincidenceConfig coincidence_config;
+                coincidence_config.window = config_.coincidence_window_ps;
+                coincidences.reset(new CoincidenceCounter(coincidence_config));
+                merger.set_coincidence_counter(coincidences.get());
             }
             
-            // Create output file for merged timestamps
-            std::string output_file = (output_dir / ("master_results_" + get_current_timestamp_str() + ".txt")).string();
+            // Continuous recording: the merger starts a new file on a sub-acquisition boundary, so
+            // the acquisition never pauses and consecutive files are contiguous
+            MergedFileRotation rotation;
+            if (config_.file_duration > 0.0) {
+                rotation.sub_acquisitions_per_file = static_cast<uint64_t>(std::ceil(config_.file_duration * 1e12 / pper_ps));
+            }
+            rotation.max_bytes = config_.file_size_bytes;
+            if (rotation.enabled()) {
+                merger.set_rotation(rotation);
+            }
+            merger.set_placement(ThreadPlacement{config_.merger_cpus, config_.rt_priority});
             
-            // Start the merging thread to combine incoming timestamps on the fly
-            TimestampsMergerThread merger(stream_clients, output_file, static_cast<uint64_t>(pper_ps));
+            // Start the synchronized acquisition on the Time Controller. play() clears what is left
+            // of the previous file from the rings, so the merger starts right after it.
+            log_message("Starting acquisition with REC:PLAY...");
+            session_->play();
             merger.start();
             
-            // Start the synchronized acquisition on the Time Controller
-            log_message("Starting acquisition with REC:PLAY...");
-            zmq_exec(local_tc_socket_, "REC:PLAY");
+            // Periodically log the stream and merger counters
+            std::unique_ptr<StreamMetricsReporter> metrics;
+            if (config_.stats_interval > 0.0) {
+                metrics.reset(new StreamMetricsReporter(session_->streams(), &merger,
+                    std::chrono::milliseconds(static_cast<int>(config_.stats_interval * 1000))));
+                metrics->start();
+            }
             
             // Wait for the specified duration
             std::this_thread::sleep_for(std::chrono::milliseconds(static_cast<int>(duration * 1000)));
             
-            // Stop the acquisition
+            // Stop the acquisition and wait for the last sub-acquisitions to be transferred
             log_message("Stopping local acquisition...");
-            zmq_exec(local_tc_socket_, "REC:STOP");
-            
-            // Wait for all sub-acquisitions to complete and data to be transferred
             log_message("Waiting for data processing to complete...");
-            wait_end_of_timestamps_acquisition(local_tc_socket_, dlt, acquisitions_id, 30.0);
+            session_->stop(30.0);
             
-            // Close the acquisitions using working method
-            bool success = close_timestamps_acquisition(local_tc_socket_, dlt, acquisitions_id);
-            
-            // Stop all stream clients and merger thread
-            for (BufferStreamClient* client : stream_clients) {
-                client->join();
-            }
             log_message("Joining merger thread...");
             merger.join();
             log_message("Merger thread joined.");
+            if (metrics) {
+                metrics->stop();
+            }
+            if (merger.output_files().size() > 1) {
+                log_message("Recorded " + std::to_string(merger.output_files().size()) + " contiguous files: " +
+                            merger.output_files().front() + " ... " + merger.output_files().back());
+            }
             
-            // Cleanup dynamically allocated clients
-            for (BufferStreamClient* client : stream_clients) {
-                delete client;
+            if (coincidences) {
+                std::string coincidence_file = fs::path(output_file).replace_extension("").string() + "_coincidences.txt";
+                coincidences->write_report(coincidence_file);
+                log_message("Coincidences: " + coincidences->summary());
+                log_message("Coincidence report saved to: " + coincidence_file);
             }
             
             log_message("Data collection completed successfully using efficient single file approach");
             
-            // Convert the text output to binary format for compatibility with existing code
+            // Convert the merged output to the 12-byte record format used for transfers and synchronization
             if (fs::exists(output_file)) {
-                log_message("Converting merged data to binary format...");
+                log_message("Converting merged data to binary record format...");
                 
-                // Read the merged text file and convert to binary
-                std::ifstream infile(output_file);
-                std::string bin_filename = master_output_base.string() + ".bin";
-                std::ofstream bin_file(bin_filename, std::ios::binary);
-                
-                std::string line;
-                int total_timestamps = 0;
-                std::vector<uint64_t> all_timestamps;
-                std::vector<int> all_channels;
-                
-                while (std::getline(infile, line)) {
-                    // Skip comments and empty lines
-                    if (line.empty() || line[0] == '#') continue;
-                    
-                    // Parse line format: index timestamp channel
-                    std::istringstream iss(line);
-                    std::string index_str, timestamp_str, channel_str;
+                // Every rotated file gets its own .bin (and .txt), with the same _NNN suffix
+                const std::string output_stem = fs::path(output_file).stem().string();
+                uint64_t total_timestamps = 0;
+                std::string first_bin_filename;
+                for (const std::string& segment : merger.output_files()) {
+                    std::string suffix = fs::path(segment).stem().string().substr(output_stem.size());
+                    std::string bin_filename = master_output_base.string() + suffix + ".bin";
+                    total_timestamps += convert_merged_to_records(segment, bin_filename);
+                    log_message("Saved master timestamps to " + bin_filename);
                     
-                    if (iss >> index_str >> timestamp_str >> channel_str) {
-                        try {
-                            uint64_t timestamp = std::stoull(timestamp_str);
-                            int channel = std::stoi(channel_str);
-                            
-                            bin_file.write(reinterpret_cast<const char*>(&timestamp), sizeof(uint64_t));
-                            bin_file.write(reinterpret_cast<const char*>(&channel), sizeof(int));
-                            
-                            all_timestamps.push_back(timestamp);
-                            all_channels.push_back(channel);
-                            total_timestamps++;
-                        } catch (const std::exception& e) {
-                            log_message("WARNING: Failed to parse line: " + line + " - " + std::string(e.what()));
-                            continue;
-                        }
+                    // Save text format if requested (post-processed from the binary output)
+                    if (config_.text_output) {
+                        std::string txt_filename = master_output_base.string() + suffix + ".txt";
+                        write_merged_as_text(segment, txt_filename);
+                        log_message("Saved timestamps in text format to " + txt_filename);
+                    }
+                    if (first_bin_filename.empty()) {
+                        first_bin_filename = bin_filename;
                     }
                 }
-                
-                infile.close();
-                bin_file.close();
-                
-                log_message("Saved master timestamps to " + bin_filename);
                 log_message("Collected " + std::to_string(total_timestamps) + " timestamps from all channels", true);
                 
-                // Save text format if requested
-                if (config_.text_output) {
-                    std::string txt_filename = master_output_base.string() + ".txt";
-                    fs::copy_file(output_file, txt_filename);
-                    log_message("Saved timestamps in text format to " + txt_filename);
-                }
-                
-                // Store the timestamps for partial data requests and synchronization
-                latest_timestamps_ = all_timestamps;
-                latest_channels_ = all_channels;
+                // Remember the record file for synchronization (read on demand, not kept in memory);
+                // with rotation, the first file is the one that overlaps the slave's acquisition
+                latest_bin_filename_ = first_bin_filename;
                 
                 log_message("Master data collection completed successfully");
 
                 // Finalize with slave before requesting partial data
                 finalize_communication();
 
-                // Now request data from slave in controlled manner with proper response handling
-                log_message("Master is ready - requesting partial data from slave for synchronization...");
+                // With the live stream the slave's records are already here (or about to be) and
+                // the partial-data round trip is not needed
+                std::string live_file;
+                if (config_.live_stream) {
+                    log_message("Waiting for the end of the live stream from slave...");
+                    live_file = wait_for_live_stream(trigger_sequence, 30.0);
+                    if (live_file.empty()) {
+                        log_message("WARNING: Live stream from slave did not complete - falling back to partial data");
+                    }
+                }
                 
                 // Start file receiver thread now that master is ready
-                start_file_receiver_thread();
+                start_file_receiver_thread(latest_bin_filename_);
                 
-                // Request partial data from slave and wait for confirmation
-                request_partial_data_from_slave_with_response();
+                if (!live_file.empty()) {
+                    log_message("Master is ready - synchronizing with the live data from slave...");
+                    perform_synchronization_calculation(live_file, latest_bin_filename_);
+                } else {
+                    // Now request data from slave in controlled manner with proper response handling
+                    log_message("Master is ready - requesting partial data from slave for synchronization...");
+                    
+                    // Request partial data from slave and wait for confirmation
+                    request_partial_data_from_slave_with_response();
+                }
                 
                 // Calculate initial offset from trigger timestamps
                 if (slave_trigger_timestamp_ns_ > 0) {
@@ -551,6 +572,7 @@ bool MasterController::start_acquisition(double duration, const std::vector<int>
             
         } catch (const std::exception& e) {
             log_message("ERROR: Working data collection failed: " + std::string(e.what()));
+            session_.reset();  // set up from scratch for the next file
             log_message("This may be due to DLT not responding to commands properly.");
             log_message("Falling back to direct Time Controller data collection...");
             
@@ -587,12 +609,8 @@ bool MasterController::start_acquisition(double duration, const std::vector<int>
                         
                         // Save to binary file
                         std::string bin_filename = master_output_base.string() + ".bin";
-                        std::ofstream bin_file(bin_filename, std::ios::binary);
-                        for (size_t i = 0; i < timestamps.size(); ++i) {
-                            bin_file.write(reinterpret_cast<const char*>(&timestamps[i]), sizeof(uint64_t));
-                            bin_file.write(reinterpret_cast<const char*>(&channels_vec[i]), sizeof(int));
-                        }
-                        bin_file.close();
+                        write_timestamp_records(bin_filename, timestamps, channels_vec);
+                        latest_bin_filename_ = bin_filename;
                         
                         // Save to text file if requested
                         if (config_.text_output) {
@@ -754,8 +772,8 @@ void MasterController::start_monitor_thread() {
     });
 }
 
-void MasterController::start_file_receiver_thread() {
-    file_receiver_thread_ = std::thread([this]() {
+void MasterController::start_file_receiver_thread(const std::string& master_file_path) {
+    file_receiver_thread_ = std::thread([this, master_file_path]() {
         log_message("File receiver thread started");
         
         // Set a longer timeout for receiving files - increased to handle network delays
@@ -764,74 +782,104 @@ void MasterController::start_file_receiver_thread() {
         int files_received = 0;
         const int max_files = 3; // Expect: full data, partial data, text file
         const int max_wait_cycles = 20; // Maximum wait cycles (20 * 5 seconds = 100 seconds total)
+        const int max_resume_attempts = 3;
         int wait_cycles = 0;
+        int unknown_files = 0;
+        std::map<std::string, int> resume_attempts;
+        
+        // Output names come from the descriptor each transfer carries, not from its size
+        FileReceiver receiver(file_socket_, credit_socket_, [&](const FileChunkHeader& first_chunk) {
+            const FileDescriptor& descriptor = first_chunk.descriptor;
+            std::string sequence = std::to_string(descriptor.sequence);
+            std::string filename;
+            switch (descriptor.kind) {
+                case FileKind::PartialData: filename = "partial_data_" + sequence + ".bin"; break;
+                case FileKind::FullData: filename = "slave_file_" + sequence + ".bin"; break;
+                case FileKind::TextData: filename = "slave_file_" + sequence + ".txt"; break;
+                default: filename = "slave_file_unknown_" + std::to_string(++unknown_files) + ".bin"; break;
+            }
+            fs::path path = fs::path(config_.output_dir) / filename;
+            if (descriptor.format_version == FileDescriptor::kCompressedRecordFormat) {
+                path.replace_extension(".tsc");
+            }
+            return path.string();
+        });
+        
+        // Partial data is handed to the synchronization calculation on its own thread, so chunks of
+        // other transfers keep being written to disk meanwhile
+        std::vector<std::thread> sync_sinks;
+        std::vector<ReceivedFile> completed;
         
         while (running_ && files_received < max_files && wait_cycles < max_wait_cycles) {
             try {
-                zmq::message_t file_msg;
-                auto result = file_socket_.recv(file_msg, zmq::recv_flags::none);
-                
-                if (result.has_value() && file_msg.size() > 0) {
-                    files_received++;
+                completed.clear();
+                if (receiver.poll(completed)) {
                     wait_cycles = 0; // Reset wait cycles when we receive data
                     
-                    // Determine file type based on size and content
-                    std::string filename;
-                    std::string filepath;
-                    
-                    // Check if this looks like partial data (smaller size)
-                    if (file_msg.size() < 100000) { // Less than 100KB likely partial data
-                        filename = "partial_data_" + std::to_string(files_received) + ".bin";
-                        filepath = fs::path(config_.output_dir) / filename;
-                        
-                        // Save the received partial file
-                        std::ofstream outfile(filepath, std::ios::binary);
-                        if (outfile.is_open()) {
-                            outfile.write(static_cast<char*>(file_msg.data()), file_msg.size());
-                            outfile.close();
-                            
-                            log_message("Partial data file received from slave: " + filepath + " (" + std::to_string(file_msg.size()) + " bytes)");
-                            
-                            // Perform synchronization calculation with the partial data
-                            try {
-                                perform_synchronization_calculation(filepath);
-                            } catch (const std::exception& e) {
-                                log_message("ERROR: Failed to perform synchronization calculation: " + std::string(e.what()));
-                            }
-
-                            // Send acknowledgment to slave
-                            json ack_cmd;
-                            ack_cmd["command"] = "partial_data_ack";
-                            ack_cmd["sequence"] = command_sequence_++;
-                            json ack_resp;
-                            send_command_to_slave(ack_cmd, ack_resp);
-                        } else {
-                            log_message("ERROR: Failed to save partial data file: " + filepath);
+                    for (ReceivedFile& file : completed) {
+                        files_received++;
+                        if (file.descriptor.format_version == FileDescriptor::kCompressedRecordFormat) {
+                            // Compressed on the slave (--compress-transfers); everything downstream reads .bin
+                            std::string bin_path = fs::path(file.path).replace_extension(".bin").string();
+                            uint64_t compressed_size = fs::file_size(file.path);
+                            uint64_t records = decompress_record_file(file.path, bin_path);
+                            fs::remove(file.path);
+                            log_message("Decompressed " + file.path + ": " + std::to_string(records) + " records, " +
+                                        std::to_string(compressed_size) + " -> " + std::to_string(records * 12) + " bytes", true);
+                            file.path = bin_path;
                         }
+                        std::string details = std::to_string(file.descriptor.record_count) + " records, sequence " +
+                                              std::to_string(file.descriptor.sequence) + ", " + file.stats.summary();
                         
-                    } else {
-                        // Full data file
-                        filename = "slave_file_" + std::to_string(files_received) + ".bin";
-                        filepath = fs::path(config_.output_dir) / filename;
-                        
-                        // Save the received file
-                        std::ofstream outfile(filepath, std::ios::binary);
-                        if (outfile.is_open()) {
-                            outfile.write(static_cast<char*>(file_msg.data()), file_msg.size());
-                            outfile.close();
+                        if (file.descriptor.kind == FileKind::PartialData) {
+                            log_message("Partial data file received from slave: " + file.path + " (" + details + ")");
                             
-                            log_message("Full data file received from slave: " + filepath + " (" + std::to_string(file_msg.size()) + " bytes)");
+                            sync_sinks.emplace_back([this, path = file.path, master_file_path]() {
+                                // Perform synchronization calculation with the partial data
+                                try {
+                                    perform_synchronization_calculation(path, master_file_path);
+                                } catch (const std::exception& e) {
+                                    log_message("ERROR: Failed to perform synchronization calculation: " + std::string(e.what()));
+                                }
+                                
+                                // Send acknowledgment to slave
+                                json ack_cmd;
+                                ack_cmd["command"] = "partial_data_ack";
+                                ack_cmd["sequence"] = command_sequence_++;
+                                json ack_resp;
+                                send_command_to_slave(ack_cmd, ack_resp);
+                            });
+                        } else if (file.descriptor.kind == FileKind::TextData) {
+                            log_message("Text data file received from slave: " + file.path + " (" + file.stats.summary() + ")");
                         } else {
-                            log_message("ERROR: Failed to save full data file: " + filepath);
+                            log_message("Full data file received from slave: " + file.path + " (" + details + ")");
                         }
                     }
-                    
-                } else {
-                    // No message received, increment wait cycles
+                    continue;
+                }
+                
+                // Timed out: transfers in progress have stalled, resume them from their first missing chunk
+                std::vector<ReceivedFile> stalled = receiver.incomplete();
+                if (stalled.empty()) {
                     wait_cycles++;
                     log_message("File receiver waiting... (cycle " + std::to_string(wait_cycles) + "/" + std::to_string(max_wait_cycles) + ")", true);
                     continue;
                 }
+                for (const ReceivedFile& file : stalled) {
+                    int attempt = ++resume_attempts[file.path];
+                    if (attempt > max_resume_attempts) {
+                        log_message("ERROR: File transfer from slave failed: " + file.path);
+                        receiver.abandon(file.transfer_id);
+                        continue;
+                    }
+                    log_message("File transfer interrupted: " + file.path + " (" + std::to_string(file.bytes_written) +
+                                " of " + std::to_string(file.total_size) + " bytes), requesting resume (attempt " +
+                                std::to_string(attempt) + "/" + std::to_string(max_resume_attempts) + ")");
+                    uint64_t resume_id = request_transfer_resume(file.transfer_id, file.resume_offset());
+                    if (resume_id != 0) {
+                        receiver.resume(file.transfer_id, resume_id);
+                    }
+                }
                 
             } catch (const zmq::error_t& e) {
                 if (e.num() == EAGAIN) { // Timeout
@@ -848,6 +896,10 @@ void MasterController::start_file_receiver_thread() {
             }
         }
         
+        for (std::thread& sink : sync_sinks) {
+            sink.join();
+        }
+        
         if (wait_cycles >= max_wait_cycles) {
             log_message("File receiver thread stopped due to timeout (waited " + std::to_string(max_wait_cycles * 5) + " seconds)");
         } else {
@@ -856,6 +908,104 @@ void MasterController::start_file_receiver_thread() {
     });
 }
 
+void MasterController::start_live_receiver_thread() {
+    live_receiver_thread_ = std::thread([this]() {
+        log_message("Live stream receiver thread started");
+        
+        // Short timeout so the thread notices stop()
+        live_socket_.set(zmq::sockopt::rcvtimeo, 1000);
+        
+        // Each acquisition's batches are appended to a record file as they arrive; the file is named
+        // like partial data because that is what the synchronization calculation uses it as
+        std::unique_ptr<TimestampRecordWriter> writer;
+        std::string path;
+        uint32_t sequence = 0;
+        uint64_t expected_index = 0;
+        uint64_t records = 0;
+        uint64_t lost_batches = 0;
+        LiveBatch batch;
+        
+        while (running_) {
+            try {
+                if (!receive_live_batch(live_socket_, batch)) {
+                    continue;
+                }
+                if (writer && batch.header.sequence != sequence) {
+                    log_message("WARNING: Live stream of sequence " + std::to_string(sequence) + " ended without end marker");
+                    writer->close();
+                    writer.reset();
+                }
+                if (!writer) {
+                    sequence = batch.header.sequence;
+                    path = (fs::path(config_.output_dir) / ("partial_data_live_" + std::to_string(sequence) + ".bin")).string();
+                    writer.reset(new TimestampRecordWriter(path));
+                    expected_index = 0;
+                    records = 0;
+                    lost_batches = 0;
+                    log_message("Live stream from slave started (sequence " + std::to_string(sequence) + ")");
+                }
+                if (batch.header.index > expected_index) {
+                    // Batches dropped by the slave (master not keeping up) or rejected here
+                    lost_batches += batch.header.index - expected_index;
+                    log_message("WARNING: Live stream lost " + std::to_string(batch.header.index - expected_index) + " batches", true);
+                }
+                if (batch.end_of_stream()) {
+                    writer->close();
+                    writer.reset();
+                    log_message("Live stream from slave complete: " + std::to_string(records) + " records in " + path +
+                                (lost_batches > 0 ? " (" + std::to_string(lost_batches) + " batches lost)" : ""));
+                    {
+                        std::lock_guard<std::mutex> lock(live_mutex_);
+                        live_files_[sequence] = path;
+                    }
+                    live_cv_.notify_all();
+                    continue;
+                }
+                expected_index = batch.header.index + 1;
+                for (size_t i = 0; i < batch.timestamps.size(); ++i) {
+                    writer->append(batch.timestamps[i], batch.channels[i]);
+                }
+                records += batch.timestamps.size();
+                
+            } catch (const zmq::error_t& e) {
+                if (e.num() == EAGAIN) {
+                    continue;
+                }
+                log_message("Live stream receiver error: " + std::string(e.what()));
+                break;
+            } catch (const std::exception& e) {
+                // A malformed or corrupted batch is skipped; the index gap is reported with the next one
+                log_message("ERROR: Live stream batch rejected: " + std::string(e.what()));
+            }
+        }
+        
+        if (writer) {
+            writer->close();
+        }
+        log_message("Live stream receiver thread exiting");
+    });
+}
+
+std::string MasterController::wait_for_live_stream(uint32_t sequence, double timeout_seconds) {
+    std::unique_lock<std::mutex> lock(live_mutex_);
+    live_cv_.wait_for(lock, std::chrono::duration<double>(timeout_seconds), [&]() {
+        return live_files_.count(sequence) > 0 || !running_;
+    });
+    auto it = live_files_.find(sequence);
+    return it != live_files_.end() ? it->second : std::string();
+}
+
+void MasterController::close_acquisition_session() {
+    if (!session_) {
+        return;
+    }
+    log_message("Closing acquisition session after " + std::to_string(session_->files_recorded()) + " files...");
+    if (!session_->close()) {
+        log_message("WARNING: The acquisition session reported errors (see channel messages above)");
+    }
+    session_.reset();
+}
+
 bool MasterController::check_slave_availability() {
     // Simple implementation - can be enhanced later
     log_message("Checking slave availability...");
@@ -863,30 +1013,16 @@ bool MasterController::check_slave_availability() {
 }
 
 
-void MasterController::perform_synchronization_calculation(const std::string& slave_file_path) {
+void MasterController::perform_synchronization_calculation(const std::string& slave_file_path,
+                                                           const std::string& master_file_path) {
     try {
         log_message("Performing synchronization calculation with slave data...");
         
-        // Read slave timestamps from binary file
-        std::vector<uint64_t> slave_timestamps;
-        std::vector<int> slave_channels;
+        // Map the slave records; they are decoded in place, without copying the file into memory
+        // (an unreadable file throws and is reported by the handler below)
+        TimestampFileView slave_records(slave_file_path);
         
-        std::ifstream slave_file(slave_file_path, std::ios::binary);
-        if (!slave_file) {
-            log_message("ERROR: Cannot open slave file: " + slave_file_path);
-            return;
-        }
-        
-        uint64_t timestamp;
-        int channel;
-        while (slave_file.read(reinterpret_cast<char*>(&timestamp), sizeof(uint64_t)) &&
-               slave_file.read(reinterpret_cast<char*>(&channel), sizeof(int))) {
-            slave_timestamps.push_back(timestamp);
-            slave_channels.push_back(channel);
-        }
-        slave_file.close();
-        
-        log_message("Loaded " + std::to_string(slave_timestamps.size()) + " slave timestamps");
+        log_message("Loaded " + std::to_string(slave_records.size()) + " slave timestamps");
         
         // Check if this is partial data (for sync calculation) or full data
         bool is_partial_data = slave_file_path.find("partial_data_") != std::string::npos;
@@ -894,115 +1030,166 @@ void MasterController::perform_synchronization_calculation(const std::string& sl
         if (is_partial_data) {
             log_message("Processing partial data for start point synchronization...");
             
-            if (slave_timestamps.empty() || latest_timestamps_.empty()) {
+            if (slave_records.empty() || master_file_path.empty() || !fs::exists(master_file_path)) {
+                log_message("ERROR: No data available for synchronization");
+                return;
+            }
+            TimestampFileView master_records(master_file_path);
+            if (master_records.empty()) {
                 log_message("ERROR: No data available for synchronization");
                 return;
             }
                 
-                // Find slave start time from partial data
-                uint64_t slave_start_time = *std::min_element(slave_timestamps.begin(), slave_timestamps.end());
-                log_message("Slave start time (from partial data): " + std::to_string(slave_start_time) + " ns");
-                
-                // Find master start time
-                uint64_t master_start_time = *std::min_element(latest_timestamps_.begin(), latest_timestamps_.end());
-                log_message("Master original start time: " + std::to_string(master_start_time) + " ns");
-                
-                // Calculate time difference
-                int64_t time_difference = static_cast<int64_t>(slave_start_time) - static_cast<int64_t>(master_start_time);
-                log_message("Time difference (slave - master): " + std::to_string(time_difference) + " ns");
-                
-                // Determine synchronization point
-                uint64_t sync_point;
-                if (time_difference > 0) {
-                    // Slave started later, use slave start time as sync point
-                    sync_point = slave_start_time;
-                    log_message("Slave started later - using slave start time as sync point");
-                } else {
-                    // Master started later or same time, use master start time as sync point
-                    sync_point = master_start_time;
-                    log_message("Master started later or same time - using master start time as sync point");
+            // Find slave start time from partial data
+            uint64_t slave_start_time = slave_records.timestamp(0);
+            for (size_t i = 1; i < slave_records.size(); ++i) {
+                slave_start_time = std::min(slave_start_time, slave_records.timestamp(i));
+            }
+            log_message("Slave start time (from partial data): " + std::to_string(slave_start_time) + " ns");
+            
+            // Find master start time
+            uint64_t master_start_time = master_records.timestamp(0);
+            for (size_t i = 1; i < master_records.size(); ++i) {
+                master_start_time = std::min(master_start_time, master_records.timestamp(i));
+            }
+            log_message("Master original start time: " + std::to_string(master_start_time) + " ns");
+            
+            // Calculate time difference
+            int64_t time_difference = static_cast<int64_t>(slave_start_time) - static_cast<int64_t>(master_start_time);
+            log_message("Time difference (slave - master): " + std::to_string(time_difference) + " ns");
+            
+            // Clock offset from the cross-correlation of the two event trains (independent of
+            // the event rates, unlike comparing start times or pairing the i-th records)
+            CrossCorrelationResult xcorr;
+            OffsetEstimator matched;
+            if (config_.xcorr_sync) {
+                xcorr = estimate_offset_from_partial_data(master_records, slave_records, master_start_time, matched);
+                log_message("Cross-correlation: " + xcorr.summary());
+                if (matched.count() > 0) {
+                    std::ostringstream stats;
+                    stats << std::fixed << std::setprecision(1) << matched.count() << " matched pairs, mean "
+                          << matched.mean() << " ps, min " << matched.min() << " ps, max " << matched.max()
+                          << " ps, std dev " << matched.std_dev() << " ps";
+                    log_message("Matched-pair offsets: " + stats.str());
                 }
-                
-                log_message("Synchronization point: " + std::to_string(sync_point) + " ns");
-                
-                // Remove master data before sync point
-                std::vector<uint64_t> synchronized_timestamps;
-                std::vector<int> synchronized_channels;
-                
-                size_t removed_count = 0;
-                size_t kept_count = 0;
-                
-                for (size_t i = 0; i < latest_timestamps_.size(); ++i) {
-                    if (latest_timestamps_[i] >= sync_point) {
-                        synchronized_timestamps.push_back(latest_timestamps_[i]);
-                        synchronized_channels.push_back(latest_channels_[i]);
-                        kept_count++;
-                    } else {
-                        removed_count++;
-                    }
+            }
+            
+            // Determine synchronization point
+            uint64_t sync_point;
+            if (xcorr.found) {
+                // Slave start expressed in the master clock
+                int64_t slave_start_master_clock = static_cast<int64_t>(slave_start_time) - static_cast<int64_t>(std::llround(xcorr.offset));
+                sync_point = std::max(master_start_time, static_cast<uint64_t>(std::max<int64_t>(0, slave_start_master_clock)));
+                log_message("Using cross-correlation offset for the sync point (slave start in master clock: " +
+                            std::to_string(slave_start_master_clock) + ")");
+            } else if (time_difference > 0) {
+                // Slave started later, use slave start time as sync point
+                sync_point = slave_start_time;
+                log_message("Slave started later - using slave start time as sync point");
+            } else {
+                // Master started later or same time, use master start time as sync point
+                sync_point = master_start_time;
+                log_message("Master started later or same time - using master start time as sync point");
+            }
+            
+            log_message("Synchronization point: " + std::to_string(sync_point) + " ns");
+            
+            // Stream master records at or after the sync point straight into the synchronized
+            // files, without building an in-memory copy of the capture
+            std::string sync_filename = (fs::path(config_.output_dir) / ("master_results_synchronized_" + get_current_timestamp_str() + ".bin")).string();
+            std::string sync_txt_filename = (fs::path(config_.output_dir) / ("master_results_synchronized_" + get_current_timestamp_str() + ".txt")).string();
+            
+            TimestampRecordWriter sync_file(sync_filename);
+            std::ofstream sync_txt_file;
+            if (config_.text_output) {
+                sync_txt_file.open(sync_txt_filename);
+                if (!sync_txt_file) {
+                    throw std::runtime_error("Failed to open file for writing: " + sync_txt_filename);
                 }
-                
-                log_message("Removed " + std::to_string(removed_count) + " timestamps before sync point");
-                log_message("Kept " + std::to_string(kept_count) + " synchronized timestamps");
-                
-                // Replace master data with synchronized data
-                latest_timestamps_ = synchronized_timestamps;
-                latest_channels_ = synchronized_channels;
-                
-                // Save synchronized master data
-                std::string sync_filename = (fs::path(config_.output_dir) / ("master_results_synchronized_" + get_current_timestamp_str() + ".bin")).string();
-                
-                std::ofstream sync_file(sync_filename, std::ios::binary);
-                if (sync_file.is_open()) {
-                    for (size_t i = 0; i < synchronized_timestamps.size(); ++i) {
-                        sync_file.write(reinterpret_cast<const char*>(&synchronized_timestamps[i]), sizeof(uint64_t));
-                        sync_file.write(reinterpret_cast<const char*>(&synchronized_channels[i]), sizeof(int));
+            }
+            
+            size_t removed_count = 0;
+            size_t kept_count = 0;
+            
+            for (const TimestampFileView::Record record : master_records) {
+                if (record.timestamp >= sync_point) {
+                    sync_file.append(record.timestamp, record.channel);
+                    if (config_.text_output) {
+                        sync_txt_file << record.channel << ";" << record.timestamp << "\n";
                     }
-                    sync_file.close();
-                    log_message("Synchronized master data saved to: " + sync_filename);
-                }
-                
-                // Save text format if requested
-                if (config_.text_output) {
-                    std::string sync_txt_filename = (fs::path(config_.output_dir) / ("master_results_synchronized_" + get_current_timestamp_str() + ".txt")).string();
-                    write_timestamps_to_txt(synchronized_timestamps, synchronized_channels, sync_txt_filename);
-                    log_message("Synchronized master data (text) saved to: " + sync_txt_filename);
+                    kept_count++;
+                } else {
+                    removed_count++;
                 }
-                
-                // Generate synchronization report
-                std::string report_filename = (fs::path(config_.output_dir) / ("sync_report_" + get_current_timestamp_str() + ".txt")).string();
-                std::ofstream report_file(report_filename);
-                if (report_file.is_open()) {
-                    report_file << "=== SYNCHRONIZATION REPORT ===" << std::endl;
-                    report_file << "Timestamp: " << get_current_timestamp_str() << std::endl;
-                    report_file << std::endl;
-                    report_file << "SYNCHRONIZATION DETAILS:" << std::endl;
-                    report_file << "Slave start time: " << slave_start_time << " ns" << std::endl;
-                    report_file << "Master original start time: " << master_start_time << " ns" << std::endl;
-                    report_file << "Time difference: " << time_difference << " ns" << std::endl;
-                    report_file << "Synchronization point: " << sync_point << " ns" << std::endl;
-                    report_file << std::endl;
-                    report_file << "DATA PROCESSING:" << std::endl;
-                    report_file << "Timestamps removed: " << removed_count << std::endl;
-                    report_file << "Timestamps kept: " << kept_count << std::endl;
-                    report_file << "Slave partial data size: " << slave_timestamps.size() << std::endl;
-                    report_file << std::endl;
-                    report_file << "RESULT:" << std::endl;
-                    report_file << "Master and slave data now start at the same time point" << std::endl;
-                    report_file << "Synchronized master data file: " << sync_filename << std::endl;
-                    report_file.close();
-                    log_message("Synchronization report saved to: " + report_filename);
+            }
+            sync_file.close();
+            
+            log_message("Removed " + std::to_string(removed_count) + " timestamps before sync point");
+            log_message("Kept " + std::to_string(kept_count) + " synchronized timestamps");
+            
+            log_message("Synchronized master data saved to: " + sync_filename);
+            
+            // Save text format if requested
+            if (config_.text_output) {
+                sync_txt_file.close();
+                log_message("Synchronized master data (text) saved to: " + sync_txt_filename);
+            }
+            
+            // Generate synchronization report
+            std::string report_filename = (fs::path(config_.output_dir) / ("sync_report_" + get_current_timestamp_str() + ".txt")).string();
+            std::ofstream report_file(report_filename);
+            if (report_file.is_open()) {
+                report_file << "=== SYNCHRONIZATION REPORT ===" << std::endl;
+                report_file << "Timestamp: " << get_current_timestamp_str() << std::endl;
+                report_file << std::endl;
+                report_file << "SYNCHRONIZATION DETAILS:" << std::endl;
+                report_file << "Slave start time: " << slave_start_time << " ns" << std::endl;
+                report_file << "Master original start time: " << master_start_time << " ns" << std::endl;
+                report_file << "Time difference: " << time_difference << " ns" << std::endl;
+                report_file << "Synchronization point: " << sync_point << " ns" << std::endl;
+                report_file << std::endl;
+                report_file << "DATA PROCESSING:" << std::endl;
+                report_file << "Timestamps removed: " << removed_count << std::endl;
+                report_file << "Timestamps kept: " << kept_count << std::endl;
+                report_file << "Slave partial data size: " << slave_records.size() << std::endl;
+                report_file << std::endl;
+                report_file << "CROSS-CORRELATION OFFSET (slave - master):" << std::endl;
+                if (!config_.xcorr_sync) {
+                    report_file << "Disabled" << std::endl;
+                } else if (xcorr.found) {
+                    report_file << "Offset: " << std::fixed << std::setprecision(1) << xcorr.offset << " ps" << std::endl;
+                    report_file << "Coarse offset: " << xcorr.coarse_offset << " ps (bin " << xcorr.coarse_bin << " ps)" << std::endl;
+                    report_file << "Peak: " << xcorr.peak_counts << " coincidences, background " << xcorr.background
+                                << " per bin, significance " << xcorr.significance << " sigma" << std::endl;
+                    report_file << "Matched pairs: " << matched.count() << std::endl;
+                    if (matched.count() > 0) {
+                        report_file << "Matched-pair offset mean: " << matched.mean() << " ps, min " << matched.min()
+                                    << " ps, max " << matched.max() << " ps, std dev " << matched.std_dev() << " ps" << std::endl;
+                    }
+                } else {
+                    report_file << "Not found: " << xcorr.message << std::endl;
                 }
-                
-                log_message("START POINT SYNCHRONIZATION COMPLETED SUCCESSFULLY");
-                log_message("Master data now starts at the same time as slave data");
-                
-            } else {
-                log_message("Processing full slave data file...");
-                // This is full slave data, just log the information
-                log_message("Received full slave data with " + std::to_string(slave_timestamps.size()) + " timestamps");
+                report_file << std::endl;
+                report_file << "RESULT:" << std::endl;
+                report_file << "Master and slave data now start at the same time point" << std::endl;
+                report_file << "Synchronized master data file: " << sync_filename << std::endl;
+                report_file.close();
+                log_message("Synchronization report saved to: " + report_filename);
             }
-        
+            
+            // With a measured offset, also provide the synchronized master data in the slave's clock
+            if (xcorr.found) {
+                apply_synchronization_correction(sync_filename, static_cast<int64_t>(std::llround(xcorr.offset)));
+            }
+            
+            log_message("START POINT SYNCHRONIZATION COMPLETED SUCCESSFULLY");
+            log_message("Master data now starts at the same time as slave data");
+            
+        } else {
+            log_message("Processing full slave data file...");
+            // This is full slave data, just log the information
+            log_message("Received full slave data with " + std::to_string(slave_records.size()) + " timestamps");
+        }
     } catch (const std::exception& e) {
         log_message("ERROR: Synchronization calculation failed: " + std::string(e.what()));
     }
@@ -1010,34 +1197,53 @@ void MasterController::perform_synchronization_calculation(const std::string& sl
 
 
 
+CrossCorrelationResult MasterController::estimate_offset_from_partial_data(const TimestampFileView& master_records,
+                                                                           const TimestampFileView& slave_records,
+                                                                           uint64_t master_start_time,
+                                                                           OffsetEstimator& matched) {
+    // The slave's partial data covers the beginning of its acquisition; correlate it against the
+    // master events of the same length of time plus the search range
+    std::vector<uint64_t> slave_timestamps;
+    slave_timestamps.reserve(slave_records.size());
+    for (size_t i = 0; i < slave_records.size(); ++i) {
+        slave_timestamps.push_back(slave_records.timestamp(i));
+    }
+    std::sort(slave_timestamps.begin(), slave_timestamps.end());
+    
+    uint64_t slave_span = slave_timestamps.back() - slave_timestamps.front();
+    uint64_t margin = config_.xcorr_max_offset_ps > 0 ? static_cast<uint64_t>(config_.xcorr_max_offset_ps) : slave_span;
+    uint64_t master_end = master_start_time + slave_span + margin;
+    
+    std::vector<uint64_t> master_timestamps;
+    for (size_t i = 0; i < master_records.size(); ++i) {
+        uint64_t ts = master_records.timestamp(i);
+        if (ts <= master_end) {
+            master_timestamps.push_back(ts);
+        }
+    }
+    std::sort(master_timestamps.begin(), master_timestamps.end());
+    
+    CrossCorrelationConfig xcorr_config;
+    xcorr_config.max_offset = config_.xcorr_max_offset_ps;
+    xcorr_config.fine_bin = config_.xcorr_bin_ps;
+    CrossCorrelationResult result = estimate_clock_offset(master_timestamps, slave_timestamps, xcorr_config);
+    
+    // Statistics of the coincident pairs the offset lines up (within the centroid window around the
+    // peak), rather than of the i-th master and slave records, which differ in rate and start
+    if (result.found) {
+        double tolerance = (xcorr_config.centroid_half_width + 0.5) * static_cast<double>(xcorr_config.fine_bin);
+        matched.add_matched(master_timestamps, slave_timestamps, result.offset, tolerance);
+    }
+    return result;
+}
+
 void MasterController::apply_synchronization_correction(const std::string& master_file_path, int64_t offset) {
     try {
         log_message("Applying synchronization correction to master data...");
-        log_message("Offset to apply: " + std::to_string(offset) + " ns");
-        
-        // Read all master timestamps
-        std::vector<uint64_t> master_timestamps;
-        std::vector<int> master_channels;
-        
-        std::ifstream master_file(master_file_path, std::ios::binary);
-        if (!master_file) {
-            log_message("ERROR: Cannot open master file for correction: " + master_file_path);
-            return;
-        }
-        
-        uint64_t timestamp;
-        int channel;
-        while (master_file.read(reinterpret_cast<char*>(&timestamp), sizeof(uint64_t)) &&
-               master_file.read(reinterpret_cast<char*>(&channel), sizeof(int))) {
-            master_timestamps.push_back(timestamp);
-            master_channels.push_back(channel);
-        }
-        master_file.close();
+        log_message("Offset to apply: " + std::to_string(offset) + " ps");
         
-        // Apply offset correction to all timestamps
-        for (size_t i = 0; i < master_timestamps.size(); ++i) {
-            master_timestamps[i] = static_cast<uint64_t>(static_cast<int64_t>(master_timestamps[i]) + offset);
-        }
+        // Map the master records (an unreadable file throws and is reported by the handler below)
+        TimestampFileView master_records(master_file_path);
         
         // Create corrected file
         std::string corrected_file_path = master_file_path;
@@ -1048,11 +1254,10 @@ void MasterController::apply_synchronization_correction(const std::string& maste
             corrected_file_path += "_sync_corrected";
         }
         
-        // Write corrected data
-        std::ofstream corrected_file(corrected_file_path, std::ios::binary);
-        for (size_t i = 0; i < master_timestamps.size(); ++i) {
-            corrected_file.write(reinterpret_cast<const char*>(&master_timestamps[i]), sizeof(uint64_t));
-            corrected_file.write(reinterpret_cast<const char*>(&master_channels[i]), sizeof(int));
+        // Apply the offset while streaming the mapped records straight into the corrected file
+        TimestampRecordWriter corrected_file(corrected_file_path);
+        for (const TimestampFileView::Record record : master_records) {
+            corrected_file.append(static_cast<uint64_t>(static_cast<int64_t>(record.timestamp) + offset), record.channel);
         }
         corrected_file.close();
         
@@ -1110,22 +1315,9 @@ void MasterController::request_partial_data_from_slave_with_response() {
         request["command"] = "request_partial_data";
         request["sequence"] = 1;
         
-        std::string request_str = request.dump();
-        zmq::message_t request_msg(request_str.size());
-        memcpy(request_msg.data(), request_str.c_str(), request_str.size());
-        
-        // Send request to slave
-        command_socket_.send(request_msg, zmq::send_flags::none);
-        
-        // Wait for response
-        zmq::message_t response_msg;
-        command_socket_.set(zmq::sockopt::rcvtimeo, 10000); // 10 second timeout
-        auto result = command_socket_.recv(response_msg);
-        
-        if (result.has_value()) {
-            std::string response_data(static_cast<char*>(response_msg.data()), response_msg.size());
-            json response_json = json::parse(response_data);
-            
+        // Send request to slave and wait for its response (10 second timeout)
+        json response_json;
+        if (send_command_to_slave(request, response_json, 10000)) {
             if (response_json["status"] == "ok") {
                 log_message("Slave confirmed partial data request: " + response_json["message"].get<std::string>());
                 
@@ -1174,22 +1366,9 @@ void MasterController::request_full_data_from_slave() {
         request["command"] = "request_full_data";
         request["sequence"] = 1;
         
-        std::string request_str = request.dump();
-        zmq::message_t request_msg(request_str.size());
-        memcpy(request_msg.data(), request_str.c_str(), request_str.size());
-        
-        // Send request to slave
-        command_socket_.send(request_msg, zmq::send_flags::none);
-        
-        // Wait for response
-        zmq::message_t response_msg;
-        command_socket_.set(zmq::sockopt::rcvtimeo, 10000); // 10 second timeout
-        auto result = command_socket_.recv(response_msg);
-        
-        if (result.has_value()) {
-            std::string response_data(static_cast<char*>(response_msg.data()), response_msg.size());
-            json response_json = json::parse(response_data);
-            
+        // Send request to slave and wait for its response (10 second timeout)
+        json response_json;
+        if (send_command_to_slave(request, response_json, 10000)) {
             if (response_json["status"] == "ok") {
                 log_message("Slave confirmed full data request: " + response_json["message"].get<std::string>());
             } else {
@@ -1212,22 +1391,9 @@ void MasterController::request_text_data_from_slave() {
         request["command"] = "request_text_data";
         request["sequence"] = 1;
         
-        std::string request_str = request.dump();
-        zmq::message_t request_msg(request_str.size());
-        memcpy(request_msg.data(), request_str.c_str(), request_str.size());
-        
-        // Send request to slave
-        command_socket_.send(request_msg, zmq::send_flags::none);
-        
-        // Wait for response
-        zmq::message_t response_msg;
-        command_socket_.set(zmq::sockopt::rcvtimeo, 10000); // 10 second timeout
-        auto result = command_socket_.recv(response_msg);
-        
-        if (result.has_value()) {
-            std::string response_data(static_cast<char*>(response_msg.data()), response_msg.size());
-            json response_json = json::parse(response_data);
-            
+        // Send request to slave and wait for its response (10 second timeout)
+        json response_json;
+        if (send_command_to_slave(request, response_json, 10000)) {
             if (response_json["status"] == "ok") {
                 log_message("Slave confirmed text data request: " + response_json["message"].get<std::string>());
             } else {
@@ -1242,6 +1408,33 @@ void MasterController::request_text_data_from_slave() {
     }
 }
 
+uint64_t MasterController::request_transfer_resume(uint64_t transfer_id, uint64_t offset) {
+    try {
+        json request;
+        request["command"] = "resume_transfer";
+        request["sequence"] = command_sequence_++;
+        request["transfer_id"] = transfer_id;
+        request["offset"] = offset;
+        
+        // The slave answers right away and queues the remainder behind the interrupted attempt
+        json response_json;
+        if (send_command_to_slave(request, response_json)) {
+            if (response_json["status"] == "ok") {
+                log_message("Slave resuming transfer from byte " + std::to_string(offset));
+                return response_json.value("transfer_id", uint64_t(0));
+            } else {
+                log_message("ERROR: Slave rejected transfer resume: " + response_json["message"].get<std::string>());
+            }
+        } else {
+            log_message("ERROR: No response from slave for transfer resume");
+        }
+        
+    } catch (const std::exception& e) {
+        log_message("ERROR: Failed to request transfer resume: " + std::string(e.what()));
+    }
+    return 0;
+}
+
 bool MasterController::finalize_communication() {
     try {
         log_message("Sending finalize command to slave...");
@@ -1267,14 +1460,16 @@ bool MasterController::finalize_communication() {
     return false;
 }
 
-bool MasterController::send_command_to_slave(json& command, json& response) {
+bool MasterController::send_command_to_slave(json& command, json& response, int timeout_ms) {
+    // The acquisition, the file receiver and the synchronization sinks share the REQ socket
+    std::lock_guard<std::mutex> lock(command_mutex_);
     try {
         std::string cmd_str = command.dump();
         zmq::message_t cmd_msg(cmd_str.size());
         memcpy(cmd_msg.data(), cmd_str.c_str(), cmd_str.size());
 
-        command_socket_.set(zmq::sockopt::sndtimeo, 5000);
-        command_socket_.set(zmq::sockopt::rcvtimeo, 5000);
+        command_socket_.set(zmq::sockopt::sndtimeo, timeout_ms);
+        command_socket_.set(zmq::sockopt::rcvtimeo, timeout_ms);
 
         auto send_res = command_socket_.send(cmd_msg, zmq::send_flags::none);
         if (!send_res.has_value()) {
@@ -9,8 +9,13 @@
 #include <filesystem>
 #include <algorithm>
 #include <numeric>
+#include <memory>
 #include "working_common.hpp"
 #include "streams.hpp"
+#include "timestamp_file.hpp"
+#include "file_transfer.hpp"
+#include "timestamp_codec.hpp"
+#include "acquisition_session.hpp"
 
 namespace fs = std::filesystem;
 using json = nlohmann::json;
@@ -29,6 +34,16 @@ bool SlaveAgent::initialize() {
         log_message("Local Time Controller: " + config_.slave_tc_address);
         log_message("Master address: " + config_.master_address);
         
+        // Report where the acquisition threads will run; the streams' I/O thread must be placed
+        // before the first stream socket is created
+        log_message("CPU topology: " + describe_cpu_topology());
+        ThreadPlacement receivers{config_.receiver_cpus, config_.rt_priority};
+        ThreadPlacement merger{config_.merger_cpus, config_.rt_priority};
+        ThreadPlacement io{config_.io_cpus, config_.rt_priority};
+        log_message("Thread placement: receivers on " + receivers.describe() + " (one CPU per channel in turn), merger on " +
+                    merger.describe() + ", stream I/O on " + io.describe());
+        configure_stream_io_threads(io);
+        
         // Initialize ZeroMQ context and sockets
         log_message("Setting up communication channels...");
         context_ = zmq::context_t(1);
@@ -59,6 +74,25 @@ bool SlaveAgent::initialize() {
         file_socket_.connect(file_endpoint);
         log_message("File socket connected");
 
+        // Socket for receiving file-transfer credits from master
+        log_message("Creating credit socket (PULL)...");
+        credit_socket_ = zmq::socket_t(context_, zmq::socket_type::pull);
+        std::string credit_endpoint = "tcp://" + config_.master_address + ":" + std::to_string(config_.credit_port);
+        log_message("Connecting credit socket to: " + credit_endpoint);
+        credit_socket_.connect(credit_endpoint);
+        log_message("Credit socket connected");
+
+        // Socket for forwarding merged batches to master during acquisition
+        if (config_.live_stream) {
+            log_message("Creating live stream socket (PUSH)...");
+            live_socket_ = zmq::socket_t(context_, zmq::socket_type::push);
+            live_socket_.set(zmq::sockopt::sndtimeo, 5000);  // bounds the wait for the end-of-stream marker
+            std::string live_endpoint = "tcp://" + config_.master_address + ":" + std::to_string(config_.live_port);
+            log_message("Connecting live stream socket to: " + live_endpoint);
+            live_socket_.connect(live_endpoint);
+            log_message("Live stream socket connected");
+        }
+
         // Socket for sending heartbeat/status messages
         log_message("Creating status socket (PUSH)...");
         status_socket_ = zmq::socket_t(context_, zmq::socket_type::push);
@@ -112,6 +146,7 @@ bool SlaveAgent::initialize() {
         start_trigger_listener_thread();
         start_command_handler_thread();
         start_heartbeat_thread();
+        start_file_sender_thread();
         
         log_message("Slave Agent initialized successfully.");
         return true;
@@ -156,11 +191,29 @@ void SlaveAgent::stop() {
             }
         }
         
+        // A transfer in progress runs to completion (or its credit timeout); queued ones are dropped
+        {
+            std::lock_guard<std::mutex> lock(transfer_mutex_);
+            transfer_cv_.notify_all();
+        }
+        if (sender_thread_.joinable()) {
+            try {
+                sender_thread_.join();
+                log_message("File sender thread stopped");
+            } catch (const std::exception& e) {
+                log_message("ERROR: Failed to join file sender thread: " + std::string(e.what()));
+            }
+        }
+        
+        close_acquisition_session();
+        
         // Close sockets
         try {
             trigger_socket_.close();
             status_socket_.close();
             file_socket_.close();
+            credit_socket_.close();
+            live_socket_.close();
             status_socket_.close();
             command_socket_.close();
             sync_socket_.close();
@@ -264,9 +317,14 @@ void SlaveAgent::start_command_handler_thread() {
                             else if (command == "request_partial_data") {
                                 // Master requests 10% partial data
                                 log_message("Master requested partial data");
-                                if (!latest_timestamps_.empty()) {
-                                    size_t partial_count = static_cast<size_t>(latest_timestamps_.size() * 0.1);
-                                    if (partial_count < 10) partial_count = std::min(static_cast<size_t>(10), latest_timestamps_.size());
+                                // Sliced from the binary output through a mapped view, not from a copy in RAM
+                                std::unique_ptr<TimestampFileView> records;
+                                if (!latest_bin_filename_.empty() && fs::exists(latest_bin_filename_)) {
+                                    records = std::make_unique<TimestampFileView>(latest_bin_filename_);
+                                }
+                                if (records && !records->empty()) {
+                                    size_t partial_count = static_cast<size_t>(records->size() * 0.1);
+                                    if (partial_count < 10) partial_count = std::min(static_cast<size_t>(10), records->size());
                                     
                                     // First respond to confirm the request
                                     response["status"] = "ok";
@@ -281,12 +339,7 @@ void SlaveAgent::start_command_handler_thread() {
                                     std::this_thread::sleep_for(std::chrono::seconds(1));
                                     
                                     // Now send the actual partial data
-                                    std::vector<uint64_t> partial_timestamps(latest_timestamps_.begin(), latest_timestamps_.begin() + partial_count);
-                                    std::vector<int> partial_channels(latest_channels_.begin(), latest_channels_.begin() + partial_count);
-                                    
-                                    send_partial_data_to_master(partial_timestamps, partial_channels, 1);
-                                    
-                                    log_message("Partial data sent successfully (" + std::to_string(partial_count) + " timestamps)");
+                                    send_partial_data_to_master(*records, partial_count, 1);
                                     continue; // Skip the normal response since we already sent it
                                 } else {
                                     response["status"] = "error";
@@ -297,9 +350,22 @@ void SlaveAgent::start_command_handler_thread() {
                                 // Master requests full binary data
                                 log_message("Master requested full data");
                                 if (!latest_bin_filename_.empty() && fs::exists(latest_bin_filename_)) {
-                                    send_file_to_master(latest_bin_filename_);
+                                    // Reply first, then queue the transfer for the sender thread
                                     response["status"] = "ok";
-                                    response["message"] = "Full data sent";
+                                    response["message"] = "Full data will be sent";
+                                    
+                                    std::string response_str = response.dump();
+                                    zmq::message_t response_msg(response_str.size());
+                                    memcpy(response_msg.data(), response_str.c_str(), response_str.size());
+                                    command_socket_.send(response_msg, zmq::send_flags::none);
+                                    
+                                    // The text export, when there is one, travels alongside as a second transfer
+                                    std::vector<OutgoingFile> files{describe_file(latest_bin_filename_, FileKind::FullData)};
+                                    if (!latest_txt_filename_.empty() && fs::exists(latest_txt_filename_)) {
+                                        files.push_back(describe_file(latest_txt_filename_, FileKind::TextData));
+                                    }
+                                    send_files_to_master(files);
+                                    continue; // Skip the normal response since we already sent it
                                 } else {
                                     response["status"] = "error";
                                     response["message"] = "No data file available";
@@ -308,15 +374,64 @@ void SlaveAgent::start_command_handler_thread() {
                             else if (command == "request_text_data") {
                                 // Master requests text data
                                 log_message("Master requested text data");
+                                if (latest_txt_filename_.empty() && !latest_merged_filename_.empty() &&
+                                    fs::exists(latest_merged_filename_)) {
+                                    // Text output was not generated during acquisition; produce it now
+                                    latest_txt_filename_ = fs::path(latest_merged_filename_).replace_extension(".txt").string();
+                                    write_merged_as_text(latest_merged_filename_, latest_txt_filename_);
+                                }
                                 if (!latest_txt_filename_.empty() && fs::exists(latest_txt_filename_)) {
-                                    send_file_to_master(latest_txt_filename_);
                                     response["status"] = "ok";
-                                    response["message"] = "Text data sent";
+                                    response["message"] = "Text data will be sent";
+                                    
+                                    std::string response_str = response.dump();
+                                    zmq::message_t response_msg(response_str.size());
+                                    memcpy(response_msg.data(), response_str.c_str(), response_str.size());
+                                    command_socket_.send(response_msg, zmq::send_flags::none);
+                                    
+                                    send_file_to_master(latest_txt_filename_, FileKind::TextData);
+                                    continue; // Skip the normal response since we already sent it
                                 } else {
                                     response["status"] = "error";
                                     response["message"] = "No text file available";
                                 }
                             }
+                            else if (command == "resume_transfer") {
+                                // Master lost part of a file transfer and asks for the rest
+                                uint64_t transfer_id = command_json.value("transfer_id", uint64_t(0));
+                                uint64_t offset = command_json.value("offset", uint64_t(0));
+                                OutgoingFile file;
+                                bool known = false;
+                                {
+                                    std::lock_guard<std::mutex> lock(transfer_mutex_);
+                                    auto transfer = sent_transfers_.find(transfer_id);
+                                    if (transfer != sent_transfers_.end()) {
+                                        file = transfer->second;
+                                        known = true;
+                                    }
+                                }
+                                if (known && fs::exists(file.path)) {
+                                    // The remainder goes out under a new id, so credits still queued
+                                    // from the interrupted attempt are not counted. It is queued
+                                    // behind the interrupted attempt, which gives up on its own.
+                                    file.transfer_id = FileSender::new_transfer_id();
+                                    file.start_offset = offset;
+                                    response["status"] = "ok";
+                                    response["message"] = "Resuming " + file.path;
+                                    response["transfer_id"] = file.transfer_id;
+                                    
+                                    std::string response_str = response.dump();
+                                    zmq::message_t response_msg(response_str.size());
+                                    memcpy(response_msg.data(), response_str.c_str(), response_str.size());
+                                    command_socket_.send(response_msg, zmq::send_flags::none);
+                                    
+                                    send_files_to_master({file});
+                                    continue; // Skip the normal response since we already sent it
+                                } else {
+                                    response["status"] = "error";
+                                    response["message"] = "Unknown transfer";
+                                }
+                            }
                             else if (command == "request_ready") {
                                 // NEW: Master is requesting the slave to send ready signal
                                 log_message("Master requested ready signal, preparing to send...", true);
@@ -471,6 +586,13 @@ void SlaveAgent::start_heartbeat_thread() {
 void SlaveAgent::process_trigger(uint64_t trigger_timestamp, int sequence, double duration, const std::vector<int>& channels) {
     try {
         log_message("Processing trigger command (sequence " + std::to_string(sequence) + ")");
+        latest_sequence_ = static_cast<uint32_t>(sequence);
+        latest_channel_mask_ = 0;
+        for (int ch : channels) {
+            if (ch >= 0 && ch < 64) {
+                latest_channel_mask_ |= uint64_t(1) << ch;
+            }
+        }
         log_message("Trigger timestamp: " + std::to_string(trigger_timestamp) + " ns");
         log_message("Duration: " + std::to_string(duration) + " seconds");
         log_message("Channels: " + std::to_string(channels.size()) + " channels");
@@ -493,167 +615,129 @@ void SlaveAgent::process_trigger(uint64_t trigger_timestamp, int sequence, doubl
         // Start local acquisition
         log_message("Starting local acquisition...");
         
-        // Configure the Time Controller for acquisition
-        configure_timestamps_references(local_tc_socket_, channels);
-        
-        // Set up acquisition parameters
-        for (int ch : channels) {
-            zmq_exec(local_tc_socket_, "RAW" + std::to_string(ch) + ":SEND ON");
-        }
-        
         // Proc        // Use the exact working data collection approach from DataLinkTargetService
         log_message("Starting working data collection approach...");
         
         try {
-            // Connect to DataLinkTargetService (DLT) - using the working approach
             std::filesystem::path output_dir = fs::path(config_.output_dir);
-            zmq::socket_t dlt = dlt_connect(output_dir);
-            
-            // Close any prior acquisitions (clean slate)
-            close_active_acquisitions(dlt);
-            
-            // Ensure each channel's timestamps have no external reference (needed for merging)
-            for (int ch : channels) {
-                zmq_exec(local_tc_socket_, "RAW" + std::to_string(ch) + ":REF:LINK NONE");
-                zmq_exec(local_tc_socket_, "RAW" + std::to_string(ch) + ":ERRORS:CLEAR");
-            }
             
             // Compute pulse width (PWID) and period (PPER) in picoseconds for sub-acquisitions
             long long pwid_ps = static_cast<long long>(1e12 * duration);
             long long pper_ps = static_cast<long long>(1e12 * (duration + 40e-9));  // add 40 ns dead-time
             
-            // Configure the Time Controller's recording settings for synchronized sub-acquisitions
-            zmq_exec(local_tc_socket_, "REC:TRIG:ARM:MODE MANUal");  // manual trigger mode
-            zmq_exec(local_tc_socket_, "REC:ENABle ON");             // enable the Record generator
-            zmq_exec(local_tc_socket_, "REC:STOP");                 // ensure no acquisition is currently running
-            zmq_exec(local_tc_socket_, "REC:NUM 1");                // single acquisition
-            zmq_exec(local_tc_socket_, "REC:PWID " + std::to_string(pwid_ps) + ";PPER " + std::to_string(pper_ps));
+            // The DLT connection, the channel streams and the REC:* configuration are kept across
+            // triggers; they are only set up again when the acquisition settings change
+            AcquisitionSessionConfig session_config;
+            session_config.tc_address = config_.local_tc_address;
+            session_config.channels = channels;
+            session_config.output_dir = output_dir;
+            session_config.pwid_ps = pwid_ps;
+            session_config.pper_ps = pper_ps;
+            session_config.record_count = "1";  // single sub-acquisition per trigger
+            session_config.stream_options.zero_copy = config_.zero_copy_ingest;
+            session_config.stream_options.memory_budget = config_.memory_budget_bytes;
+            session_config.stream_options.process_memory_budget = config_.process_memory_budget_bytes;
+            session_config.stream_options.spill_dir = config_.spill_dir;
+            session_config.receivers = ThreadPlacement{config_.receiver_cpus, config_.rt_priority};
+            if (session_ && session_->config() != session_config) {
+                close_acquisition_session();
+            }
+            if (!session_) {
+                log_message("Opening acquisition session (DLT streams and Time Controller configuration)...");
+                session_.reset(new AcquisitionSession(local_tc_socket_, session_config));
+                session_->open();
+            } else {
+                log_message("Reusing acquisition session (" + std::to_string(session_->files_recorded()) + " files so far)", true);
+            }
             
-            // Open streamed acquisitions on each requested channel
-            std::map<int, std::string> acquisitions_id;
-            std::vector<BufferStreamClient*> stream_clients;
+            // Create output file for merged timestamps (binary columnar, see timestamp_file.hpp)
+            std::string output_file = (output_dir / ("slave_results_" + get_current_timestamp_str() + ".tsm")).string();
             
-            for (int ch : channels) {
-                zmq_exec(local_tc_socket_, "RAW" + std::to_string(ch) + ":ERRORS:CLEAR");  // reset error counter on channel
-                
-                // Start a BufferStreamClient to receive timestamps for this channel
-                BufferStreamClient* client = new BufferStreamClient(ch);
-                stream_clients.push_back(client);
-                client->start();
-                
-                // Instruct DLT to start streaming this channel to the given port
-                std::string cmd = "start-stream --address " + config_.local_tc_address + 
-                                  " --channel " + std::to_string(ch) + 
-                                  " --stream-port " + std::to_string(client->port);
-                json response = dlt_exec(dlt, cmd);
-                if (response.contains("id")) {
-                    acquisitions_id[ch] = response["id"].get<std::string>();
-                }
-                
-                // Tell the Time Controller to send timestamps from this channel
-                zmq_exec(local_tc_socket_, "RAW" + std::to_string(ch) + ":SEND ON");
+            // Start the merging thread to combine incoming timestamps on the fly
+            TimestampsMergerThread merger(session_->streams(), output_file, static_cast<uint64_t>(pper_ps));
+            
+            // Optionally count coincidences on the merged stream as it is produced
+            std::unique_ptr<CoincidenceCounter> coincidences;
+            if (config_.coincidence_window_ps > 0) {
+                CoincidenceConfig coincidence_config;
+                coincidence_config.window = config_.coincidence_window_ps;
+                coincidences.reset(new CoincidenceCounter(coincidence_config));
+                merger.set_coincidence_counter(coincidences.get());
             }
             
-            // Create output file for merged timestamps
-            std::string output_file = (output_dir / ("slave_results_" + get_current_timestamp_str() + ".txt")).string();
+            // Optionally forward the merged batches to the master while acquiring
+            std::unique_ptr<LiveStreamSender> live_stream;
+            if (config_.live_stream) {
+                live_stream.reset(new LiveStreamSender(live_socket_, latest_sequence_));
+                merger.set_live_stream(live_stream.get());
+            }
+            merger.set_placement(ThreadPlacement{config_.merger_cpus, config_.rt_priority});
             
-            // Start the merging thread to combine incoming timestamps on the fly
-            TimestampsMergerThread merger(stream_clients, output_file, static_cast<uint64_t>(pper_ps));
+            // Start the synchronized acquisition on the Time Controller. play() clears what is left
+            // of the previous file from the rings, so the merger starts right after it.
+            log_message("Starting acquisition with REC:PLAY...");
+            session_->play();
             merger.start();
             
-            // Start the synchronized acquisition on the Time Controller
-            log_message("Starting acquisition with REC:PLAY...");
-            zmq_exec(local_tc_socket_, "REC:PLAY");
+            // Periodically log the stream and merger counters
+            std::unique_ptr<StreamMetricsReporter> metrics;
+            if (config_.stats_interval > 0.0) {
+                metrics.reset(new StreamMetricsReporter(session_->streams(), &merger,
+                    std::chrono::milliseconds(static_cast<int>(config_.stats_interval * 1000))));
+                metrics->start();
+            }
             
             // Wait for the specified duration
             std::this_thread::sleep_for(std::chrono::milliseconds(static_cast<int>(duration * 1000)));
             
-            // Stop the acquisition
+            // Stop the acquisition and wait for the sub-acquisition to be transferred
             log_message("Stopping local acquisition...");
-            zmq_exec(local_tc_socket_, "REC:STOP");
-            
-            // Wait for data processing to complete
             log_message("Waiting for data processing to complete...");
-            wait_end_of_timestamps_acquisition(local_tc_socket_, dlt, acquisitions_id, 30.0);
+            session_->stop(30.0);
             
             // Stop the merger thread
             merger.join();
+            if (metrics) {
+                metrics->stop();
+            }
             
-            // Stop and clean up stream clients
-            for (BufferStreamClient* client : stream_clients) {
-                client->join();
-                delete client;
+            if (live_stream) {
+                log_message("Live stream to master: " + live_stream->summary());
             }
             
-            // Close active acquisitions
-            close_active_acquisitions(dlt);
+            if (coincidences) {
+                std::string coincidence_file = fs::path(output_file).replace_extension("").string() + "_coincidences.txt";
+                coincidences->write_report(coincidence_file);
+                log_message("Coincidences: " + coincidences->summary());
+                log_message("Coincidence report saved to: " + coincidence_file);
+            }
             
             log_message("Data collection completed successfully using working approach");
             
-            // Convert the text output to binary format for compatibility
+            // Convert the merged output to the 12-byte record format used for transfers and synchronization
             if (fs::exists(output_file)) {
-                log_message("Converting merged data to binary format...");
+                log_message("Converting merged data to binary record format...");
                 
                 // Generate output filename based on current timestamp
                 fs::path slave_output_base = fs::path(config_.output_dir) / ("slave_results_" + get_current_timestamp_str());
-                
-                // Read the merged text file and convert to binary
-                std::ifstream infile(output_file);
                 std::string bin_filename = slave_output_base.string() + ".bin";
-                std::ofstream bin_file(bin_filename, std::ios::binary);
-                
-                std::string line;
-                int total_timestamps = 0;
-                std::vector<uint64_t> all_timestamps;
-                std::vector<int> all_channels;
-                
-                while (std::getline(infile, line)) {
-                    // Skip empty lines
-                    if (line.empty()) continue;
-                    
-                    try {
-                        size_t semicolon_pos = line.find(';');
-                        if (semicolon_pos != std::string::npos) {
-                            std::string channel_str = line.substr(0, semicolon_pos);
-                            std::string timestamp_str = line.substr(semicolon_pos + 1);
-                            
-                            // Trim whitespace
-                            channel_str.erase(0, channel_str.find_first_not_of(" \t\r\n"));
-                            channel_str.erase(channel_str.find_last_not_of(" \t\r\n") + 1);
-                            timestamp_str.erase(0, timestamp_str.find_first_not_of(" \t\r\n"));
-                            timestamp_str.erase(timestamp_str.find_last_not_of(" \t\r\n") + 1);
-                            
-                            // Validate strings are not empty
-                            if (!channel_str.empty() && !timestamp_str.empty()) {
-                                int channel = std::stoi(channel_str);
-                                uint64_t timestamp = std::stoull(timestamp_str);
-                                all_timestamps.push_back(timestamp);
-                                all_channels.push_back(channel);
-                                total_timestamps++;
-                            }
-                        }
-                    } catch (const std::exception& e) {
-                        log_message("WARNING: Failed to parse line: '" + line + "' - " + std::string(e.what()));
-                        continue; // Skip invalid lines
-                    }
-                }
-                infile.close();
-                
-                // Write binary data
-                for (size_t i = 0; i < all_timestamps.size(); ++i) {
-                    bin_file.write(reinterpret_cast<const char*>(&all_timestamps[i]), sizeof(uint64_t));
-                    bin_file.write(reinterpret_cast<const char*>(&all_channels[i]), sizeof(int));
-                }
-                bin_file.close();
+                uint64_t total_timestamps = convert_merged_to_records(output_file, bin_filename);
                 
                 log_message("Converted " + std::to_string(total_timestamps) + " timestamps to binary format");
                 log_message("Saved slave timestamps to " + bin_filename);
                 
-                // Store data for master requests (don't send automatically)
-                latest_timestamps_ = all_timestamps;
-                latest_channels_ = all_channels;
+                // Text output is an optional post-process of the binary output
+                std::string txt_filename;
+                if (config_.text_output) {
+                    txt_filename = slave_output_base.string() + ".txt";
+                    write_merged_as_text(output_file, txt_filename);
+                    log_message("Saved timestamps in text format to " + txt_filename);
+                }
+                
+                // Keep the file names for master requests (don't send automatically)
                 latest_bin_filename_ = bin_filename;
-                latest_txt_filename_ = output_file;
+                latest_txt_filename_ = txt_filename;
+                latest_merged_filename_ = output_file;
                 
                 log_message("Slave data collection completed successfully");
                 log_message("Data ready - waiting for master requests...");
@@ -663,6 +747,7 @@ void SlaveAgent::process_trigger(uint64_t trigger_timestamp, int sequence, doubl
             
         } catch (const std::exception& e) {
             log_message("ERROR: Working data collection failed: " + std::string(e.what()));
+            session_.reset();  // set up from scratch for the next trigger
             log_message("This may be due to DLT not responding to commands properly.");
             log_message("Falling back to direct Time Controller data collection...");
             
@@ -725,12 +810,7 @@ void SlaveAgent::process_trigger(uint64_t trigger_timestamp, int sequence, doubl
                         
                         // Save to binary file
                         std::string bin_filename = slave_output_base.string() + ".bin";
-                        std::ofstream bin_file(bin_filename, std::ios::binary);
-                        for (size_t i = 0; i < timestamps.size(); ++i) {
-                            bin_file.write(reinterpret_cast<const char*>(&timestamps[i]), sizeof(uint64_t));
-                            bin_file.write(reinterpret_cast<const char*>(&channels_vec[i]), sizeof(int));
-                        }
-                        bin_file.close();
+                        write_timestamp_records(bin_filename, timestamps, channels_vec);
                         
                         // Save to text file if requested
                         if (config_.text_output) {
@@ -742,7 +822,7 @@ void SlaveAgent::process_trigger(uint64_t trigger_timestamp, int sequence, doubl
                         log_message("Saved slave timestamps to " + bin_filename);
                         
                         // Send file to master
-                        send_file_to_master(bin_filename);
+                        send_file_to_master(bin_filename, FileKind::FullData);
                         
                         break; // Only process first channel with data for now
                     }
@@ -771,24 +851,33 @@ json SlaveAgent::handle_partial_data_request() {
     try {
         log_message("Handling partial data request for synchronization");
         
-        if (latest_timestamps_.empty()) {
+        if (latest_bin_filename_.empty() || !fs::exists(latest_bin_filename_)) {
+            response["status"] = "error";
+            response["message"] = "No timestamp data available";
+            return response;
+        }
+        TimestampFileView records(latest_bin_filename_);
+        if (records.empty()) {
             response["status"] = "error";
             response["message"] = "No timestamp data available";
             return response;
         }
         
         // Calculate how many timestamps to send (10% of total)
-        size_t count = std::max(size_t(1), latest_timestamps_.size() / 10);
-        count = std::min(count, latest_timestamps_.size());
+        size_t count = std::max(size_t(1), records.size() / 10);
+        count = std::min(count, records.size());
         
         // Extract the first 'count' timestamps
-        std::vector<uint64_t> partial_timestamps(latest_timestamps_.begin(), 
-                                               latest_timestamps_.begin() + count);
+        std::vector<uint64_t> partial_timestamps;
+        partial_timestamps.reserve(count);
+        for (size_t i = 0; i < count; ++i) {
+            partial_timestamps.push_back(records.timestamp(i));
+        }
         
         response["status"] = "ok";
         response["timestamps"] = partial_timestamps;
         response["count"] = count;
-        response["total"] = latest_timestamps_.size();
+        response["total"] = records.size();
         
         log_message("Sending " + std::to_string(count) + " timestamps for synchronization");
     }
@@ -800,43 +889,108 @@ json SlaveAgent::handle_partial_data_request() {
     return response;
 }
 
-void SlaveAgent::send_file_to_master(const std::string& filename) {
+OutgoingFile SlaveAgent::describe_file(const std::string& filename, FileKind kind) const {
+    OutgoingFile file;
+    file.path = filename;
+    file.descriptor.kind = kind;
+    file.descriptor.sequence = latest_sequence_;
+    file.descriptor.channel_mask = latest_channel_mask_;
+    if (kind == FileKind::TextData) {
+        file.descriptor.format_version = FileDescriptor::kTextFormat;
+    } else {
+        file.descriptor.format_version = FileDescriptor::kRecordFormat;
+        file.descriptor.record_count = fs::file_size(filename) / 12;
+    }
+    return file;
+}
+
+void SlaveAgent::send_file_to_master(const std::string& filename, FileKind kind) {
     try {
-        log_message("Sending file to master: " + filename);
-        
-        // Read the file
-        std::ifstream file(filename, std::ios::binary);
-        if (!file) {
-            throw std::runtime_error("Could not open file: " + filename);
+        send_files_to_master({describe_file(filename, kind)});
+    } catch (const std::exception& e) {
+        log_message("ERROR sending file to master: " + std::string(e.what()));
+    }
+}
+
+void SlaveAgent::start_file_sender_thread() {
+    sender_thread_ = std::thread([this]() {
+        log_message("File sender thread started");
+        while (true) {
+            std::vector<OutgoingFile> files;
+            {
+                std::unique_lock<std::mutex> lock(transfer_mutex_);
+                transfer_cv_.wait(lock, [this]() { return !running_ || !pending_transfers_.empty(); });
+                if (!running_) {
+                    break;
+                }
+                files = std::move(pending_transfers_.front());
+                pending_transfers_.pop_front();
+            }
+            transmit_files(std::move(files));
         }
-        
-        // Get file size
-        file.seekg(0, std::ios::end);
-        size_t file_size = file.tellg();
-        file.seekg(0, std::ios::beg);
-        
-        if (file_size == 0) {
-            throw std::runtime_error("File is empty: " + filename);
+    });
+}
+
+void SlaveAgent::send_files_to_master(std::vector<OutgoingFile> files) {
+    for (OutgoingFile& file : files) {
+        if (file.transfer_id == 0) {
+            file.transfer_id = FileSender::new_transfer_id();
         }
-        
-        // Read file content as binary
-        std::vector<uint8_t> file_content(file_size);
-        file.read(reinterpret_cast<char*>(file_content.data()), file_size);
-        
-        if (!file) {
-            throw std::runtime_error("Failed to read file content: " + filename);
+    }
+    std::lock_guard<std::mutex> lock(transfer_mutex_);
+    pending_transfers_.push_back(std::move(files));
+    transfer_cv_.notify_one();
+}
+
+void SlaveAgent::transmit_files(std::vector<OutgoingFile> files) {
+    try {
+        for (OutgoingFile& file : files) {
+            if (config_.compress_transfers && file.descriptor.format_version == FileDescriptor::kRecordFormat) {
+                // Records go out delta/bit-packed; the master restores the .bin on arrival
+                std::string compressed = fs::path(file.path).replace_extension(".tsc").string();
+                compress_record_file(file.path, compressed);
+                log_message("Compressed " + file.path + ": " + std::to_string(fs::file_size(file.path)) + " -> " +
+                            std::to_string(fs::file_size(compressed)) + " bytes", true);
+                if (file.temporary) {
+                    fs::remove(file.path);  // only the compressed copy is sent, or resent
+                }
+                file.path = compressed;
+                file.descriptor.format_version = FileDescriptor::kCompressedRecordFormat;
+            }
+            // Remembered so the master can ask for the rest of the file if the transfer is interrupted
+            {
+                std::lock_guard<std::mutex> lock(transfer_mutex_);
+                sent_transfers_[file.transfer_id] = file;
+            }
+            
+            if (file.start_offset > 0) {
+                log_message("Resuming file transfer to master: " + file.path + " from byte " + std::to_string(file.start_offset));
+            } else {
+                log_message("Sending file to master: " + file.path + " (" + file_kind_name(file.descriptor.kind) + ")");
+            }
         }
         
-        file.close();
+        // Stream the files in CRC-checked chunks; at most transfer_window chunks per file are
+        // unacknowledged, and the call returns once the master has written the last one
+        FileTransferConfig transfer_config;
+        transfer_config.chunk_size = config_.transfer_chunk_size;
+        transfer_config.window = config_.transfer_window;
+        FileSender sender(file_socket_, credit_socket_, transfer_config);
+        FileTransferStats stats = sender.send(files);
         
-        // Send the raw binary data directly (no JSON encoding)
-        zmq::message_t msg(file_content.data(), file_size);
-        auto result = file_socket_.send(msg, zmq::send_flags::none);
+        log_message(std::to_string(files.size()) + (files.size() == 1 ? " file" : " files") + " sent successfully (" + stats.summary() + ")");
         
-        if (result.has_value()) {
-            log_message("File sent successfully");
-        } else {
-            throw std::runtime_error("Failed to send file to master");
+        // Temporary files are kept until the master has them, so an interrupted transfer can resume
+        for (const OutgoingFile& file : files) {
+            if (file.descriptor.kind == FileKind::PartialData) {
+                log_message("Partial data sent successfully (" + std::to_string(file.descriptor.record_count) + " timestamps)");
+            }
+            if (file.temporary) {
+                std::error_code ec;
+                fs::remove(file.path, ec);
+                std::lock_guard<std::mutex> lock(transfer_mutex_);
+                sent_transfers_.erase(file.transfer_id);
+            }
         }
         
     } catch (const std::exception& e) {
@@ -844,6 +998,17 @@ void SlaveAgent::send_file_to_master(const std::string& filename) {
     }
 }
 
+void SlaveAgent::close_acquisition_session() {
+    if (!session_) {
+        return;
+    }
+    log_message("Closing acquisition session after " + std::to_string(session_->files_recorded()) + " files...");
+    if (!session_->close()) {
+        log_message("WARNING: The acquisition session reported errors (see channel messages above)");
+    }
+    session_.reset();
+}
+
 void SlaveAgent::log_message(const std::string& message, bool verbose_only) {
     if (verbose_only && !config_.verbose_output) {
         return;
@@ -904,30 +1069,28 @@ void SlaveAgent::write_timestamps_to_txt(const std::vector<uint64_t>& timestamps
 }
 
 
-void SlaveAgent::send_partial_data_to_master(const std::vector<uint64_t>& timestamps, const std::vector<int>& channels, int sequence) {
+void SlaveAgent::send_partial_data_to_master(const TimestampFileView& records, size_t count, int sequence) {
     try {
         log_message("Sending partial data to master (sequence " + std::to_string(sequence) + ")...");
         
         // Create a temporary partial data file
         std::string partial_filename = fs::path(config_.output_dir) / ("partial_data_" + std::to_string(sequence) + ".bin");
-        std::ofstream partial_file(partial_filename, std::ios::binary);
         
         // Write partial data in binary format
-        for (size_t i = 0; i < timestamps.size(); ++i) {
-            partial_file.write(reinterpret_cast<const char*>(&timestamps[i]), sizeof(uint64_t));
-            partial_file.write(reinterpret_cast<const char*>(&channels[i]), sizeof(int));
+        TimestampRecordWriter writer(partial_filename);
+        for (size_t i = 0; i < count && i < records.size(); ++i) {
+            writer.append(records.timestamp(i), records.channel(i));
         }
-        partial_file.close();
-        
-        log_message("Created partial data file: " + partial_filename + " (" + std::to_string(timestamps.size()) + " timestamps)");
+        writer.close();
         
-        // Send the partial file to master
-        send_file_to_master(partial_filename);
+        log_message("Created partial data file: " + partial_filename + " (" + std::to_string(writer.record_count()) + " timestamps)");
         
-        // Clean up temporary file
-        std::filesystem::remove(partial_filename);
+        // Queue the partial file for the sender thread, which deletes it once the master has it
+        OutgoingFile file = describe_file(partial_filename, FileKind::PartialData);
+        file.temporary = true;
+        send_files_to_master({file});
         
-        log_message("Partial data sent successfully (sequence " + std::to_string(sequence) + ")");
+        log_message("Partial data queued for the master (sequence " + std::to_string(sequence) + ")");
         
     } catch (const std::exception& e) {
         log_message("ERROR: Failed to send partial data: " + std::string(e.what()));
@@ -5,12 +5,19 @@
 #include <thread>
 #include <atomic>
 #include <mutex>
+#include <condition_variable>
+#include <map>
+#include <memory>
 #include <chrono>
 #include <filesystem>
 #include <zmq.hpp>
 #include "json.hpp"
 #include "working_common.hpp"
 #include "streams.hpp"
+#include "timestamp_file_view.hpp"
+#include "cross_correlation.hpp"
+#include "offset_estimator.hpp"
+#include "acquisition_session.hpp"
 
 namespace fs = std::filesystem;
 using json = nlohmann::json;
@@ -37,6 +44,24 @@ struct MasterConfig {
     int file_port;                   // Port for file transfer
     int command_port;                // Port for command messages
     int sync_port;                   // Port for subscription synchronization
+    int credit_port = 5563;          // Port for file-transfer credits (master -> slave)
+    bool live_stream = false;        // Receive the slave's merged batches during acquisition
+    int live_port = 5564;            // Port for the live stream (slave -> master)
+    bool zero_copy_ingest = true;    // Keep received DLT frames instead of copying their payload
+    int64_t coincidence_window_ps = 0; // Count channel-pair coincidences live while merging (0: off)
+    double stats_interval = 1.0;     // Seconds between stream/merger metrics reports (0: off)
+    uint64_t memory_budget_bytes = 0;         // RAM per channel for buffered timestamps before spilling to disk (0: no limit)
+    uint64_t process_memory_budget_bytes = 0; // RAM for buffered timestamps of all channels together (0: no limit)
+    std::string spill_dir;           // Directory for spill files (empty: system temporary directory)
+    std::vector<int> receiver_cpus;  // CPUs for the channel receiver threads, one per channel in turn (empty: any)
+    std::vector<int> merger_cpus;    // CPUs for the merger thread (empty: any)
+    std::vector<int> io_cpus;        // CPUs for the ZeroMQ I/O thread of the DLT streams (empty: any)
+    int rt_priority = 0;             // SCHED_FIFO priority of those threads (0: normal scheduling)
+    bool xcorr_sync = true;          // Estimate the clock offset by cross-correlating master and slave events
+    int64_t xcorr_max_offset_ps = 0; // Largest offset searched by the cross-correlation (0: unrestricted)
+    int64_t xcorr_bin_ps = 50;       // Fine histogram bin of the cross-correlation
+    double file_duration = 0.0;      // Start a new output file every N seconds of acquisition (0: one file)
+    uint64_t file_size_bytes = 0;    // Start a new output file at about this size (0: no limit)
 };
 
 // Master Controller class
@@ -53,14 +78,24 @@ public:
     
     // Thread functions
     void start_monitor_thread();
-    void start_file_receiver_thread();
+    // Receives the slave's files; partial data is synchronized against `master_file_path`
+    void start_file_receiver_thread(const std::string& master_file_path);
+    void start_live_receiver_thread();
     
     // Helper methods
     bool check_slave_availability();
     void log_message(const std::string& message, bool verbose_only = false);
     std::string get_current_timestamp_str();
     void write_offset_report(const std::string& filename, double mean_offset, double min_offset, double max_offset, double std_dev, double relative_spread);
-    void perform_synchronization_calculation(const std::string& slave_file_path);
+    // Runs on the file receiver's sync threads, so the master records are passed in rather than
+    // read from latest_bin_filename_
+    void perform_synchronization_calculation(const std::string& slave_file_path, const std::string& master_file_path);
+    // Cross-correlate the slave's partial data with the master records; when an offset is found,
+    // the offsets of the event pairs it matches are added to `matched`
+    CrossCorrelationResult estimate_offset_from_partial_data(const TimestampFileView& master_records,
+                                                             const TimestampFileView& slave_records,
+                                                             uint64_t master_start_time,
+                                                             OffsetEstimator& matched);
     void apply_synchronization_correction(const std::string& master_file_path, int64_t offset);
     void save_synchronization_report(double mean_offset, int64_t min_offset, int64_t max_offset, double std_dev, size_t sample_count);
     void write_timestamps_to_txt(const std::vector<uint64_t>& timestamps, 
@@ -70,7 +105,14 @@ public:
     void request_partial_data_from_slave_with_response();
     void request_full_data_from_slave();
     void request_text_data_from_slave();
+    // Ask the slave to send an interrupted file again from `offset`; returns the new transfer id (0: refused)
+    uint64_t request_transfer_resume(uint64_t transfer_id, uint64_t offset);
     bool finalize_communication();
+    // Release the DLT streams and stream clients kept between files
+    void close_acquisition_session();
+    // Wait until the slave's live stream of acquisition `sequence` has ended; returns the record
+    // file it was written to ("" on timeout)
+    std::string wait_for_live_stream(uint32_t sequence, double timeout_seconds);
     
 private:
     // Configuration
@@ -81,6 +123,8 @@ private:
     zmq::socket_t trigger_socket_;
     zmq::socket_t status_socket_;
     zmq::socket_t file_socket_;
+    zmq::socket_t credit_socket_;
+    zmq::socket_t live_socket_;
     zmq::socket_t status_socket_;
     zmq::socket_t command_socket_;
     zmq::socket_t sync_socket_;
@@ -89,11 +133,11 @@ private:
     // State variables
     std::atomic<bool> running_;
     std::atomic<bool> acquisition_active_;
-    uint32_t command_sequence_;
+    std::atomic<uint32_t> command_sequence_;
     
-    // Data storage for synchronization
-    std::vector<uint64_t> latest_timestamps_;
-    std::vector<int> latest_channels_;
+    // Data for synchronization: the last acquisition's 12-byte record file, streamed on demand
+    // rather than held in memory
+    std::string latest_bin_filename_;
     uint64_t master_trigger_timestamp_ns_;  // Master's trigger timestamp
     uint64_t slave_trigger_timestamp_ns_;   // Slave's trigger timestamp (received)
     int64_t calculated_offset_ns_;
@@ -101,13 +145,20 @@ private:
     double acquisition_duration_;
     std::chrono::steady_clock::time_point acquisition_start_time_;
     std::vector<int> active_channels_;
+    std::unique_ptr<AcquisitionSession> session_;  // reused across files while the settings match
     
     // Thread management
     std::thread monitor_thread_;
     std::thread status_thread_;
     std::thread file_receiver_thread_;
+    std::thread live_receiver_thread_;
     std::mutex mutex_;
+    std::mutex command_mutex_;       // serializes request/reply exchanges on command_socket_
+    std::mutex live_mutex_;
+    std::condition_variable live_cv_;
+    std::map<uint32_t, std::string> live_files_;  // acquisition sequence -> completed live stream record file
     
     // Helper functions
-    bool send_command_to_slave(json& command, json& response);
+    // One request/reply exchange on command_socket_ (under command_mutex_); false on timeout or error
+    bool send_command_to_slave(json& command, json& response, int timeout_ms = 5000);
 };
@@ -5,12 +5,19 @@
 #include <thread>
 #include <atomic>
 #include <mutex>
+#include <condition_variable>
+#include <deque>
 #include <chrono>
 #include <filesystem>
+#include <map>
+#include <memory>
 #include <zmq.hpp>
 #include "json.hpp"
 #include "working_common.hpp"
 #include "streams.hpp"
+#include "file_transfer.hpp"
+#include "timestamp_file_view.hpp"
+#include "acquisition_session.hpp"
 
 namespace fs = std::filesystem;
 using json = nlohmann::json;
@@ -35,7 +42,23 @@ struct SlaveConfig {
     int file_port;                   // Port for file transfer
     int command_port;                // Port for command messages
     int sync_port;                   // Port for subscription synchronization
+    int credit_port = 5563;          // Port for file-transfer credits (master -> slave)
+    size_t transfer_chunk_size = size_t(1) << 20; // Payload bytes per file-transfer chunk
+    unsigned transfer_window = 8;    // File-transfer chunks in flight before waiting for a credit
+    bool compress_transfers = false; // Send record files delta/bit-packed (.tsc) instead of raw .bin
+    bool live_stream = false;        // Forward merged batches to the master during acquisition
+    int live_port = 5564;            // Port for the live stream (slave -> master)
     int heartbeat_interval_ms;       // Interval for heartbeat messages in milliseconds
+    bool zero_copy_ingest = true;    // Keep received DLT frames instead of copying their payload
+    int64_t coincidence_window_ps = 0; // Count channel-pair coincidences live while merging (0: off)
+    double stats_interval = 1.0;     // Seconds between stream/merger metrics reports (0: off)
+    uint64_t memory_budget_bytes = 0;         // RAM per channel for buffered timestamps before spilling to disk (0: no limit)
+    uint64_t process_memory_budget_bytes = 0; // RAM for buffered timestamps of all channels together (0: no limit)
+    std::string spill_dir;           // Directory for spill files (empty: system temporary directory)
+    std::vector<int> receiver_cpus;  // CPUs for the channel receiver threads, one per channel in turn (empty: any)
+    std::vector<int> merger_cpus;    // CPUs for the merger thread (empty: any)
+    std::vector<int> io_cpus;        // CPUs for the ZeroMQ I/O thread of the DLT streams (empty: any)
+    int rt_priority = 0;             // SCHED_FIFO priority of those threads (0: normal scheduling)
 };
 
 // Slave Agent class
@@ -51,17 +74,27 @@ public:
     void start_trigger_listener_thread();
     void start_command_handler_thread();
     void start_heartbeat_thread();
+    void start_file_sender_thread();
     
     // Processing methods
     void process_trigger(uint64_t trigger_timestamp, int sequence, double duration, const std::vector<int>& channels);
     json handle_partial_data_request();
-    void send_partial_data_to_master(const std::vector<uint64_t>& timestamps, const std::vector<int>& channels, int sequence);
+    // Write the first `count` records of `records` to a temporary file and queue it for the master
+    void send_partial_data_to_master(const TimestampFileView& records, size_t count, int sequence);
     void send_trigger_timestamp_to_master(uint64_t slave_trigger_timestamp, int sequence);
     
     // Helper methods
     void log_message(const std::string& message, bool verbose_only = false);
     std::string get_current_timestamp_str();
-    void send_file_to_master(const std::string& filename);
+    void send_file_to_master(const std::string& filename, FileKind kind);
+    // Queue several files for the sender thread, to go out at once as one chunked transfer each
+    // with their chunks interleaved. Transfer ids are assigned before this returns.
+    void send_files_to_master(std::vector<OutgoingFile> files);
+    OutgoingFile describe_file(const std::string& filename, FileKind kind) const;
+    // Sender thread: compress (if enabled) and stream one queued group of files
+    void transmit_files(std::vector<OutgoingFile> files);
+    // Release the DLT streams and stream clients kept between triggers
+    void close_acquisition_session();
     void write_timestamps_to_txt(const std::vector<uint64_t>& timestamps, const std::vector<int>& channels, const std::string& filename);
     
 private:
@@ -73,6 +106,8 @@ private:
     zmq::socket_t trigger_socket_;
     zmq::socket_t status_socket_;
     zmq::socket_t file_socket_;
+    zmq::socket_t credit_socket_;
+    zmq::socket_t live_socket_;
     zmq::socket_t status_socket_;
     zmq::socket_t command_socket_;
     zmq::socket_t sync_socket_;
@@ -86,14 +121,21 @@ private:
     std::vector<int> active_channels_;
     
     // Data storage
-    std::vector<uint64_t> latest_timestamps_;
-    std::vector<int> latest_channels_;
-    std::string latest_bin_filename_;
+    std::string latest_bin_filename_;     // 12-byte records; partial data is sliced from it on request
     std::string latest_txt_filename_;
+    std::string latest_merged_filename_;   // binary columnar merger output (.tsm)
+    std::map<uint64_t, OutgoingFile> sent_transfers_;  // transfer id -> file, for resume_transfer
+    std::deque<std::vector<OutgoingFile>> pending_transfers_;  // groups of files waiting for the sender thread
+    std::mutex transfer_mutex_;          // guards sent_transfers_ and pending_transfers_
+    std::condition_variable transfer_cv_;
+    uint32_t latest_sequence_ = 0;       // acquisition sequence of the latest files
+    uint64_t latest_channel_mask_ = 0;   // channels of the latest acquisition (bit n: channel n)
+    std::unique_ptr<AcquisitionSession> session_;  // reused across triggers while the settings match
     
     // Thread management
     std::thread trigger_thread_;
     std::thread command_thread_;
     std::thread heartbeat_thread_;
+    std::thread sender_thread_;          // runs the file transfers, so the command loop stays responsive
     std::mutex mutex_;
 };
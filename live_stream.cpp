@@ -0,0 +1,131 @@
+#include "live_stream.hpp"
+#include "crc32c.hpp"
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+
+void put_u32(uint8_t* out, uint32_t value) { std::memcpy(out, &value, sizeof(value)); }
+void put_u64(uint8_t* out, uint64_t value) { std::memcpy(out, &value, sizeof(value)); }
+uint32_t get_u32(const uint8_t* in) { uint32_t value; std::memcpy(&value, in, sizeof(value)); return value; }
+uint64_t get_u64(const uint8_t* in) { uint64_t value; std::memcpy(&value, in, sizeof(value)); return value; }
+
+} // namespace
+
+void LiveBatchHeader::encode(void* out) const {
+    uint8_t* p = static_cast<uint8_t*>(out);
+    put_u32(p, magic);
+    put_u32(p + 4, flags);
+    put_u32(p + 8, sequence);
+    put_u32(p + 12, count);
+    put_u64(p + 16, index);
+    put_u64(p + 24, first_timestamp);
+    put_u32(p + 32, crc);
+    put_u32(p + 36, 0);
+}
+
+LiveBatchHeader LiveBatchHeader::decode(const void* data, size_t size) {
+    if (size < kEncodedSize) {
+        throw std::runtime_error("Live batch header too short");
+    }
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    LiveBatchHeader header;
+    header.magic = get_u32(p);
+    if (header.magic != kMagic) {
+        throw std::runtime_error("Not a live batch header");
+    }
+    header.flags = get_u32(p + 4);
+    header.sequence = get_u32(p + 8);
+    header.count = get_u32(p + 12);
+    header.index = get_u64(p + 16);
+    header.first_timestamp = get_u64(p + 24);
+    header.crc = get_u32(p + 32);
+    return header;
+}
+
+LiveStreamSender::LiveStreamSender(zmq::socket_t& socket_, uint32_t sequence_)
+    : socket(socket_), sequence(sequence_), next_index(0),
+      sent_batches(0), dropped_batches(0), sent_records(0), sent_bytes(0)
+{
+}
+
+bool LiveStreamSender::send_batch(const uint64_t* timestamps, const uint8_t* channels, size_t count) {
+    if (count == 0) {
+        return true;
+    }
+    LiveBatchHeader header;
+    header.sequence = sequence;
+    header.count = static_cast<uint32_t>(count);
+    header.index = next_index++;
+    header.first_timestamp = timestamps[0];
+    header.crc = crc32c(channels, count, crc32c(timestamps, count * sizeof(uint64_t)));
+
+    zmq::message_t header_msg(LiveBatchHeader::kEncodedSize);
+    header.encode(header_msg.data());
+    // Once the first part is queued, ZeroMQ accepts the remaining parts of the message
+    if (!socket.send(header_msg, zmq::send_flags::sndmore | zmq::send_flags::dontwait).has_value()) {
+        ++dropped_batches;
+        return false;
+    }
+    zmq::message_t timestamps_msg(timestamps, count * sizeof(uint64_t));
+    zmq::message_t channels_msg(channels, count);
+    socket.send(timestamps_msg, zmq::send_flags::sndmore);
+    socket.send(channels_msg, zmq::send_flags::none);
+    ++sent_batches;
+    sent_records += count;
+    sent_bytes += LiveBatchHeader::kEncodedSize + count * (sizeof(uint64_t) + 1);
+    return true;
+}
+
+void LiveStreamSender::finish() {
+    LiveBatchHeader header;
+    header.flags = LiveBatchHeader::kEndOfStream;
+    header.sequence = sequence;
+    header.index = next_index;
+    zmq::message_t header_msg(LiveBatchHeader::kEncodedSize);
+    header.encode(header_msg.data());
+    if (!socket.send(header_msg, zmq::send_flags::none).has_value()) {
+        throw std::runtime_error("Timed out sending the live stream end marker");
+    }
+}
+
+std::string LiveStreamSender::summary() const {
+    std::ostringstream oss;
+    oss << sent_records << " records in " << sent_batches << " batches (" << sent_bytes << " bytes)";
+    if (dropped_batches > 0) {
+        oss << ", " << dropped_batches << " batches dropped";
+    }
+    return oss.str();
+}
+
+bool receive_live_batch(zmq::socket_t& socket, LiveBatch& batch) {
+    zmq::message_t header_msg;
+    if (!socket.recv(header_msg, zmq::recv_flags::none).has_value()) {
+        return false;
+    }
+    batch.header = LiveBatchHeader::decode(header_msg.data(), header_msg.size());
+    batch.timestamps.clear();
+    batch.channels.clear();
+    if (batch.end_of_stream()) {
+        return true;
+    }
+    zmq::message_t timestamps_msg;
+    zmq::message_t channels_msg;
+    if (!header_msg.more() || !socket.recv(timestamps_msg, zmq::recv_flags::none).has_value() ||
+        !timestamps_msg.more() || !socket.recv(channels_msg, zmq::recv_flags::none).has_value()) {
+        throw std::runtime_error("Incomplete live batch");
+    }
+    const size_t count = batch.header.count;
+    if (timestamps_msg.size() != count * sizeof(uint64_t) || channels_msg.size() != count) {
+        throw std::runtime_error("Live batch size mismatch");
+    }
+    if (crc32c(channels_msg.data(), count, crc32c(timestamps_msg.data(), timestamps_msg.size())) != batch.header.crc) {
+        throw std::runtime_error("Live batch checksum mismatch");
+    }
+    batch.timestamps.resize(count);
+    batch.channels.resize(count);
+    std::memcpy(batch.timestamps.data(), timestamps_msg.data(), timestamps_msg.size());
+    std::memcpy(batch.channels.data(), channels_msg.data(), count);
+    return true;
+}
@@ -0,0 +1,77 @@
+#ifndef LIVE_STREAM_HPP
+#define LIVE_STREAM_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <zmq.hpp>
+
+// Live forwarding of merged timestamp batches from the slave to the master during acquisition.
+//
+// Every batch the slave's TimestampsMergerThread produces (one sub-acquisition, all channels,
+// time-ordered) is pushed to the master as a three-part message on the live socket (PUSH -> PULL):
+//   [LiveBatchHeader (40 bytes)][timestamps: count x uint64][channels: count x uint8]
+// After the last batch the sender pushes a header-only message flagged kEndOfStream.
+//
+// The stream never stalls the merger: a batch that cannot be queued (the master is not reading
+// fast enough and the socket's high-water mark is reached) is dropped and counted. Batch indices
+// are consecutive, so the master sees the gap. The files sent after acquisition remain the
+// complete record; the live stream is what lets the master start synchronizing early.
+
+struct LiveBatchHeader {
+    static constexpr uint32_t kMagic = 0x424C5454;      // "TTLB"
+    static constexpr uint32_t kEndOfStream = 1u << 0;   // no payload; the acquisition has ended
+    static constexpr size_t kEncodedSize = 40;
+
+    uint32_t magic = kMagic;
+    uint32_t flags = 0;
+    uint32_t sequence = 0;          // acquisition sequence (trigger) the batch belongs to
+    uint32_t count = 0;             // events in the batch
+    uint64_t index = 0;             // batch number within the acquisition; end marker: batches sent
+    uint64_t first_timestamp = 0;
+    uint32_t crc = 0;               // CRC-32C of the timestamps followed by the channels
+
+    void encode(void* out) const;
+    // Throws std::runtime_error on a short buffer or bad magic
+    static LiveBatchHeader decode(const void* data, size_t size);
+};
+
+struct LiveBatch {
+    LiveBatchHeader header;
+    std::vector<uint64_t> timestamps;
+    std::vector<uint8_t> channels;
+
+    bool end_of_stream() const { return (header.flags & LiveBatchHeader::kEndOfStream) != 0; }
+};
+
+class LiveStreamSender {
+public:
+    // `socket` is a connected PUSH socket; it is used only from the thread calling send_batch()
+    LiveStreamSender(zmq::socket_t& socket, uint32_t sequence);
+
+    // Queue one merged batch without blocking; returns false if it had to be dropped
+    bool send_batch(const uint64_t* timestamps, const uint8_t* channels, size_t count);
+    // Send the end-of-stream marker (waits up to the socket's send timeout)
+    void finish();
+
+    uint64_t batches_sent() const { return sent_batches; }
+    uint64_t batches_dropped() const { return dropped_batches; }
+    uint64_t records_sent() const { return sent_records; }
+    std::string summary() const;
+
+private:
+    zmq::socket_t& socket;
+    uint32_t sequence;
+    uint64_t next_index;
+    uint64_t sent_batches;
+    uint64_t dropped_batches;
+    uint64_t sent_records;
+    uint64_t sent_bytes;
+};
+
+// Receive the next live message (up to the socket's receive timeout); false on timeout.
+// Throws std::runtime_error on a malformed message or a checksum mismatch.
+bool receive_live_batch(zmq::socket_t& socket, LiveBatch& batch);
+
+#endif // LIVE_STREAM_HPP
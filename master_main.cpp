@@ -18,11 +18,30 @@ void print_usage() {
     std::cout << "  --file-port PORT     Port for file transfer (default: 5560)" << std::endl;
     std::cout << "  --command-port PORT  Port for command messages (default: 5561)" << std::endl;
     std::cout << "  --sync-port PORT     Port for synchronization (default: 5562)" << std::endl;
+    std::cout << "  --credit-port PORT   Port for file-transfer credits (default: 5563)" << std::endl;
+    std::cout << "  --live-stream        Receive the slave's merged data during acquisition" << std::endl;
+    std::cout << "  --live-port PORT     Port for the live stream (default: 5564)" << std::endl;
     std::cout << "  --output-dir DIR     Directory for output files (default: ./outputs)" << std::endl;
     std::cout << "  --duration SECONDS   Acquisition duration in seconds (default: 0.6)" << std::endl;
     std::cout << "  --channels LIST      Comma-separated list of channels (default: 1,2,3,4)" << std::endl;
+    std::cout << "  --files N            Record N contiguous files of --duration seconds each, without pausing" << std::endl;
+    std::cout << "  --file-duration SECONDS  Start a new output file every SECONDS of acquisition" << std::endl;
+    std::cout << "  --file-size MB       Start a new output file when the current one reaches MB megabytes" << std::endl;
     std::cout << "  --verbose            Enable verbose output" << std::endl;
     std::cout << "  --text-output        Generate human-readable text output files" << std::endl;
+    std::cout << "  --copy-ingest        Copy received timestamp messages instead of keeping them zero-copy" << std::endl;
+    std::cout << "  --coincidence-window PS  Count channel-pair coincidences within +/-PS while merging" << std::endl;
+    std::cout << "  --stats-interval S   Seconds between stream metrics reports (default: 1, 0: off)" << std::endl;
+    std::cout << "  --memory-budget MB   RAM per channel for buffered timestamps before spilling to disk (default: no limit)" << std::endl;
+    std::cout << "  --process-memory-budget MB  RAM for buffered timestamps of all channels (default: no limit)" << std::endl;
+    std::cout << "  --spill-dir DIR      Directory for spill files (default: system temporary directory)" << std::endl;
+    std::cout << "  --receiver-cpus LIST CPUs for the channel receivers, one per channel in turn (e.g. 2-5, node:1)" << std::endl;
+    std::cout << "  --merger-cpus LIST   CPUs for the merger thread" << std::endl;
+    std::cout << "  --io-cpus LIST       CPUs for the ZeroMQ I/O thread of the DLT streams" << std::endl;
+    std::cout << "  --rt-priority N      Run those threads with SCHED_FIFO priority N (1-99)" << std::endl;
+    std::cout << "  --no-xcorr           Synchronize on start times only (skip the cross-correlation offset estimate)" << std::endl;
+    std::cout << "  --xcorr-max-offset PS  Largest clock offset searched by the cross-correlation (default: unrestricted)" << std::endl;
+    std::cout << "  --xcorr-bin PS       Fine histogram bin of the cross-correlation (default: 50)" << std::endl;
     std::cout << "  --help               Display this help message" << std::endl;
 }
 
@@ -63,6 +82,8 @@ int main(int argc, char* argv[]) {
     config.file_port = 5560;         // Default file port
     config.command_port = 5561;      // Default command port
     config.sync_port = 5562;         // Default sync port - FIXED VALUE
+    config.streaming_mode = false;   // Single acquisition unless --files is given
+    config.max_files = 1;
     double duration = 0.6;
     std::string channels_str = "1,2,3,4";
     
@@ -96,6 +117,15 @@ int main(int argc, char* argv[]) {
         else if (arg == "--sync-port" && i + 1 < argc) {
             config.sync_port = std::stoi(argv[++i]);
         }
+        else if (arg == "--credit-port" && i + 1 < argc) {
+            config.credit_port = std::stoi(argv[++i]);
+        }
+        else if (arg == "--live-stream") {
+            config.live_stream = true;
+        }
+        else if (arg == "--live-port" && i + 1 < argc) {
+            config.live_port = std::stoi(argv[++i]);
+        }
         else if (arg == "--output-dir" && i + 1 < argc) {
             config.output_dir = argv[++i];
         }
@@ -105,12 +135,61 @@ int main(int argc, char* argv[]) {
         else if (arg == "--channels" && i + 1 < argc) {
             channels_str = argv[++i];
         }
+        else if (arg == "--files" && i + 1 < argc) {
+            config.streaming_mode = true;
+            config.max_files = std::stoi(argv[++i]);
+        }
+        else if (arg == "--file-duration" && i + 1 < argc) {
+            config.file_duration = std::stod(argv[++i]);
+        }
+        else if (arg == "--file-size" && i + 1 < argc) {
+            config.file_size_bytes = static_cast<uint64_t>(std::stod(argv[++i]) * 1e6);
+        }
         else if (arg == "--verbose") {
             config.verbose_output = true;
         }
         else if (arg == "--text-output") {
             config.text_output = true;
         }
+        else if (arg == "--copy-ingest") {
+            config.zero_copy_ingest = false;
+        }
+        else if (arg == "--coincidence-window" && i + 1 < argc) {
+            config.coincidence_window_ps = std::stoll(argv[++i]);
+        }
+        else if (arg == "--stats-interval" && i + 1 < argc) {
+            config.stats_interval = std::stod(argv[++i]);
+        }
+        else if (arg == "--memory-budget" && i + 1 < argc) {
+            config.memory_budget_bytes = static_cast<uint64_t>(std::stod(argv[++i]) * 1e6);
+        }
+        else if (arg == "--process-memory-budget" && i + 1 < argc) {
+            config.process_memory_budget_bytes = static_cast<uint64_t>(std::stod(argv[++i]) * 1e6);
+        }
+        else if (arg == "--spill-dir" && i + 1 < argc) {
+            config.spill_dir = argv[++i];
+        }
+        else if (arg == "--receiver-cpus" && i + 1 < argc) {
+            config.receiver_cpus = parse_cpu_list(argv[++i]);
+        }
+        else if (arg == "--merger-cpus" && i + 1 < argc) {
+            config.merger_cpus = parse_cpu_list(argv[++i]);
+        }
+        else if (arg == "--io-cpus" && i + 1 < argc) {
+            config.io_cpus = parse_cpu_list(argv[++i]);
+        }
+        else if (arg == "--rt-priority" && i + 1 < argc) {
+            config.rt_priority = std::stoi(argv[++i]);
+        }
+        else if (arg == "--no-xcorr") {
+            config.xcorr_sync = false;
+        }
+        else if (arg == "--xcorr-max-offset" && i + 1 < argc) {
+            config.xcorr_max_offset_ps = std::stoll(argv[++i]);
+        }
+        else if (arg == "--xcorr-bin" && i + 1 < argc) {
+            config.xcorr_bin_ps = std::stoll(argv[++i]);
+        }
         else {
             std::cerr << "Unknown option: " << arg << std::endl;
             print_usage();
@@ -148,10 +227,18 @@ int main(int argc, char* argv[]) {
     }
     
     // Trigger acquisition
-    std::cout << "Triggering synchronized acquisition for " << duration << " seconds..." << std::endl;
-    if (!controller.start_acquisition(duration, channels)) {
-        std::cerr << "Failed to trigger acquisition" << std::endl;
-        return 1;
+    if (config.streaming_mode) {
+        std::cout << "Triggering continuous acquisition of " << config.max_files << " files of " << duration << " seconds..." << std::endl;
+        if (!controller.run_streaming_mode(duration, channels, config.max_files)) {
+            std::cerr << "Failed to run continuous acquisition" << std::endl;
+            return 1;
+        }
+    } else {
+        std::cout << "Triggering synchronized acquisition for " << duration << " seconds..." << std::endl;
+        if (!controller.start_acquisition(duration, channels)) {
+            std::cerr << "Failed to trigger acquisition" << std::endl;
+            return 1;
+        }
     }
     
     // Wait for file transfer to complete - extended time for trigger sync + partial data
@@ -0,0 +1,127 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <algorithm>
+#include "timestamp_merge.hpp"
+
+// Benchmark of the per-batch merge done by TimestampsMergerThread: the previous
+// concatenate-and-std::sort path against the k-way merge of per-channel sorted runs.
+// Usage: merge_benchmark [--channels N] [--events N] [--batches N]
+//   --events is the number of timestamps per channel per batch (one DLT message).
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Generate one time-ordered run per channel with exponential inter-arrival gaps (Poisson process)
+std::vector<std::vector<uint64_t>> generate_batch(int channels, size_t events, std::mt19937_64& rng) {
+    std::vector<std::vector<uint64_t>> batch(channels);
+    std::exponential_distribution<double> gap(1.0 / 10000.0);  // mean 10 ns between events, in ps
+    for (auto& run : batch) {
+        run.resize(events);
+        double t = 0.0;
+        for (uint64_t& ts : run) {
+            t += gap(rng);
+            ts = static_cast<uint64_t>(t);
+        }
+    }
+    return batch;
+}
+
+// Previous implementation: materialize (channel, timestamp) pairs and sort the whole batch
+uint64_t merge_by_sort(const std::vector<std::vector<uint64_t>>& batch, uint64_t offset,
+                       std::vector<std::pair<int, uint64_t>>& merged) {
+    merged.clear();
+    for (size_t ch = 0; ch < batch.size(); ++ch) {
+        for (uint64_t ts : batch[ch]) {
+            merged.emplace_back(static_cast<int>(ch), ts + offset);
+        }
+    }
+    std::sort(merged.begin(), merged.end(), [](const auto& a, const auto& b) {
+        return a.second < b.second;
+    });
+    uint64_t checksum = 0;
+    for (auto& [ch, ts] : merged) {
+        checksum = checksum * 31 + ts;
+    }
+    return checksum;
+}
+
+// Current implementation: stream the k-way merge straight to the consumer
+uint64_t merge_by_kway(const std::vector<std::vector<uint64_t>>& batch, uint64_t offset,
+                       std::vector<TimestampRun>& runs) {
+    runs.clear();
+    for (size_t ch = 0; ch < batch.size(); ++ch) {
+        runs.push_back(TimestampRun{static_cast<int>(ch), TimestampSpan{batch[ch].data(), batch[ch].size()}, offset});
+    }
+    uint64_t checksum = 0;
+    kway_merge(runs, [&checksum](int, uint64_t ts) {
+        checksum = checksum * 31 + ts;
+    });
+    return checksum;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    int channels = 4;
+    size_t events = 250000;
+    int batches = 20;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--channels" && i + 1 < argc) {
+            channels = std::stoi(argv[++i]);
+        } else if (arg == "--events" && i + 1 < argc) {
+            events = std::stoull(argv[++i]);
+        } else if (arg == "--batches" && i + 1 < argc) {
+            batches = std::stoi(argv[++i]);
+        } else {
+            std::cerr << "Usage: merge_benchmark [--channels N] [--events N] [--batches N]" << std::endl;
+            return 1;
+        }
+    }
+
+    std::mt19937_64 rng(42);
+    std::vector<std::vector<std::vector<uint64_t>>> data;
+    for (int b = 0; b < batches; ++b) {
+        data.push_back(generate_batch(channels, events, rng));
+    }
+    const uint64_t pper = 200000000040ULL;  // 0.2 s + 40 ns, as configured by the controllers
+    const double total_events = static_cast<double>(channels) * events * batches;
+
+    std::vector<std::pair<int, uint64_t>> merged;
+    merged.reserve(channels * events);
+    std::vector<TimestampRun> runs;
+
+    uint64_t sort_checksum = 0;
+    auto start = Clock::now();
+    for (int b = 0; b < batches; ++b) {
+        sort_checksum ^= merge_by_sort(data[b], pper * b, merged);
+    }
+    double sort_seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    uint64_t kway_checksum = 0;
+    start = Clock::now();
+    for (int b = 0; b < batches; ++b) {
+        kway_checksum ^= merge_by_kway(data[b], pper * b, runs);
+    }
+    double kway_seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+    std::cout << "Channels: " << channels << ", events/channel/batch: " << events
+              << ", batches: " << batches << std::endl;
+    std::cout << "concat + std::sort: " << sort_seconds << " s ("
+              << total_events / sort_seconds / 1e6 << " Mevents/s)" << std::endl;
+    std::cout << "k-way heap merge:   " << kway_seconds << " s ("
+              << total_events / kway_seconds / 1e6 << " Mevents/s)" << std::endl;
+    std::cout << "Speedup: " << sort_seconds / kway_seconds << "x" << std::endl;
+
+    if (sort_checksum != kway_checksum) {
+        std::cerr << "ERROR: merge outputs differ" << std::endl;
+        return 1;
+    }
+    std::cout << "Outputs match" << std::endl;
+    return 0;
+}
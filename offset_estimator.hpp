@@ -0,0 +1,121 @@
+#ifndef OFFSET_ESTIMATOR_HPP
+#define OFFSET_ESTIMATOR_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+#include "timestamp_file_view.hpp"
+
+// Running statistics of clock offsets (slave - master, in the timestamps' unit) computed with
+// Welford's online algorithm: constant memory and numerically stable for billions of samples,
+// so offsets can be accumulated chunk by chunk while streaming through a capture.
+class OffsetEstimator {
+public:
+    void add(double offset) {
+        ++n;
+        double delta = offset - running_mean;
+        running_mean += delta / static_cast<double>(n);
+        m2 += delta * (offset - running_mean);
+        min_value = std::min(min_value, offset);
+        max_value = std::max(max_value, offset);
+    }
+
+    // Add the pairwise offsets slave[i] - master[i] of two equally long chunks
+    void add_pairs(const uint64_t* master, const uint64_t* slave, size_t count) {
+        for (size_t i = 0; i < count; ++i) {
+            add(static_cast<double>(static_cast<int64_t>(slave[i] - master[i])));
+        }
+    }
+
+    // Add the offsets of the events two sorted streams have in common once the slave is shifted by
+    // `offset` (e.g. the cross-correlation estimate): each slave timestamp is paired with the
+    // nearest unpaired master timestamp whose offset lies within `tolerance` of `offset`
+    void add_matched(const std::vector<uint64_t>& master, const std::vector<uint64_t>& slave,
+                     double offset, double tolerance) {
+        size_t first = 0;
+        for (uint64_t slave_time : slave) {
+            // Master events more than `tolerance` before the shifted slave event can match no later one
+            while (first < master.size() &&
+                   static_cast<double>(static_cast<int64_t>(slave_time - master[first])) - offset > tolerance) {
+                ++first;
+            }
+            size_t best = master.size();
+            double best_residual = tolerance;
+            for (size_t i = first; i < master.size(); ++i) {
+                double residual = static_cast<double>(static_cast<int64_t>(slave_time - master[i])) - offset;
+                if (residual < -tolerance) {
+                    break;
+                }
+                if (std::abs(residual) <= best_residual) {
+                    best = i;
+                    best_residual = std::abs(residual);
+                }
+            }
+            if (best < master.size()) {
+                add(static_cast<double>(static_cast<int64_t>(slave_time - master[best])));
+                first = best + 1;
+            }
+        }
+    }
+
+    // Combine with statistics accumulated separately (e.g. by another thread)
+    void merge(const OffsetEstimator& other) {
+        if (other.n == 0) {
+            return;
+        }
+        if (n == 0) {
+            *this = other;
+            return;
+        }
+        uint64_t total = n + other.n;
+        double delta = other.running_mean - running_mean;
+        running_mean += delta * static_cast<double>(other.n) / static_cast<double>(total);
+        m2 += other.m2 + delta * delta * static_cast<double>(n) * static_cast<double>(other.n) / static_cast<double>(total);
+        n = total;
+        min_value = std::min(min_value, other.min_value);
+        max_value = std::max(max_value, other.max_value);
+    }
+
+    uint64_t count() const { return n; }
+    double mean() const { return running_mean; }
+    double min() const { return n ? min_value : 0.0; }
+    double max() const { return n ? max_value : 0.0; }
+    // Population variance / standard deviation (matching the previous two-pass computation)
+    double variance() const { return n ? m2 / static_cast<double>(n) : 0.0; }
+    double std_dev() const { return std::sqrt(variance()); }
+
+private:
+    uint64_t n = 0;
+    double running_mean = 0.0;
+    double m2 = 0.0;
+    double min_value = std::numeric_limits<double>::infinity();
+    double max_value = -std::numeric_limits<double>::infinity();
+};
+
+// Stream the first `limit` records of two mapped files through an estimator, pairing the i-th
+// master timestamp with the i-th slave timestamp. Records are decoded a chunk at a time and the
+// pages already consumed are released, so resident memory stays bounded by the chunk size.
+inline OffsetEstimator estimate_offsets(const TimestampFileView& master, const TimestampFileView& slave,
+                                        size_t limit = std::numeric_limits<size_t>::max(),
+                                        size_t chunk_records = 1 << 16) {
+    OffsetEstimator estimator;
+    const size_t total = std::min({master.size(), slave.size(), limit});
+    std::vector<uint64_t> master_chunk(std::min(total, chunk_records));
+    std::vector<uint64_t> slave_chunk(master_chunk.size());
+    for (size_t start = 0; start < total; start += chunk_records) {
+        size_t count = std::min(chunk_records, total - start);
+        for (size_t i = 0; i < count; ++i) {
+            master_chunk[i] = master.timestamp(start + i);
+            slave_chunk[i] = slave.timestamp(start + i);
+        }
+        estimator.add_pairs(master_chunk.data(), slave_chunk.data(), count);
+        master.release_range(start, start + count);
+        slave.release_range(start, start + count);
+    }
+    return estimator;
+}
+
+#endif // OFFSET_ESTIMATOR_HPP
@@ -0,0 +1,152 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include "offset_estimator.hpp"
+
+// Checks OffsetEstimator's streaming statistics (add, merge) against a two-pass reference, and the
+// matched pairs it collects from two event streams shifted by a known offset.
+
+namespace {
+
+int failures = 0;
+
+void check(bool condition, const std::string& what) {
+    if (!condition) {
+        std::cerr << "FAIL: " << what << std::endl;
+        ++failures;
+    }
+}
+
+bool close(double value, double expected, double relative) {
+    return std::abs(value - expected) <= relative * std::max(1.0, std::abs(expected));
+}
+
+struct Reference {
+    double mean = 0.0;
+    double min = 0.0;
+    double max = 0.0;
+    double std_dev = 0.0;
+};
+
+Reference two_pass(const std::vector<double>& values) {
+    Reference ref;
+    ref.min = values.front();
+    ref.max = values.front();
+    double sum = 0.0;
+    for (double v : values) {
+        sum += v;
+        ref.min = std::min(ref.min, v);
+        ref.max = std::max(ref.max, v);
+    }
+    ref.mean = sum / values.size();
+    double squares = 0.0;
+    for (double v : values) {
+        squares += (v - ref.mean) * (v - ref.mean);
+    }
+    ref.std_dev = std::sqrt(squares / values.size());
+    return ref;
+}
+
+void check_against(const OffsetEstimator& estimator, const std::vector<double>& values, const std::string& what) {
+    Reference ref = two_pass(values);
+    check(estimator.count() == values.size(), what + ": count");
+    check(close(estimator.mean(), ref.mean, 1e-12), what + ": mean");
+    check(estimator.min() == ref.min, what + ": min");
+    check(estimator.max() == ref.max, what + ": max");
+    check(close(estimator.std_dev(), ref.std_dev, 1e-6), what + ": std dev");
+}
+
+void test_add_and_merge() {
+    // Large common offset with small spread: the case where a naive sum of squares loses precision
+    std::mt19937_64 rng(7);
+    std::normal_distribution<double> offset(-3.5e12, 250.0);
+    std::vector<double> values(100000);
+    for (double& v : values) {
+        v = std::round(offset(rng));
+    }
+
+    OffsetEstimator all;
+    for (double v : values) {
+        all.add(v);
+    }
+    check_against(all, values, "add");
+
+    // Uneven parts merged in a different order, including an empty one
+    const size_t cuts[] = {0, 1, 777, 50000, values.size()};
+    std::vector<OffsetEstimator> parts(4);
+    for (size_t p = 0; p < parts.size(); ++p) {
+        for (size_t i = cuts[p]; i < cuts[p + 1]; ++i) {
+            parts[p].add(values[i]);
+        }
+    }
+    OffsetEstimator merged;
+    merged.merge(OffsetEstimator());
+    merged.merge(parts[2]);
+    merged.merge(parts[0]);
+    merged.merge(parts[3]);
+    merged.merge(parts[1]);
+    check_against(merged, values, "merge");
+
+    OffsetEstimator empty;
+    check(empty.count() == 0 && empty.mean() == 0.0 && empty.min() == 0.0 && empty.std_dev() == 0.0,
+          "empty estimator reports zeros");
+}
+
+void test_matched_pairs() {
+    // Correlated events seen by both sides (slave = master + offset + jitter), plus uncorrelated
+    // events on each side at a lower rate
+    const double offset = 1234567.0;
+    const double tolerance = 350.0;
+    std::mt19937_64 rng(11);
+    std::uniform_int_distribution<uint64_t> gap(50000, 150000);
+    std::normal_distribution<double> jitter(0.0, 40.0);
+    std::uniform_int_distribution<uint64_t> anywhere(0, 2000000000ULL);
+
+    std::vector<uint64_t> master;
+    std::vector<uint64_t> slave;
+    std::vector<double> expected;
+    uint64_t t = 10000000;
+    for (int i = 0; i < 20000; ++i) {
+        t += gap(rng);
+        int64_t shift = static_cast<int64_t>(std::llround(offset + jitter(rng)));
+        master.push_back(t);
+        slave.push_back(t + shift);
+        expected.push_back(static_cast<double>(shift));
+    }
+    for (int i = 0; i < 200; ++i) {
+        master.push_back(anywhere(rng));
+        slave.push_back(anywhere(rng));
+    }
+    std::sort(master.begin(), master.end());
+    std::sort(slave.begin(), slave.end());
+
+    OffsetEstimator matched;
+    matched.add_matched(master, slave, offset, tolerance);
+    Reference ref = two_pass(expected);
+    // A few background events may coincide by chance; they barely move the statistics
+    check(matched.count() >= expected.size() && matched.count() <= expected.size() + 10, "matched: every correlated pair is found");
+    check(std::abs(matched.mean() - ref.mean) < 1.0, "matched: mean offset");
+    check(std::abs(matched.std_dev() - ref.std_dev) < 2.0, "matched: std dev");
+    check(matched.min() >= offset - tolerance && matched.max() <= offset + tolerance, "matched: pairs within tolerance");
+
+    OffsetEstimator none;
+    none.add_matched(master, slave, offset + 40000.0, tolerance);
+    check(none.count() < 10, "matched: a wrong offset pairs only chance coincidences");
+}
+
+} // namespace
+
+int main() {
+    test_add_and_merge();
+    test_matched_pairs();
+    if (failures > 0) {
+        std::cerr << failures << " check(s) failed" << std::endl;
+        return 1;
+    }
+    std::cout << "offset_estimator_test: all checks passed" << std::endl;
+    return 0;
+}
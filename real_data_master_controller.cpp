@@ -16,39 +16,54 @@
 #include "json.hpp"
 #include "streams.hpp" // Include streams header for BufferStreamClient and TimestampsMergerThread
 #include "common.hpp"  // Include common header for ZMQ helpers
+#include "timestamp_file_view.hpp"
+#include "offset_estimator.hpp"
+#include "async_file_writer.hpp"
 
 using json = nlohmann::json;
 namespace fs = std::filesystem;
 
+// --- Helper function to write the "#" header of the text exports (see write_timestamps_to_txt()) ---
+void write_txt_header(std::ostream& file, const std::vector<int>& channels, size_t count) {
+    auto now = std::chrono::system_clock::now();
+    std::time_t now_time_t = std::chrono::system_clock::to_time_t(now);
+    std::tm* now_tm = std::localtime(&now_time_t);
+    file << "# Distributed Timestamp System - Master Controller Data" << std::endl;
+    file << "# Generated: " << std::put_time(now_tm, "%Y-%m-%d %H:%M:%S") << std::endl;
+    file << "# Channels: ";
+    for (size_t i = 0; i < channels.size(); ++i) {
+        file << channels[i];
+        if (i < channels.size() - 1) file << ", ";
+    }
+    file << std::endl;
+    file << "# Total timestamps: " << count << std::endl;
+    file << "# Format: index, timestamp_ns, channel" << std::endl;
+    file << "#----------------------------------------" << std::endl;
+}
+
 // --- Helper function to read timestamps from binary file (moved here for clarity) ---
 std::vector<uint64_t> read_timestamps_from_bin_internal(const std::string& filename, double percentage = 1.0) {
     std::vector<uint64_t> timestamps;
-    std::ifstream file(filename, std::ios::binary);
-    
-    if (!file.is_open()) {
-        std::cerr << "Failed to open file for reading: " << filename << std::endl;
-        return timestamps;
-    }
-    
-    // Read number of timestamps
-    uint64_t count;
-    file.read(reinterpret_cast<char*>(&count), sizeof(count));
-    
-    // Calculate how many timestamps to read based on percentage
-    uint64_t read_count = static_cast<uint64_t>(count * percentage);
-    if (read_count < 1 && count > 0) read_count = 1; // Read at least one if available
-    if (read_count > count) read_count = count;
-    
-    // Read timestamps
-    if (read_count > 0) {
-        timestamps.resize(read_count);
-        file.read(reinterpret_cast<char*>(timestamps.data()), read_count * sizeof(uint64_t));
+    try {
+        // Count-prefixed layout: uint64 count followed by the timestamps
+        TimestampFileView view(filename, TimestampFileView::Layout::CountPrefixed);
+        
+        // Calculate how many timestamps to read based on percentage
+        uint64_t count = view.size();
+        uint64_t read_count = static_cast<uint64_t>(count * percentage);
+        if (read_count < 1 && count > 0) read_count = 1; // Read at least one if available
+        if (read_count > count) read_count = count;
+        
+        timestamps.reserve(read_count);
+        for (size_t i = 0; i < read_count; ++i) {
+            timestamps.push_back(view.timestamp(i));
+        }
+        
+        std::cout << "Read " << read_count << " of " << count << " timestamps from " << filename << std::endl;
+    } catch (const std::exception& e) {
+        std::cerr << "Failed to open file for reading: " << filename << " (" << e.what() << ")" << std::endl;
     }
     
-    file.close();
-    
-    std::cout << "Read " << read_count << " of " << count << " timestamps from " << filename << std::endl;
-    
     return timestamps;
 }
 // --- End Helper function ---
@@ -588,40 +603,24 @@ void MasterController::calculate_sync(const std::string& master_bin_file, const
     try {
         log_message("Calculating synchronization between " + master_bin_file + " and " + slave_bin_file, true);
         
-        // Read timestamps from binary files (only first 10% for sync calculation)
-        std::vector<uint64_t> master_timestamps = read_timestamps_from_bin_internal(master_bin_file, config_.sync_percentage);
-        std::vector<uint64_t> slave_timestamps = read_timestamps_from_bin_internal(slave_bin_file, config_.sync_percentage);
+        // Map both files; only the first sync_percentage of the records is used for the offset
+        TimestampFileView master_view(master_bin_file, TimestampFileView::Layout::CountPrefixed);
+        TimestampFileView slave_view(slave_bin_file, TimestampFileView::Layout::CountPrefixed);
         
-        if (master_timestamps.empty() || slave_timestamps.empty()) {
+        if (master_view.empty() || slave_view.empty()) {
             std::cerr << "Error: Empty timestamp data for sync calculation" << std::endl;
             return;
         }
         
-        // Calculate offset statistics
-        double min_offset = 1e18;
-        double max_offset = -1e18;
-        double sum_offset = 0.0;
-        int count = 0;
-        size_t compare_size = std::min(master_timestamps.size(), slave_timestamps.size());
-        
-        for (size_t i = 0; i < compare_size; i++) {
-            double offset = static_cast<double>(slave_timestamps[i]) - static_cast<double>(master_timestamps[i]);
-            min_offset = std::min(min_offset, offset);
-            max_offset = std::max(max_offset, offset);
-            sum_offset += offset;
-            count++;
-        }
-        
-        double avg_offset = (count > 0) ? (sum_offset / count) : 0.0;
+        size_t sync_count = static_cast<size_t>(std::min(master_view.size(), slave_view.size()) * config_.sync_percentage);
+        if (sync_count < 1) sync_count = 1;
         
-        // Calculate standard deviation
-        double sum_squared_diff = 0.0;
-        for (size_t i = 0; i < compare_size; i++) {
-            double offset = static_cast<double>(slave_timestamps[i]) - static_cast<double>(master_timestamps[i]);
-            double diff = offset - avg_offset;
-            sum_squared_diff += diff * diff;
-        }
-        double std_dev = (count > 0) ? std::sqrt(sum_squared_diff / count) : 0.0;
+        // Calculate offset statistics in a single streaming pass (bounded memory)
+        OffsetEstimator offsets = estimate_offsets(master_view, slave_view, sync_count);
+        double min_offset = offsets.min();
+        double max_offset = offsets.max();
+        double avg_offset = offsets.mean();
+        double std_dev = offsets.std_dev();
         
         // Write offset report file
         fs::path offset_path = fs::path(config_.output_dir) / ("offset_report_" + get_current_timestamp_str() + ".txt");
@@ -635,32 +634,44 @@ void MasterController::calculate_sync(const std::string& master_bin_file, const
 
         // --- Create Corrected Master File --- 
         log_message("Creating corrected master timestamp file...", true);
-        // Read the *full* original master binary file
-        std::vector<uint64_t> full_master_timestamps = read_timestamps_from_bin_internal(master_bin_file, 1.0); 
-        if (!full_master_timestamps.empty()) {
-            // Apply the average offset
-            for (uint64_t& ts : full_master_timestamps) {
-                ts += static_cast<int64_t>(avg_offset); // Apply average offset
-            }
-            
+        // Stream the *full* original master file through the correction
+        {
             // Generate corrected filename
             fs::path original_path(master_bin_file);
             std::string corrected_filename = original_path.stem().string() + "_corrected" + original_path.extension().string();
             fs::path corrected_path = original_path.parent_path() / corrected_filename;
             
-            // Write corrected timestamps to new binary file
-            write_timestamps_to_bin(full_master_timestamps, corrected_path.string());
-            log_message("Corrected master file written to: " + corrected_path.string(), true);
-
-            // Optionally write corrected text file if text output is enabled
+            // Same count-prefixed layout as write_timestamps_to_bin()
+            AsyncFileWriter corrected_file(corrected_path.string());
+            uint64_t count = master_view.size();
+            corrected_file.write(&count, sizeof(count));
+            
+            std::ofstream corrected_text;
             if (config_.text_output) {
                  fs::path corrected_text_path = corrected_path;
                  corrected_text_path.replace_extension(".txt");
-                 write_timestamps_to_txt(full_master_timestamps, active_channels_, corrected_text_path.string());
-                 log_message("Corrected master text file written to: " + corrected_text_path.string(), true);
+                 corrected_text.open(corrected_text_path);
+                 if (corrected_text.is_open()) {
+                     write_txt_header(corrected_text, active_channels_, count);
+                 }
+            }
+            
+            const int64_t correction = static_cast<int64_t>(avg_offset); // Apply average offset
+            for (size_t i = 0; i < master_view.size(); ++i) {
+                uint64_t ts = master_view.timestamp(i) + correction;
+                corrected_file.write(&ts, sizeof(ts));
+                if (corrected_text.is_open()) {
+                    // Same header and line format as write_timestamps_to_txt()
+                    int channel = active_channels_.empty() ? 0 : active_channels_[i % active_channels_.size()];
+                    corrected_text << i << ", " << ts << ", " << channel << "\n";
+                }
+            }
+            corrected_file.close();
+            log_message("Corrected master file written to: " + corrected_path.string(), true);
+            if (corrected_text.is_open()) {
+                 corrected_text.close();
+                 log_message("Corrected master text file written to: " + fs::path(corrected_path).replace_extension(".txt").string(), true);
             }
-        } else {
-            log_message("Could not read full master file for correction.", true);
         }
         // --- End Corrected Master File --- 
         
@@ -733,20 +744,7 @@ void MasterController::write_timestamps_to_txt(const std::vector<uint64_t>& time
         std::cerr << "Failed to open text file for writing: " << filename << std::endl;
         return;
     }
-    auto now = std::chrono::system_clock::now();
-    std::time_t now_time_t = std::chrono::system_clock::to_time_t(now);
-    std::tm* now_tm = std::localtime(&now_time_t);
-    file << "# Distributed Timestamp System - Master Controller Data" << std::endl;
-    file << "# Generated: " << std::put_time(now_tm, "%Y-%m-%d %H:%M:%S") << std::endl;
-    file << "# Channels: ";
-    for (size_t i = 0; i < channels.size(); ++i) {
-        file << channels[i];
-        if (i < channels.size() - 1) file << ", ";
-    }
-    file << std::endl;
-    file << "# Total timestamps: " << timestamps.size() << std::endl;
-    file << "# Format: index, timestamp_ns, channel" << std::endl;
-    file << "#----------------------------------------" << std::endl;
+    write_txt_header(file, channels, timestamps.size());
     for (size_t i = 0; i < timestamps.size(); ++i) {
         int channel = (channels.empty()) ? 0 : channels[i % channels.size()]; // Handle empty channels case
         file << i << ", " << timestamps[i] << ", " << channel << std::endl;
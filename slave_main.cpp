@@ -17,9 +17,25 @@ void print_usage() {
     std::cout << "  --file-port PORT     Port for file transfer (default: 5560)" << std::endl;
     std::cout << "  --command-port PORT  Port for command messages (default: 5561)" << std::endl;
     std::cout << "  --sync-port PORT     Port for synchronization (default: 5562)" << std::endl;
+    std::cout << "  --credit-port PORT   Port for file-transfer credits (default: 5563)" << std::endl;
+    std::cout << "  --live-stream        Forward merged data to the master during acquisition" << std::endl;
+    std::cout << "  --live-port PORT     Port for the live stream (default: 5564)" << std::endl;
+    std::cout << "  --transfer-chunk-size BYTES  Payload size of file-transfer chunks (default: 1048576)" << std::endl;
+    std::cout << "  --transfer-window N  File-transfer chunks in flight before waiting for the master (default: 8)" << std::endl;
+    std::cout << "  --compress-transfers Compress timestamp files sent to the master" << std::endl;
     std::cout << "  --output-dir DIR     Directory for output files (default: ./outputs)" << std::endl;
     std::cout << "  --verbose            Enable verbose output" << std::endl;
     std::cout << "  --text-output        Generate human-readable text output files" << std::endl;
+    std::cout << "  --copy-ingest        Copy received timestamp messages instead of keeping them zero-copy" << std::endl;
+    std::cout << "  --coincidence-window PS  Count channel-pair coincidences within +/-PS while merging" << std::endl;
+    std::cout << "  --stats-interval S   Seconds between stream metrics reports (default: 1, 0: off)" << std::endl;
+    std::cout << "  --memory-budget MB   RAM per channel for buffered timestamps before spilling to disk (default: no limit)" << std::endl;
+    std::cout << "  --process-memory-budget MB  RAM for buffered timestamps of all channels (default: no limit)" << std::endl;
+    std::cout << "  --spill-dir DIR      Directory for spill files (default: system temporary directory)" << std::endl;
+    std::cout << "  --receiver-cpus LIST CPUs for the channel receivers, one per channel in turn (e.g. 2-5, node:1)" << std::endl;
+    std::cout << "  --merger-cpus LIST   CPUs for the merger thread" << std::endl;
+    std::cout << "  --io-cpus LIST       CPUs for the ZeroMQ I/O thread of the DLT streams" << std::endl;
+    std::cout << "  --rt-priority N      Run those threads with SCHED_FIFO priority N (1-99)" << std::endl;
     std::cout << "  --help               Display this help message" << std::endl;
 }
 
@@ -72,6 +88,24 @@ int main(int argc, char* argv[]) {
         else if (arg == "--sync-port" && i + 1 < argc) {
             config.sync_port = std::stoi(argv[++i]);
         }
+        else if (arg == "--credit-port" && i + 1 < argc) {
+            config.credit_port = std::stoi(argv[++i]);
+        }
+        else if (arg == "--live-stream") {
+            config.live_stream = true;
+        }
+        else if (arg == "--live-port" && i + 1 < argc) {
+            config.live_port = std::stoi(argv[++i]);
+        }
+        else if (arg == "--transfer-chunk-size" && i + 1 < argc) {
+            config.transfer_chunk_size = std::stoull(argv[++i]);
+        }
+        else if (arg == "--transfer-window" && i + 1 < argc) {
+            config.transfer_window = static_cast<unsigned>(std::stoul(argv[++i]));
+        }
+        else if (arg == "--compress-transfers") {
+            config.compress_transfers = true;
+        }
         else if (arg == "--output-dir" && i + 1 < argc) {
             config.output_dir = argv[++i];
         }
@@ -81,6 +115,36 @@ int main(int argc, char* argv[]) {
         else if (arg == "--text-output") {
             config.text_output = true;
         }
+        else if (arg == "--copy-ingest") {
+            config.zero_copy_ingest = false;
+        }
+        else if (arg == "--coincidence-window" && i + 1 < argc) {
+            config.coincidence_window_ps = std::stoll(argv[++i]);
+        }
+        else if (arg == "--stats-interval" && i + 1 < argc) {
+            config.stats_interval = std::stod(argv[++i]);
+        }
+        else if (arg == "--memory-budget" && i + 1 < argc) {
+            config.memory_budget_bytes = static_cast<uint64_t>(std::stod(argv[++i]) * 1e6);
+        }
+        else if (arg == "--process-memory-budget" && i + 1 < argc) {
+            config.process_memory_budget_bytes = static_cast<uint64_t>(std::stod(argv[++i]) * 1e6);
+        }
+        else if (arg == "--spill-dir" && i + 1 < argc) {
+            config.spill_dir = argv[++i];
+        }
+        else if (arg == "--receiver-cpus" && i + 1 < argc) {
+            config.receiver_cpus = parse_cpu_list(argv[++i]);
+        }
+        else if (arg == "--merger-cpus" && i + 1 < argc) {
+            config.merger_cpus = parse_cpu_list(argv[++i]);
+        }
+        else if (arg == "--io-cpus" && i + 1 < argc) {
+            config.io_cpus = parse_cpu_list(argv[++i]);
+        }
+        else if (arg == "--rt-priority" && i + 1 < argc) {
+            config.rt_priority = std::stoi(argv[++i]);
+        }
         else {
             std::cerr << "Unknown option: " << arg << std::endl;
             print_usage();
@@ -0,0 +1,71 @@
+#include "spill_store.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+SpillSegment::SpillSegment(const std::string& directory, size_t capacity)
+    : fd(-1), base(nullptr), length(capacity), offset(0)
+{
+    std::string name = (std::filesystem::path(directory) / "tt_spill_XXXXXX").string();
+    std::vector<char> path(name.begin(), name.end());
+    path.push_back('\0');
+    fd = mkstemp(path.data());
+    if (fd < 0) {
+        throw std::runtime_error("Cannot create spill file in " + directory + ": " + std::strerror(errno));
+    }
+    // Only the descriptor is needed; the space is freed when it is closed
+    unlink(path.data());
+    if (ftruncate(fd, static_cast<off_t>(length)) != 0) {
+        int error = errno;
+        close(fd);
+        throw std::runtime_error(std::string("Cannot size spill file: ") + std::strerror(error));
+    }
+    void* mapping = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (mapping == MAP_FAILED) {
+        int error = errno;
+        close(fd);
+        throw std::runtime_error(std::string("Cannot map spill file: ") + std::strerror(error));
+    }
+    base = static_cast<char*>(mapping);
+}
+
+SpillSegment::~SpillSegment() {
+    munmap(base, length);
+    close(fd);
+}
+
+const void* SpillSegment::append(const void* data, size_t size) {
+    if (size > length - offset) {
+        return nullptr;
+    }
+    char* out = base + offset;
+    std::memcpy(out, data, size);
+    offset = std::min(length, offset + ((size + 7) & ~size_t(7)));
+    return out;
+}
+
+SpillStore::SpillStore(const std::string& directory, size_t segment_size_)
+    : dir(directory.empty() ? std::filesystem::temp_directory_path().string() : directory),
+      segment_size(segment_size_)
+{
+}
+
+SpillStore::Extent SpillStore::write(const void* data, size_t size) {
+    const void* stored = current ? current->append(data, size) : nullptr;
+    if (stored == nullptr) {
+        // Payloads larger than a segment get a segment of their own
+        current = std::make_shared<SpillSegment>(dir, std::max(segment_size, size));
+        stored = current->append(data, size);
+    }
+    Extent extent;
+    extent.segment = current;
+    extent.data = stored;
+    extent.size = size;
+    return extent;
+}
@@ -0,0 +1,69 @@
+#ifndef SPILL_STORE_HPP
+#define SPILL_STORE_HPP
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+// Disk-backed overflow for a channel's stream buffer.
+//
+// When a BufferStreamClient is over its memory budget, received payloads are copied into spill
+// segments instead of being kept in RAM: files of `segment_size` bytes mapped with mmap(MAP_SHARED),
+// unlinked as soon as they are created so nothing is left behind. The pages are file-backed, so the
+// kernel writes them out and reclaims them under memory pressure instead of the process running out
+// of memory; the merger reads the data back through the mapping like any other message.
+//
+// A segment stays mapped as long as a message refers to it and is released (space included) with
+// the last one.
+
+class SpillSegment {
+public:
+    // Create and map a segment of `capacity` bytes in `directory`; throws std::runtime_error
+    SpillSegment(const std::string& directory, size_t capacity);
+    ~SpillSegment();
+
+    SpillSegment(const SpillSegment&) = delete;
+    SpillSegment& operator=(const SpillSegment&) = delete;
+
+    // Copy `size` bytes to the end of the segment (8-byte aligned); returns where they were
+    // stored, or nullptr if they do not fit
+    const void* append(const void* data, size_t size);
+
+    size_t capacity() const { return length; }
+    size_t used() const { return offset; }
+
+private:
+    int fd;
+    char* base;
+    size_t length;
+    size_t offset;
+};
+
+// Chain of spill segments for one channel; used from the receiver thread only
+class SpillStore {
+public:
+    static constexpr size_t kDefaultSegmentSize = size_t(64) << 20;
+
+    // `directory` empty: the system temporary directory
+    explicit SpillStore(const std::string& directory, size_t segment_size = kDefaultSegmentSize);
+
+    // Where a spilled payload lives; `segment` keeps the mapping alive
+    struct Extent {
+        std::shared_ptr<SpillSegment> segment;
+        const void* data = nullptr;
+        size_t size = 0;
+    };
+
+    // Copy a payload to disk, starting a new segment when the current one is full.
+    // Throws std::runtime_error if no segment can be created.
+    Extent write(const void* data, size_t size);
+
+    const std::string& directory() const { return dir; }
+
+private:
+    std::string dir;
+    size_t segment_size;
+    std::shared_ptr<SpillSegment> current;
+};
+
+#endif // SPILL_STORE_HPP
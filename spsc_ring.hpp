@@ -0,0 +1,109 @@
+#ifndef SPSC_RING_HPP
+#define SPSC_RING_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+// Size of a cache line; producer and consumer state live on separate lines to avoid false sharing
+constexpr size_t CACHE_LINE_SIZE = 64;
+
+// Bounded single-producer/single-consumer ring of message slots.
+// Exactly one thread may call try_push() and exactly one other thread may call front()/pop().
+// No locks are taken; the producer publishes a slot with a release store of tail_, the consumer
+// frees it with a release store of head_.
+template <typename T>
+class SpscRing {
+public:
+    explicit SpscRing(size_t capacity)
+        : mask(round_up_pow2(capacity) - 1),
+          slots(new Slot[mask + 1])
+    {
+    }
+
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    // Producer: move `item` into the ring. Returns false (leaving `item` untouched) if the ring is full.
+    bool try_push(T& item) {
+        const size_t t = producer.tail.load(std::memory_order_relaxed);
+        if (t - producer.cached_head > mask) {
+            // Looks full from our cached view; refresh the consumer position once
+            producer.cached_head = consumer.head.load(std::memory_order_acquire);
+            if (t - producer.cached_head > mask) {
+                return false;
+            }
+        }
+        slots[t & mask].value = std::move(item);
+        producer.tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer: pointer to the oldest unconsumed item, or nullptr if the ring is empty
+    T* front() {
+        const size_t h = consumer.head.load(std::memory_order_relaxed);
+        if (h == consumer.cached_tail) {
+            consumer.cached_tail = producer.tail.load(std::memory_order_acquire);
+            if (h == consumer.cached_tail) {
+                return nullptr;
+            }
+        }
+        return &slots[h & mask].value;
+    }
+
+    // Consumer: pointer to the item queued after front()'s, or nullptr if fewer than two are queued
+    T* second() {
+        const size_t h = consumer.head.load(std::memory_order_relaxed);
+        if (consumer.cached_tail - h < 2) {
+            consumer.cached_tail = producer.tail.load(std::memory_order_acquire);
+            if (consumer.cached_tail - h < 2) {
+                return nullptr;
+            }
+        }
+        return &slots[(h + 1) & mask].value;
+    }
+
+    // Consumer: release the item returned by front() (its storage is freed before the slot is reused)
+    void pop() {
+        const size_t h = consumer.head.load(std::memory_order_relaxed);
+        slots[h & mask].value = T();
+        consumer.head.store(h + 1, std::memory_order_release);
+    }
+
+    // Approximate number of queued items (exact when called from either endpoint thread)
+    size_t size() const {
+        return producer.tail.load(std::memory_order_acquire) - consumer.head.load(std::memory_order_acquire);
+    }
+
+    size_t capacity() const { return mask + 1; }
+
+private:
+    static size_t round_up_pow2(size_t n) {
+        size_t p = 1;
+        while (p < n) p <<= 1;
+        return p;
+    }
+
+    struct alignas(CACHE_LINE_SIZE) Slot {
+        T value{};
+    };
+
+    struct alignas(CACHE_LINE_SIZE) ProducerState {
+        std::atomic<size_t> tail{0};
+        size_t cached_head = 0;           // producer's last seen consumer.head
+    };
+
+    struct alignas(CACHE_LINE_SIZE) ConsumerState {
+        std::atomic<size_t> head{0};
+        size_t cached_tail = 0;           // consumer's last seen producer.tail
+    };
+
+    const size_t mask;
+    std::unique_ptr<Slot[]> slots;
+    ProducerState producer;
+    ConsumerState consumer;
+};
+
+#endif // SPSC_RING_HPP
@@ -2,16 +2,80 @@
 #include <algorithm>
 #include <iostream>
 #include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+#include <sched.h>
 #include <zmq.h>  // for zmq_socket_monitor
 
 // Create a static ZMQ context for all stream sockets (separate from REQ context for safety)
 static zmq::context_t streamsContext(1);
 
-BufferStreamClient::BufferStreamClient(int channel)
-    : number(channel), port(4241 + channel),
+void configure_stream_io_threads(const ThreadPlacement& placement) {
+    if (placement.empty()) {
+        return;
+    }
+#if defined(ZMQ_THREAD_AFFINITY_CPU_ADD) && defined(ZMQ_THREAD_SCHED_POLICY) && defined(ZMQ_THREAD_PRIORITY)
+    bool ok = true;
+    for (int cpu : placement.cpus) {
+        ok = zmq_ctx_set(streamsContext.handle(), ZMQ_THREAD_AFFINITY_CPU_ADD, cpu) == 0 && ok;
+    }
+    if (placement.fifo_priority > 0) {
+        ok = zmq_ctx_set(streamsContext.handle(), ZMQ_THREAD_SCHED_POLICY, SCHED_FIFO) == 0 && ok;
+        ok = zmq_ctx_set(streamsContext.handle(), ZMQ_THREAD_PRIORITY, placement.fifo_priority) == 0 && ok;
+    }
+    if (!ok) {
+        std::cerr << "Cannot place the stream I/O thread on " << placement.describe() << ": " << zmq_strerror(zmq_errno()) << std::endl;
+    }
+#else
+    std::cerr << "This ZeroMQ version cannot place its I/O threads; ignoring " << placement.describe() << std::endl;
+#endif
+}
+
+// Buffered bytes held in RAM by all stream clients (checked against StreamOptions::process_memory_budget)
+static std::atomic<size_t> processMemoryBytes(0);
+
+StreamMessage::StreamMessage(zmq::message_t&& frame_, bool zero_copy, std::chrono::steady_clock::time_point arrival_)
+    : frame(std::move(frame_)), arrival(arrival_)
+{
+    // Timestamps are read in place only if the frame data is suitably aligned for uint64_t access
+    bool aligned = reinterpret_cast<uintptr_t>(frame.data()) % alignof(uint64_t) == 0;
+    if (!zero_copy || !aligned) {
+        owned_count = frame.size() / sizeof(uint64_t);
+        owned = BlockPool::shared().acquire(owned_count * sizeof(uint64_t));
+        memcpy(owned.data(), frame.data(), owned_count * sizeof(uint64_t));
+        frame = zmq::message_t();
+    }
+}
+
+void StreamMessage::spill(SpillStore& store) {
+    TimestampSpan span = timestamps();
+    SpillStore::Extent extent = store.write(span.ptr, span.size() * sizeof(uint64_t));
+    spill_segment = extent.segment;
+    spilled_span = TimestampSpan{static_cast<const uint64_t*>(extent.data), span.size()};
+    frame = zmq::message_t();
+    owned.reset();
+    owned_count = 0;
+}
+
+TimestampSpan StreamMessage::timestamps() const {
+    if (spill_segment) {
+        return spilled_span;
+    }
+    if (owned) {
+        return TimestampSpan{static_cast<const uint64_t*>(owned.data()), owned_count};
+    }
+    return TimestampSpan{static_cast<const uint64_t*>(frame.data()), frame.size() / sizeof(uint64_t)};
+}
+
+BufferStreamClient::BufferStreamClient(int channel, const StreamOptions& options_)
+    : number(channel), port(4241 + channel), options(options_),
       data_socket(streamsContext, zmq::socket_type::pair),
       monitor_socket(streamsContext, zmq::socket_type::pair),
-      running(false)
+      running(false), buffer(options_.ring_slots), pending_bytes(0), dropped(0), blocked_pushes(0), copied(0), merge_signal(nullptr),
+      activity_signal(nullptr), messages_received(0), ended(false), last_message(0),
+      events_received(0), bytes_received(0), peak_buffered(0), merge_lag_ns(0),
+      memory_bytes(0), spilled_messages(0), spilled_bytes(0), spill_failed(false)
 {
     // Connect to the DataLinkTargetService stream port for this channel (localhost)
     std::string addr = "tcp://127.0.0.1:" + std::to_string(port);
@@ -43,9 +107,82 @@ void BufferStreamClient::join() {
     if (recv_thread.joinable()) {
         recv_thread.join();
     }
+    if (backpressure_waits() > 0 || dropped_messages() > 0) {
+        std::cerr << "[channel " << number << "] ring backpressure: " << backpressure_waits()
+                  << " messages waited for ring space, " << dropped_messages() << " messages dropped" << std::endl;
+    }
+    if (spilled_messages.load(std::memory_order_relaxed) > 0) {
+        std::cerr << "[channel " << number << "] " << spilled_messages.load(std::memory_order_relaxed) << " messages ("
+                  << spilled_bytes.load(std::memory_order_relaxed) << " bytes) spilled to disk over the memory budget" << std::endl;
+    }
+    if (options.zero_copy && copied_messages() > 0) {
+        std::cerr << "[channel " << number << "] " << copied_messages()
+                  << " unaligned messages were copied" << std::endl;
+    }
+}
+
+StreamStats BufferStreamClient::stats() const {
+    StreamStats stats;
+    stats.channel = number;
+    stats.messages = messages_received.load(std::memory_order_relaxed);
+    stats.events = events_received.load(std::memory_order_relaxed);
+    stats.bytes = bytes_received.load(std::memory_order_relaxed);
+    stats.queued = buffer.size();
+    stats.buffered_bytes = pending_bytes.load(std::memory_order_relaxed);
+    stats.peak_buffered_bytes = peak_buffered.load(std::memory_order_relaxed);
+    stats.merge_lag_ms = merge_lag_ns.load(std::memory_order_relaxed) / 1e6;
+    stats.memory_bytes = memory_bytes.load(std::memory_order_relaxed);
+    stats.spilled_messages = spilled_messages.load(std::memory_order_relaxed);
+    stats.spilled_bytes = spilled_bytes.load(std::memory_order_relaxed);
+    return stats;
+}
+
+size_t BufferStreamClient::process_memory_bytes() {
+    return processMemoryBytes.load(std::memory_order_relaxed);
+}
+
+void BufferStreamClient::pop_message() {
+    const StreamMessage* message = buffer.front();
+    pending_bytes.fetch_sub(message->size_bytes(), std::memory_order_relaxed);
+    if (!message->spilled()) {
+        memory_bytes.fetch_sub(message->size_bytes(), std::memory_order_relaxed);
+        processMemoryBytes.fetch_sub(message->size_bytes(), std::memory_order_relaxed);
+    }
+    buffer.pop();
+}
+
+size_t BufferStreamClient::discard_queued() {
+    size_t discarded = 0;
+    while (buffer.front() != nullptr) {
+        pop_message();
+        ++discarded;
+    }
+    return discarded;
+}
+
+void BufferStreamClient::set_activity_signal(MergeSignal* signal) {
+    std::lock_guard<std::mutex> lock(signal_mutex);
+    activity_signal = signal;
+}
+
+void BufferStreamClient::set_merge_signal(MergeSignal* signal) {
+    std::lock_guard<std::mutex> lock(signal_mutex);
+    merge_signal = signal;
+}
+
+void BufferStreamClient::notify_waiters() {
+    // Notify under the lock: a signal being detached is not destroyed while it is notified
+    std::lock_guard<std::mutex> lock(signal_mutex);
+    if (merge_signal != nullptr) {
+        merge_signal->notify();
+    }
+    if (activity_signal != nullptr) {
+        activity_signal->notify();
+    }
 }
 
 void BufferStreamClient::run() {
+    apply_thread_placement(options.placement, "tt-recv-ch" + std::to_string(number));
     // Poll on both data and monitor sockets
     zmq_pollitem_t items[2];
     items[0].socket = data_socket.handle();
@@ -58,35 +195,80 @@ void BufferStreamClient::run() {
             break;  // interrupted or error
         }
         if (items[0].revents & ZMQ_POLLIN) {
-            // Received a data message (timestamps)
-            zmq_msg_t msg;
-            zmq_msg_init(&msg);
-            int received = zmq_msg_recv(&msg, data_socket.handle(), 0);
+            // Received a data message (timestamps); the frame is handed to the ring without copying
+            zmq::message_t frame;
+            int received = zmq_msg_recv(frame.handle(), data_socket.handle(), 0);
             if (received >= 0) {
-                size_t msg_size = zmq_msg_size(&msg);
-                uint8_t* data_ptr = static_cast<uint8_t*>(zmq_msg_data(&msg));
-                if (msg_size == 0) {
+                if (frame.size() == 0) {
                     // Zero-length message indicates end-of-stream
                     running = false;
+                    ended.store(true, std::memory_order_release);
+                    notify_waiters();
                 } else {
-                    // Buffer the received bytes (each timestamp is 8 bytes, unsigned 64-bit)
-                    std::vector<uint8_t> message(data_ptr, data_ptr + msg_size);
-                    buffer.push_back(std::move(message));
-                    size_t received_timestamps = msg_size / 8;
-                    // Log buffering info (channel, count, total buffered bytes)
-                    size_t total_buffered = 0;
-                    for (auto& chunk : buffer) {
-                        total_buffered += chunk.size();
+                    // Each timestamp is 8 bytes, unsigned 64-bit
+                    auto arrival = std::chrono::steady_clock::now();
+                    StreamMessage message(std::move(frame), options.zero_copy, arrival);
+                    if (message.copied()) {
+                        copied.fetch_add(1, std::memory_order_relaxed);
+                    }
+                    size_t msg_size = message.size_bytes();
+                    // Over the memory budget, the payload goes to a spill segment on disk
+                    bool over_budget =
+                        (options.memory_budget > 0 &&
+                         memory_bytes.load(std::memory_order_relaxed) + msg_size > options.memory_budget) ||
+                        (options.process_memory_budget > 0 &&
+                         processMemoryBytes.load(std::memory_order_relaxed) + msg_size > options.process_memory_budget);
+                    if (over_budget && !spill_failed) {
+                        try {
+                            if (!spill_store) {
+                                spill_store.reset(new SpillStore(options.spill_dir));
+                            }
+                            message.spill(*spill_store);
+                            spilled_messages.fetch_add(1, std::memory_order_relaxed);
+                            spilled_bytes.fetch_add(msg_size, std::memory_order_relaxed);
+                        } catch (const std::exception& e) {
+                            // Keep buffering in memory; reported once
+                            spill_failed = true;
+                            std::cerr << "[channel " << number << "] spilling to disk failed, buffering in memory: "
+                                      << e.what() << std::endl;
+                        }
+                    }
+                    const size_t in_memory = message.spilled() ? 0 : msg_size;
+                    memory_bytes.fetch_add(in_memory, std::memory_order_relaxed);
+                    processMemoryBytes.fetch_add(in_memory, std::memory_order_relaxed);
+                    // Account the bytes before publishing so the merger never subtracts them first
+                    size_t total_buffered = pending_bytes.fetch_add(msg_size, std::memory_order_relaxed) + msg_size;
+                    // Hand the message to the merger; if the ring is full, wait for it to drain (backpressure)
+                    bool pushed = buffer.try_push(message);
+                    if (!pushed) {
+                        blocked_pushes.fetch_add(1, std::memory_order_relaxed);
+                    }
+                    while (!pushed && running) {
+                        std::this_thread::yield();
+                        pushed = buffer.try_push(message);
+                    }
+                    if (pushed) {
+                        // Counters only; StreamMetricsReporter samples and logs them off this thread
+                        last_message.store(arrival.time_since_epoch().count(), std::memory_order_relaxed);
+                        events_received.fetch_add(msg_size / sizeof(uint64_t), std::memory_order_relaxed);
+                        bytes_received.fetch_add(msg_size, std::memory_order_relaxed);
+                        size_t peak = peak_buffered.load(std::memory_order_relaxed);
+                        while (total_buffered > peak &&
+                               !peak_buffered.compare_exchange_weak(peak, total_buffered, std::memory_order_relaxed)) {
+                        }
+                        messages_received.fetch_add(1, std::memory_order_release);
+                        notify_waiters();
+                    } else {
+                        pending_bytes.fetch_sub(msg_size, std::memory_order_relaxed);
+                        memory_bytes.fetch_sub(in_memory, std::memory_order_relaxed);
+                        processMemoryBytes.fetch_sub(in_memory, std::memory_order_relaxed);
+                        dropped.fetch_add(1, std::memory_order_relaxed);
                     }
-                    std::cerr << "[channel " << number << "] buffering " << received_timestamps
-                              << " timestamps (message #" << buffer.size() 
-                              << ", buffered: " << total_buffered << " bytes)" << std::endl;
                 }
             } else {
                 // recv error (socket likely closed), stop
                 running = false;
             }
-            zmq_msg_close(&msg);
         }
         if (items[1].revents & ZMQ_POLLIN) {
             // Monitor event received (e.g., socket disconnected)
@@ -106,145 +288,278 @@ void BufferStreamClient::run() {
 }
 
 TimestampsMergerThread::TimestampsMergerThread(const std::vector<BufferStreamClient*>& streams_, 
-                                               const std::string& output_path, 
+                                               const std::string& output_path_, 
                                                uint64_t sub_acquisition_pper_)
     : streams(streams_), expect_more(true),
-      outfile(output_path), sub_acquisition_pper(sub_acquisition_pper_),
-      next_merge_index(0), total_merged(0)
+      outfile(new MergedTimestampWriter(output_path_)), output_path(output_path_), files{output_path_},
+      file_first_index(0), closed_records(0), rotate_pending(false), sub_acquisition_pper(sub_acquisition_pper_),
+      next_merge_index(0), indexer(streams_.size(), sub_acquisition_pper_, sub_acquisition_window(sub_acquisition_pper_)),
+      heads(streams_.size()),
+      total_merged(0), batches_merged(0), coincidences(nullptr), live_stream(nullptr)
 {
-    if (!outfile.is_open()) {
-        throw std::runtime_error("Cannot open output file: " + output_path);
+    // Ask every stream to wake this merger when it has new data
+    for (BufferStreamClient* stream : streams) {
+        stream->set_merge_signal(&signal);
     }
 }
 
 TimestampsMergerThread::~TimestampsMergerThread() {
-    if (outfile.is_open()) {
-        outfile.close();
+    // Detach first: once no receiver can reach `signal`, it may go away with this object.
+    // join() wakes the merger itself, so no notification is lost.
+    for (BufferStreamClient* stream : streams) {
+        stream->set_merge_signal(nullptr);
     }
+    join();
 }
 
 void TimestampsMergerThread::start() {
+    if (coincidences) {
+        counting.reset(new CoincidenceCounterThread(*coincidences));
+    }
     merge_thread = std::thread(&TimestampsMergerThread::run, this);
 }
 
 void TimestampsMergerThread::join() {
-    // Signal that no more new timestamps will arrive
+    // Signal that no more new timestamps will arrive and wake the merger so it flushes immediately
     expect_more = false;
+    signal.wake();
     if (merge_thread.joinable()) {
         merge_thread.join();
     }
+    // Flush the last block and finalize the header so the file can be read right away
+    if (outfile->is_open()) {
+        outfile->close();
+        std::cerr << "Merged output written: " << outfile->io_summary() << std::endl;
+    }
 }
 
-bool TimestampsMergerThread::all_channels_buffer_ready() {
-    // Check if each stream has at least next_merge_index+1 messages buffered and that message is not empty
-    for (BufferStreamClient* stream : streams) {
-        if (stream->buffer.size() <= next_merge_index) {
-            return false;
-        }
-        if (stream->buffer[next_merge_index].empty()) {
-            return false;
-        }
+bool TimestampsMergerThread::next_batch_ready(std::chrono::steady_clock::time_point& wake_at, bool flushing) {
+    for (size_t c = 0; c < streams.size(); ++c) {
+        BufferStreamClient* stream = streams[c];
+        const StreamMessage* message = stream->buffer.front();
+        const StreamMessage* following = message != nullptr ? stream->buffer.second() : nullptr;
+        SubAcquisitionIndexer::Head& head = heads[c];
+        head.present = message != nullptr;
+        head.arrival = message != nullptr ? message->arrival_time() : std::chrono::steady_clock::time_point();
+        head.has_following = following != nullptr;
+        head.following = following != nullptr ? following->arrival_time() : std::chrono::steady_clock::time_point();
+        head.ended = flushing || stream->stream_ended();
     }
-    return true;
+    batch = indexer.plan(heads, std::chrono::steady_clock::now());
+    wake_at = batch.deadline;
+    return batch.ready;
 }
 
-void TimestampsMergerThread::merge_next_timestamp_block() {
-    // Collect all timestamps from the next message batch (one per stream at next_merge_index)
-    std::vector<std::pair<int, std::vector<uint64_t>>> batchData;
-    batchData.reserve(streams.size());
-    for (BufferStreamClient* stream : streams) {
-        // Convert raw bytes to 64-bit integers
-        const std::vector<uint8_t>& msg_bytes = stream->buffer[next_merge_index];
-        size_t count = msg_bytes.size() / sizeof(uint64_t);
-        std::vector<uint64_t> timestamps(count);
-        memcpy(timestamps.data(), msg_bytes.data(), msg_bytes.size());
-        // Adjust timestamps by adding sub_acquisition_pper * index (to account for each sub-acquisition’s offset)
-        for (uint64_t& ts : timestamps) {
-            ts += sub_acquisition_pper * next_merge_index;
+size_t TimestampsMergerThread::merge_ring_heads() {
+    // Each channel's message for the current sub-acquisition is already time-ordered, so the batch
+    // is a k-way merge of those runs; events are written out as they are produced.
+    for (const SubAcquisitionIndexer::Misplaced& m : batch.misplaced) {
+        std::cerr << "[merger] channel " << streams[m.channel]->number << ": message expected in sub-acquisition "
+                  << m.expected << " merged as " << m.merged << std::endl;
+    }
+    indexer.commit(batch);
+    // Sub-acquisitions in which no channel saw anything produce no messages: skip their indices
+    if (batch.index > next_merge_index) {
+        next_merge_index = batch.index;
+        outfile->end_block(next_merge_index);
+    }
+
+    // Timestamps are adjusted by sub_acquisition_pper * index (each sub-acquisition’s offset)
+    const uint64_t offset = sub_acquisition_pper * next_merge_index;
+    runs.clear();
+    batch_streams.clear();
+    for (size_t c = 0; c < streams.size(); ++c) {
+        BufferStreamClient* stream = streams[c];
+        if (batch.messages[c] > 0) {
+            runs.push_back(TimestampRun{stream->number, stream->buffer.front()->timestamps(), offset});
+            batch_streams.push_back(stream);
         }
-        batchData.emplace_back(stream->number, std::move(timestamps));
-        // Mark this buffer slot as consumed by clearing it (free memory)
-        // (We retain the slot to keep indices aligned; clearing the vector releases its data)
-        const_cast<std::vector<uint8_t>&>(msg_bytes).clear();
-    }
-    // Merge all timestamps from this batch across channels, sorted by timestamp
-    std::vector<std::pair<int, uint64_t>> merged;
-    merged.reserve(batchData.size() * 1000); // reserve some space (guess) to minimize reallocations
-    for (auto& [ch, ts_vec] : batchData) {
-        for (uint64_t ts : ts_vec) {
-            merged.emplace_back(ch, ts);
+        if (batch.messages[c] > 1) {
+            // A stale message merged together with the channel's following one
+            runs.push_back(TimestampRun{stream->number, stream->buffer.second()->timestamps(), offset});
+            batch_streams.push_back(stream);
         }
     }
-    std::sort(merged.begin(), merged.end(), [](const auto& a, const auto& b) {
-        return a.second < b.second;
-    });
-    // Write merged timestamps to output file (channel;timestamp per line)
-    for (auto& [ch, ts] : merged) {
-        outfile << ch << ";" << ts << "\n";
-        ++total_merged;
+    if (rotate_pending) {
+        rotate_output();
+        rotate_pending = false;
     }
-    next_merge_index++;
-    // Log merging progress
-    size_t remaining_buffered = 0;
-    for (BufferStreamClient* stream : streams) {
-        // sum sizes of all remaining (unmerged) messages in buffers
-        for (size_t idx = next_merge_index; idx < stream->buffer.size(); ++idx) {
-            remaining_buffered += stream->buffer[idx].size();
+    // Append merged events to the columnar output; the batch ends a block
+    if (counting || live_stream) {
+        batch_timestamps.clear();
+        batch_channels.clear();
+        kway_merge(runs, [this](int ch, uint64_t ts) {
+            outfile->append(ch, ts);
+            batch_timestamps.push_back(ts);
+            batch_channels.push_back(static_cast<uint8_t>(ch));
+        });
+        if (live_stream) {
+            live_stream->send_batch(batch_timestamps.data(), batch_channels.data(), batch_timestamps.size());
+        }
+        if (counting) {
+            counting->submit(batch_timestamps.data(), batch_channels.data(), batch_timestamps.size());
         }
+    } else {
+        kway_merge(runs, [this](int ch, uint64_t ts) {
+            outfile->append(ch, ts);
+        });
     }
-    std::cerr << "Merged timestamps for batch #" << next_merge_index 
-              << " (total merged: " << total_merged 
-              << ", remaining buffered: " << remaining_buffered << " bytes)" << std::endl;
+    // Release the ring slots back to the receivers (frees the message memory)
+    const auto merged_at = std::chrono::steady_clock::now();
+    for (BufferStreamClient* stream : batch_streams) {
+        const StreamMessage* message = stream->buffer.front();
+        stream->merge_lag_ns.store(std::chrono::duration_cast<std::chrono::nanoseconds>(merged_at - message->arrival_time()).count(),
+                                   std::memory_order_relaxed);
+        stream->pop_message();
+    }
+    next_merge_index++;
+    outfile->end_block(next_merge_index);
+    total_merged.store(closed_records + outfile->record_count(), std::memory_order_relaxed);
+    batches_merged.fetch_add(1, std::memory_order_relaxed);
+    // The next file is opened when the next batch arrives, so the last file is never empty.
+    // (.tsm blocks store 9 bytes per record, timestamp and channel, plus small headers)
+    rotate_pending = (rotation.sub_acquisitions_per_file > 0 && next_merge_index - file_first_index >= rotation.sub_acquisitions_per_file) ||
+                     (rotation.max_bytes > 0 && outfile->record_count() * 9 >= rotation.max_bytes);
+    return runs.size();
+}
+
+void TimestampsMergerThread::rotate_output() {
+    outfile->close();
+    closed_records += outfile->record_count();
+    std::cerr << "Merged output written: " << files.back() << " (sub-acquisitions " << file_first_index
+              << "-" << next_merge_index - 1 << ", " << outfile->io_summary() << ")" << std::endl;
+
+    char suffix[16];
+    snprintf(suffix, sizeof(suffix), "_%03zu", files.size());
+    size_t dot = output_path.find_last_of('.');
+    size_t slash = output_path.find_last_of('/');
+    bool has_extension = dot != std::string::npos && (slash == std::string::npos || dot > slash);
+    std::string next_path = has_extension ? output_path.substr(0, dot) + suffix + output_path.substr(dot)
+                                          : output_path + suffix;
+
+    outfile.reset(new MergedTimestampWriter(next_path));
+    // Blocks of the new file carry the global sub-acquisition index, so files can be concatenated
+    outfile->end_block(next_merge_index);
+    file_first_index = next_merge_index;
+    files.push_back(next_path);
 }
 
 void TimestampsMergerThread::run() {
-    // Continuously check for new data to merge while acquisition is ongoing
+    apply_thread_placement(placement, "tt-merger");
+    // Merge every complete batch, then sleep until a receiver signals a new message or the next
+    // batch's window elapses
+    auto ready = [this]() {
+        std::chrono::steady_clock::time_point unused;
+        return !expect_more || next_batch_ready(unused);
+    };
     while (expect_more) {
-        std::this_thread::sleep_for(std::chrono::seconds(1));
-        // Merge as many batches as are ready
-        while (all_channels_buffer_ready()) {
-            merge_next_timestamp_block();
+        std::chrono::steady_clock::time_point wake_at;
+        while (next_batch_ready(wake_at)) {
+            merge_ring_heads();
+        }
+        if (wake_at == std::chrono::steady_clock::time_point::max()) {
+            signal.wait(ready);
+        } else {
+            signal.wait_until(wake_at, ready);
         }
     }
-    // Once no more data expected, flush any remaining unmerged data (if channels ended unevenly)
-    bool stillData = true;
-    while (stillData) {
-        stillData = false;
-        // Check if any channel still has an unmerged block at current index
-        for (BufferStreamClient* stream : streams) {
-            if (stream->buffer.size() > next_merge_index && !stream->buffer[next_merge_index].empty()) {
-                stillData = true;
-                break;
-            }
+    // Once no more data expected, flush any remaining unmerged data batch by batch
+    std::chrono::steady_clock::time_point unused;
+    while (next_batch_ready(unused, true)) {
+        merge_ring_heads();
+    }
+    if (counting) {
+        counting->finish();
+        if (counting->waits() > 0) {
+            std::cerr << "Coincidence counting fell behind: the merger waited for it " << counting->waits()
+                      << " times" << std::endl;
         }
-        if (stillData) {
-            // Merge whatever is available at this index from any channel(s)
-            std::vector<std::pair<int, uint64_t>> merged;
-            for (BufferStreamClient* stream : streams) {
-                if (stream->buffer.size() > next_merge_index && !stream->buffer[next_merge_index].empty()) {
-                    const std::vector<uint8_t>& msg_bytes = stream->buffer[next_merge_index];
-                    size_t count = msg_bytes.size() / sizeof(uint64_t);
-                    std::vector<uint64_t> timestamps(count);
-                    memcpy(timestamps.data(), msg_bytes.data(), msg_bytes.size());
-                    for (uint64_t& ts : timestamps) {
-                        ts += sub_acquisition_pper * next_merge_index;
-                    }
-                    for (uint64_t ts : timestamps) {
-                        merged.emplace_back(stream->number, ts);
-                    }
-                    // Clear the consumed data
-                    const_cast<std::vector<uint8_t>&>(msg_bytes).clear();
-                }
-            }
-            std::sort(merged.begin(), merged.end(), [](auto& a, auto& b) {
-                return a.second < b.second;
-            });
-            for (auto& [ch, ts] : merged) {
-                outfile << ch << ";" << ts << "\n";
-                ++total_merged;
-            }
-            next_merge_index++;
+    }
+    if (live_stream) {
+        try {
+            live_stream->finish();
+        } catch (const std::exception& e) {
+            std::cerr << "Live stream: " << e.what() << std::endl;
         }
     }
-    // Thread exits; file will be closed in destructor
+    // Thread exits; file is closed by join()
+}
+
+StreamMetricsReporter::StreamMetricsReporter(const std::vector<BufferStreamClient*>& streams_,
+                                             const TimestampsMergerThread* merger_,
+                                             std::chrono::milliseconds interval_)
+    : streams(streams_), merger(merger_), interval(interval_), last_merged(0), stopping(false)
+{
+}
+
+StreamMetricsReporter::~StreamMetricsReporter() {
+    stop();
+}
+
+void StreamMetricsReporter::start() {
+    for (BufferStreamClient* stream : streams) {
+        last.push_back(stream->stats());
+    }
+    last_merged = merger != nullptr ? merger->merged_records() : 0;
+    last_sample = std::chrono::steady_clock::now();
+    thread = std::thread(&StreamMetricsReporter::run, this);
+}
+
+void StreamMetricsReporter::stop() {
+    if (!thread.joinable()) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    cv.notify_all();
+    thread.join();
+    report();  // final sample
+}
+
+void StreamMetricsReporter::run() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!cv.wait_for(lock, interval, [this] { return stopping; })) {
+        lock.unlock();
+        report();
+        lock.lock();
+    }
+}
+
+void StreamMetricsReporter::report() {
+    auto now = std::chrono::steady_clock::now();
+    double seconds = std::chrono::duration<double>(now - last_sample).count();
+    if (seconds <= 0.0) {
+        return;
+    }
+    std::ostringstream oss;
+    oss.setf(std::ios::fixed);
+    oss.precision(1);
+    oss << "[stream metrics]";
+    for (size_t i = 0; i < streams.size(); ++i) {
+        StreamStats stats = streams[i]->stats();
+        oss << " ch" << stats.channel << ": "
+            << (stats.messages - last[i].messages) / seconds << " msg/s, "
+            << (stats.events - last[i].events) / seconds / 1e6 << " Mev/s, "
+            << (stats.bytes - last[i].bytes) / seconds / 1e6 << " MB/s, queue " << stats.queued
+            << " (" << stats.buffered_bytes / 1e6 << " MB, peak " << stats.peak_buffered_bytes / 1e6 << " MB), lag "
+            << stats.merge_lag_ms << " ms";
+        if (stats.spilled_messages > 0) {
+            oss << ", spilled " << stats.spilled_bytes / 1e6 << " MB (" << stats.memory_bytes / 1e6 << " MB in RAM)";
+        }
+        oss << " |";
+        last[i] = stats;
+    }
+    if (merger != nullptr) {
+        uint64_t merged = merger->merged_records();
+        oss << " merged: " << (merged - last_merged) / seconds / 1e6 << " Mev/s, "
+            << merger->merged_batches() << " batches";
+        last_merged = merged;
+    }
+    if (BlockPool::shared().hits() + BlockPool::shared().misses() > 0) {
+        oss << " | buffer pool: " << BlockPool::shared().summary();
+    }
+    last_sample = now;
+    std::cerr << oss.str() << std::endl;
 }
@@ -2,20 +2,156 @@
 #define STREAMS_HPP
 
 #include <vector>
+#include <chrono>
 #include <cstdint>
 #include <thread>
 #include <mutex>
 #include <atomic>
+#include <condition_variable>
 #include <fstream>
+#include <memory>
+#include <string>
 #include <zmq.hpp>
+#include "spsc_ring.hpp"
+#include "timestamp_merge.hpp"
+#include "timestamp_file.hpp"
+#include "coincidence.hpp"
+#include "live_stream.hpp"
+#include "spill_store.hpp"
+#include "block_pool.hpp"
+#include "thread_affinity.hpp"
+#include "sub_acquisition_index.hpp"
+
+// Default number of message slots in each channel's ring (one slot per DLT message / sub-acquisition)
+constexpr size_t DEFAULT_STREAM_RING_SLOTS = 4096;
+
+// Options for a BufferStreamClient
+struct StreamOptions {
+    size_t ring_slots = DEFAULT_STREAM_RING_SLOTS;
+    bool zero_copy = true;     // keep the received ZMQ frame instead of copying its payload
+    size_t memory_budget = 0;          // buffered bytes kept in RAM per channel before spilling to disk (0: no limit)
+    size_t process_memory_budget = 0;  // the same for all channels of the process together (0: no limit)
+    std::string spill_dir;             // where spill segments are created (empty: system temporary directory)
+    ThreadPlacement placement;         // CPUs and priority of the receiver thread
+};
+
+// Place the ZeroMQ I/O thread that carries the DLT streams. Takes effect only if called before the
+// first BufferStreamClient is created (the thread starts with the first stream socket).
+void configure_stream_io_threads(const ThreadPlacement& placement);
+
+// One DLT message (timestamps of one sub-acquisition on one channel) as stored in a channel's ring.
+// In zero-copy mode the received zmq::message_t itself is kept and its payload is exposed in place;
+// otherwise (or if the frame is not 8-byte aligned) the payload is copied into a block recycled
+// through BlockPool::shared(), which returns to the pool when the merger releases the slot.
+class StreamMessage {
+public:
+    StreamMessage() = default;
+    StreamMessage(zmq::message_t&& frame, bool zero_copy,
+                  std::chrono::steady_clock::time_point arrival = std::chrono::steady_clock::time_point());
+
+    StreamMessage(StreamMessage&&) = default;
+    StreamMessage& operator=(StreamMessage&&) = default;
+
+    TimestampSpan timestamps() const;
+    size_t size_bytes() const { return timestamps().size() * sizeof(uint64_t); }
+    bool empty() const { return timestamps().empty(); }
+    bool copied() const { return static_cast<bool>(owned); }
+    bool spilled() const { return spill_segment != nullptr; }
+    // Move the payload to a spill segment and release the frame or copy held in memory; throws
+    // std::runtime_error if the store cannot write it
+    void spill(SpillStore& store);
+    // When the receiver got the message (identifies its sub-acquisition, see TimestampsMergerThread)
+    std::chrono::steady_clock::time_point arrival_time() const { return arrival; }
+
+private:
+    zmq::message_t frame;          // received frame (zero-copy mode)
+    PooledBlock owned;             // copied payload (copy mode / unaligned frame)
+    size_t owned_count = 0;
+    std::shared_ptr<SpillSegment> spill_segment;   // spilled payload (over the memory budget)
+    TimestampSpan spilled_span;
+    std::chrono::steady_clock::time_point arrival;
+};
 
 // Forward declaration
 class TimestampsMergerThread;
 
+// Output rotation for continuous acquisitions: the merger starts a new file at the next
+// sub-acquisition boundary once the current one spans `sub_acquisitions_per_file` sub-acquisitions
+// or holds about `max_bytes`. Files are contiguous: no sub-acquisition is split or skipped.
+struct MergedFileRotation {
+    uint64_t sub_acquisitions_per_file = 0;  // 0: no time limit
+    uint64_t max_bytes = 0;                  // 0: no size limit
+
+    bool enabled() const { return sub_acquisitions_per_file > 0 || max_bytes > 0; }
+};
+
+// Wakeup channel from the stream receiver threads to the merger thread (and to an acquisition
+// waiting for the end of its data).
+// notify() is cheap when the merger is busy (one fence and a flag check); the mutex is only
+// taken when the merger is actually blocked in wait().
+class MergeSignal {
+public:
+    // Receiver side: new data or end of stream is available
+    void notify() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (waiting.load(std::memory_order_relaxed)) {
+            std::lock_guard<std::mutex> lock(mutex);
+            cv.notify_one();
+        }
+    }
+
+    // Unconditional wakeup (used when the merger is asked to stop)
+    void wake() {
+        std::lock_guard<std::mutex> lock(mutex);
+        cv.notify_all();
+    }
+
+    // Merger side: block until ready() returns true
+    template <typename Predicate>
+    void wait(Predicate ready) {
+        std::unique_lock<std::mutex> lock(mutex);
+        waiting.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        cv.wait(lock, ready);
+        waiting.store(false, std::memory_order_relaxed);
+    }
+
+    // As wait(), but give up at `deadline`; returns ready()
+    template <typename Predicate>
+    bool wait_until(std::chrono::steady_clock::time_point deadline, Predicate ready) {
+        std::unique_lock<std::mutex> lock(mutex);
+        waiting.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        bool result = cv.wait_until(lock, deadline, ready);
+        waiting.store(false, std::memory_order_relaxed);
+        return result;
+    }
+
+private:
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::atomic<bool> waiting{false};
+};
+
+// Counters of one BufferStreamClient, as sampled by StreamMetricsReporter
+struct StreamStats {
+    int channel = 0;
+    uint64_t messages = 0;           // messages (sub-acquisitions) received
+    uint64_t events = 0;             // timestamps received
+    uint64_t bytes = 0;
+    size_t queued = 0;               // messages waiting in the ring
+    size_t buffered_bytes = 0;
+    size_t peak_buffered_bytes = 0;  // high-water mark of buffered_bytes
+    double merge_lag_ms = 0.0;       // arrival-to-merge delay of the last merged message
+    size_t memory_bytes = 0;         // buffered bytes held in RAM (the rest is spilled)
+    uint64_t spilled_messages = 0;   // messages written to spill segments
+    uint64_t spilled_bytes = 0;
+};
+
 // Client that connects to a DLT timestamp stream (ZMQ PAIR) for one channel and buffers incoming data
 class BufferStreamClient {
 public:
-    explicit BufferStreamClient(int channel);
+    explicit BufferStreamClient(int channel, const StreamOptions& options = StreamOptions());
     ~BufferStreamClient();
 
     // Start the receiver thread
@@ -27,6 +163,39 @@ public:
     int channel_number() const { return number; }
     // (The buffer is accessed by the merger thread directly)
 
+    // Backpressure counters: messages the receiver had to wait for ring space for (however long it
+    // retried), and messages dropped on shutdown while full
+    uint64_t backpressure_waits() const { return blocked_pushes.load(std::memory_order_relaxed); }
+    uint64_t dropped_messages() const { return dropped.load(std::memory_order_relaxed); }
+    // Bytes received but not yet consumed by the merger
+    size_t buffered_bytes() const { return pending_bytes.load(std::memory_order_relaxed); }
+    // Messages whose payload had to be copied (copy mode, or frames not aligned for in-place access)
+    uint64_t copied_messages() const { return copied.load(std::memory_order_relaxed); }
+
+    // Snapshot of the counters (lock-free; callable from any thread)
+    StreamStats stats() const;
+
+    // Drop every message still queued in the ring; returns how many. Takes the consumer side, so
+    // only call it while no merger is running on this stream.
+    size_t discard_queued();
+    // Buffered bytes held in RAM by all stream clients of the process
+    static size_t process_memory_bytes();
+
+    // Completion tracking: DLT sends one message per channel and sub-acquisition, and a zero-length
+    // message when the stream ends. `signal` (may be null) is notified on every message and at the
+    // end of stream, in addition to the attached merger.
+    // Once this returns, the previous signal is no longer used and may be destroyed.
+    void set_activity_signal(MergeSignal* signal);
+    // Messages (sub-acquisitions) received since start()
+    uint64_t messages() const { return messages_received.load(std::memory_order_acquire); }
+    // Whether DLT has ended the stream
+    bool stream_ended() const { return ended.load(std::memory_order_acquire); }
+    // When the last message arrived (steady clock)
+    std::chrono::steady_clock::time_point last_message_time() const {
+        return std::chrono::steady_clock::time_point(
+            std::chrono::steady_clock::duration(last_message.load(std::memory_order_acquire)));
+    }
+
     // Expose port (for use in constructing DLT command)
     int port;
 
@@ -35,38 +204,143 @@ public:
 
 private:
     void run();  // Thread loop function for receiving data
+    void pop_message();     // Consumer: release the ring head and its buffered-bytes accounting
+    void notify_waiters();  // Wake the attached merger and activity signal (if any) after new data or end of stream
 
     int number;
+    StreamOptions options;
     zmq::socket_t data_socket;
     zmq::socket_t monitor_socket;
     std::atomic<bool> running;
-    std::vector<std::vector<uint8_t>> buffer;  // Buffer of raw message data for this channel
+    SpscRing<StreamMessage> buffer;            // Messages for this channel (receiver produces, merger consumes)
+    std::atomic<size_t> pending_bytes;
+    std::atomic<uint64_t> dropped;
+    std::atomic<uint64_t> blocked_pushes;
+    std::atomic<uint64_t> copied;
+    void set_merge_signal(MergeSignal* signal);  // Same contract as set_activity_signal()
+
+    std::mutex signal_mutex;                   // held while a signal is notified, so it can be detached safely
+    MergeSignal* merge_signal;                 // set by the merger attached to this stream
+    MergeSignal* activity_signal;
+    std::atomic<uint64_t> messages_received;
+    std::atomic<bool> ended;
+    std::atomic<std::chrono::steady_clock::rep> last_message;
+    std::atomic<uint64_t> events_received;
+    std::atomic<uint64_t> bytes_received;
+    std::atomic<size_t> peak_buffered;
+    std::atomic<int64_t> merge_lag_ns;        // written by the merger
+    std::atomic<size_t> memory_bytes;         // part of pending_bytes held in RAM
+    std::atomic<uint64_t> spilled_messages;
+    std::atomic<uint64_t> spilled_bytes;
+    std::unique_ptr<SpillStore> spill_store;  // created by the receiver when first needed
+    bool spill_failed;
     std::thread recv_thread;
 };
 
-// Thread that merges timestamps from multiple BufferStreamClients
+// Thread that merges timestamps from multiple BufferStreamClients into a binary columnar file (.tsm)
+//
+// DLT sends one message per channel and sub-acquisition, but nothing for a sub-acquisition in which
+// a channel saw no events, so ring heads cannot simply be merged index by index. A
+// SubAcquisitionIndexer places each head by its arrival time against the epoch of the first batch
+// and decides when a batch is complete: a silent channel delays merging by at most
+// sub_acquisition_window(). Sub-acquisitions in which no channel saw anything keep their index and
+// time offset; messages merged outside their expected slot are logged.
 class TimestampsMergerThread {
 public:
     TimestampsMergerThread(const std::vector<BufferStreamClient*>& streams, const std::string& output_path, uint64_t sub_acquisition_pper);
     ~TimestampsMergerThread();
 
+    // Also feed every merged batch to a coincidence counter (call before start()). The counting runs
+    // on its own thread, so it does not hold up ring draining; the counter is finished, and its
+    // results complete, when join() returns.
+    void set_coincidence_counter(CoincidenceCounter* counter) { coincidences = counter; }
+    // Also forward every merged batch to the master as it is produced (call before start(); the
+    // end-of-stream marker is sent when the merger has flushed its last batch)
+    void set_live_stream(LiveStreamSender* sender) { live_stream = sender; }
+    // Rotate the output file (call before start()). The first file is `output_path`, the following
+    // ones `<stem>_001.tsm`, `<stem>_002.tsm`, ...
+    void set_rotation(const MergedFileRotation& policy) { rotation = policy; }
+    // CPUs and priority of the merging thread (call before start())
+    void set_placement(const ThreadPlacement& placement_) { placement = placement_; }
+
+    // Progress counters (callable from any thread)
+    uint64_t merged_records() const { return total_merged.load(std::memory_order_relaxed); }
+    uint64_t merged_batches() const { return batches_merged.load(std::memory_order_relaxed); }
+
+    // Files written so far, in order (complete after join())
+    const std::vector<std::string>& output_files() const { return files; }
+
     // Start the merging thread
     void start();
-    // Signal to stop (no more incoming data expected) and wait for thread to finish
+    // Signal to stop (no more incoming data expected), wait for thread to finish and close the output file
     void join();
 
 private:
     void run();                            // Thread loop for merging logic
-    bool all_channels_buffer_ready();      // Check if all streams have an unmerged message at current index
-    void merge_next_timestamp_block();     // Merge one batch of timestamps (current index) from all channels
+    // Plan the next batch from the ring heads; returns whether it is complete. Otherwise `wake_at` is
+    // set to when its window will have elapsed (time_point::max() if there is no batch yet).
+    // When flushing, every stream is treated as ended.
+    bool next_batch_ready(std::chrono::steady_clock::time_point& wake_at, bool flushing = false);
+    size_t merge_ring_heads();             // K-way merge the batch planned last; returns runs merged
+    void rotate_output();                  // Close the current output file and start the next one
 
     std::vector<BufferStreamClient*> streams;
     std::atomic<bool> expect_more;
+    MergeSignal signal;               // receivers wake the merger through this as soon as data arrives
     std::thread merge_thread;
-    std::ofstream outfile;
+    std::unique_ptr<MergedTimestampWriter> outfile;   // binary columnar output (see timestamp_file.hpp)
+    std::string output_path;
+    std::vector<std::string> files;
+    MergedFileRotation rotation;
+    ThreadPlacement placement;
+    uint64_t file_first_index;       // sub-acquisition index the current file starts at
+    uint64_t closed_records;         // records in the files already rotated out
+    bool rotate_pending;             // the current file is full; start the next one with the next batch
     uint64_t sub_acquisition_pper;  // period (interval) of sub-acquisition in picoseconds
     size_t next_merge_index;
-    uint64_t total_merged;
+    SubAcquisitionIndexer indexer;
+    std::vector<SubAcquisitionIndexer::Head> heads;  // ring heads the current batch was planned from
+    SubAcquisitionIndexer::Batch batch;              // next batch to merge
+    std::atomic<uint64_t> total_merged;
+    std::atomic<uint64_t> batches_merged;
+    std::vector<TimestampRun> runs;  // per-batch run list, reused across batches
+    std::vector<BufferStreamClient*> batch_streams;  // streams contributing to the current batch
+    CoincidenceCounter* coincidences;           // optional consumer of the merged stream
+    std::unique_ptr<CoincidenceCounterThread> counting;  // runs `coincidences` off the merging thread
+    LiveStreamSender* live_stream;              // optional live forwarding of the merged stream
+    std::vector<uint64_t> batch_timestamps;     // merged batch handed to the optional consumers
+    std::vector<uint8_t> batch_channels;
+};
+
+// Thread that logs the stream clients' and the merger's counters every `interval`: per channel the
+// message, event and byte rates, ring depth, buffered bytes with their high-water mark and the merge
+// lag, and the merged event rate. It only reads atomics, so observing an acquisition does not slow
+// down the receivers or the merger.
+class StreamMetricsReporter {
+public:
+    // `merger` may be null; the streams and the merger must outlive the reporter
+    StreamMetricsReporter(const std::vector<BufferStreamClient*>& streams, const TimestampsMergerThread* merger,
+                          std::chrono::milliseconds interval);
+    ~StreamMetricsReporter();
+
+    void start();
+    // Stop the thread and log a final sample
+    void stop();
+
+private:
+    void run();
+    void report();
+
+    std::vector<BufferStreamClient*> streams;
+    const TimestampsMergerThread* merger;
+    std::chrono::milliseconds interval;
+    std::vector<StreamStats> last;
+    uint64_t last_merged;
+    std::chrono::steady_clock::time_point last_sample;
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool stopping;
+    std::thread thread;
 };
 
 #endif // STREAMS_HPP
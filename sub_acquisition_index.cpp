@@ -0,0 +1,128 @@
+#include "sub_acquisition_index.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// Fraction of a batch's mean arrival residual folded into the epoch: small enough that jitter
+// averages out, large enough to follow clock drift over minutes
+constexpr double EPOCH_DRIFT_GAIN = 1.0 / 64.0;
+
+} // namespace
+
+SubAcquisitionIndexer::SubAcquisitionIndexer(size_t channels, uint64_t pper_ps, Clock::duration window)
+    : period(pper_ps * 1e-12), window(window), started(false), next(0),
+      has_last(channels, false), last(channels, 0)
+{
+}
+
+uint64_t SubAcquisitionIndexer::slot(Clock::time_point arrival, Clock::time_point origin) const {
+    if (period <= 0.0) {
+        return next;
+    }
+    double periods = std::chrono::duration<double>(arrival - origin).count() / period;
+    return periods > 0.0 ? static_cast<uint64_t>(std::llround(periods)) : 0;
+}
+
+SubAcquisitionIndexer::Clock::time_point SubAcquisitionIndexer::expected_arrival(uint64_t index,
+                                                                                 Clock::time_point origin) const {
+    return origin + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(period * index));
+}
+
+SubAcquisitionIndexer::Batch SubAcquisitionIndexer::plan(const std::vector<Head>& heads, Clock::time_point now) const {
+    Batch batch;
+    batch.messages.assign(heads.size(), 0);
+
+    // Until the first batch is merged, the earliest head defines the epoch
+    batch.origin = epoch;
+    if (!started) {
+        batch.origin = Clock::time_point::max();
+        for (const Head& head : heads) {
+            if (head.present) {
+                batch.origin = std::min(batch.origin, head.arrival);
+            }
+        }
+    }
+
+    // Index each channel's head would take, and how many of its messages go with it
+    std::vector<uint64_t> candidate(heads.size(), 0);
+    std::vector<int> take(heads.size(), 0);
+    bool any = false;
+    for (size_t c = 0; c < heads.size(); ++c) {
+        if (!heads[c].present) {
+            continue;
+        }
+        const uint64_t floor = has_last[c] ? std::max(next, last[c] + 1) : next;
+        const uint64_t head_slot = slot(heads[c].arrival, batch.origin);
+        if (head_slot >= floor) {
+            candidate[c] = head_slot;
+            take[c] = 1;
+        } else if (heads[c].has_following) {
+            // Stale head: ride along with the channel's following message
+            candidate[c] = std::max(slot(heads[c].following, batch.origin), floor);
+            take[c] = 2;
+        } else {
+            candidate[c] = floor;
+            take[c] = 1;
+        }
+        if (!any || candidate[c] < batch.index) {
+            batch.index = candidate[c];
+            any = true;
+        }
+    }
+    if (!any) {
+        return batch;
+    }
+
+    const Clock::time_point expected = expected_arrival(batch.index, batch.origin);
+    Clock::time_point earliest = Clock::time_point::max();
+    for (size_t c = 0; c < heads.size(); ++c) {
+        if (take[c] == 0 || candidate[c] != batch.index) {
+            continue;
+        }
+        batch.messages[c] = take[c];
+        earliest = std::min(earliest, heads[c].arrival);
+        for (int m = 0; m < take[c]; ++m) {
+            const Clock::time_point arrival = m == 0 ? heads[c].arrival : heads[c].following;
+            const uint64_t message_slot = slot(arrival, batch.origin);
+            if (message_slot != batch.index) {
+                batch.misplaced.push_back(Misplaced{c, message_slot, batch.index});
+            } else {
+                batch.residual += std::chrono::duration<double>(arrival - expected).count();
+                ++batch.in_slot;
+            }
+        }
+    }
+
+    // Channels without a head may still deliver this sub-acquisition until `window` after it was due
+    const Clock::time_point deadline = std::max(expected, earliest) + window;
+    bool waiting = false;
+    for (size_t c = 0; c < heads.size(); ++c) {
+        if (!heads[c].present && !heads[c].ended) {
+            waiting = true;
+        }
+    }
+    batch.ready = !waiting || now >= deadline;
+    if (!batch.ready) {
+        batch.deadline = deadline;
+    }
+    return batch;
+}
+
+void SubAcquisitionIndexer::commit(const Batch& batch) {
+    if (!started) {
+        epoch = batch.origin;
+        started = true;
+    }
+    if (batch.in_slot > 0) {
+        epoch += std::chrono::duration_cast<Clock::duration>(
+            std::chrono::duration<double>(EPOCH_DRIFT_GAIN * batch.residual / batch.in_slot));
+    }
+    for (size_t c = 0; c < batch.messages.size(); ++c) {
+        if (batch.messages[c] > 0) {
+            has_last[c] = true;
+            last[c] = batch.index;
+        }
+    }
+    next = batch.index + 1;
+}
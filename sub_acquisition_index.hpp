@@ -0,0 +1,97 @@
+#ifndef SUB_ACQUISITION_INDEX_HPP
+#define SUB_ACQUISITION_INDEX_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Longest time by which DLT's messages for one sub-acquisition may arrive apart on different
+// channels (see SubAcquisitionIndexer)
+constexpr auto MAX_SUB_ACQUISITION_WINDOW = std::chrono::milliseconds(250);
+
+// Arrival window of one sub-acquisition: half the sub-acquisition period, at most
+// MAX_SUB_ACQUISITION_WINDOW
+inline std::chrono::steady_clock::duration sub_acquisition_window(uint64_t pper_ps) {
+    std::chrono::steady_clock::duration half_period = std::chrono::nanoseconds(pper_ps / 2000);
+    if (half_period <= std::chrono::steady_clock::duration::zero() || half_period > MAX_SUB_ACQUISITION_WINDOW) {
+        return MAX_SUB_ACQUISITION_WINDOW;
+    }
+    return half_period;
+}
+
+// Assigns the DLT messages at the heads of the channel rings to sub-acquisitions.
+//
+// DLT sends one message per channel and sub-acquisition, but nothing for a sub-acquisition in which
+// a channel saw no events, and its messages carry no sub-acquisition number. Messages are placed by
+// arrival time against a fixed epoch (the arrival of the first batch): a message arriving at t
+// belongs to slot round((t - epoch) / period), so delivery jitter below half a period never
+// accumulates into the index. The epoch follows slow drift between the host and Time Controller
+// clocks through a low-gain correction from the messages merged in their slot.
+//
+// A channel never joins a batch at or below the index of its previous one, nor below the next
+// batch to merge. A head whose slot has already passed (its message was delayed) is stale: it is
+// merged together with the channel's following message, so one late message costs one misplaced
+// message rather than shifting the channel by a period from then on. Every message merged outside
+// its slot is listed in Batch::misplaced.
+//
+// The next batch is the smallest index any head can take and holds the heads that take it. It is
+// ready once every other channel has a head, has ended, or has had `window` past the batch's
+// expected arrival to deliver. This class only computes; TimestampsMergerThread owns the rings.
+class SubAcquisitionIndexer {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // The first two messages of one channel's ring
+    struct Head {
+        bool present = false;          // a message is queued
+        Clock::time_point arrival;     // its arrival time
+        bool has_following = false;    // a second message is queued
+        Clock::time_point following;   // its arrival time
+        bool ended = false;            // nothing more will come (stream ended, or flushing)
+    };
+
+    // A message merged outside its expected slot
+    struct Misplaced {
+        size_t channel;
+        uint64_t expected;
+        uint64_t merged;
+    };
+
+    struct Batch {
+        bool ready = false;
+        uint64_t index = 0;                  // sub-acquisition index of the batch
+        std::vector<int> messages;           // messages each channel contributes from its ring (0-2)
+        std::vector<Misplaced> misplaced;
+        Clock::time_point deadline = Clock::time_point::max();  // when to plan again if not ready
+        Clock::time_point origin;            // epoch the batch was planned against
+        double residual = 0.0;               // summed lateness of its in-slot messages (seconds)
+        size_t in_slot = 0;
+    };
+
+    SubAcquisitionIndexer(size_t channels, uint64_t pper_ps, Clock::duration window);
+
+    // Plan the next batch from the current ring heads (one per channel)
+    Batch plan(const std::vector<Head>& heads, Clock::time_point now) const;
+
+    // Record that `batch` has been merged
+    void commit(const Batch& batch);
+
+    // Index the next batch will have at least
+    uint64_t next_index() const { return next; }
+
+private:
+    // Slot of a message arriving at `arrival`, and when sub-acquisition `index` is due, for epoch `origin`
+    uint64_t slot(Clock::time_point arrival, Clock::time_point origin) const;
+    Clock::time_point expected_arrival(uint64_t index, Clock::time_point origin) const;
+
+    double period;                     // seconds
+    Clock::duration window;
+    bool started;
+    Clock::time_point epoch;           // expected arrival of sub-acquisition 0
+    uint64_t next;
+    std::vector<bool> has_last;
+    std::vector<uint64_t> last;        // index of each channel's previous batch
+};
+
+#endif // SUB_ACQUISITION_INDEX_HPP
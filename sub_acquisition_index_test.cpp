@@ -0,0 +1,206 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include "sub_acquisition_index.hpp"
+
+// Replays simulated DLT deliveries (jittered, skewed per channel, with latency steps, clock drift
+// and silent sub-acquisitions) through SubAcquisitionIndexer the way TimestampsMergerThread drives
+// it, and checks that every message is merged at the offset of the sub-acquisition it came from.
+
+namespace {
+
+using Clock = SubAcquisitionIndexer::Clock;
+using Indexer = SubAcquisitionIndexer;
+
+int failures = 0;
+
+void check(bool condition, const std::string& what) {
+    if (!condition) {
+        std::cerr << "FAIL: " << what << std::endl;
+        ++failures;
+    }
+}
+
+struct Message {
+    Clock::time_point arrival;
+    uint64_t sub_acquisition;  // ground truth
+};
+
+struct Merged {
+    size_t batch;              // order in which batches were merged
+    uint64_t index;
+    size_t channel;
+    uint64_t sub_acquisition;
+};
+
+// Step simulated time through deliveries and the indexer's deadlines, merging every ready batch.
+// Returns the merged messages and counts misplaced heads in `misplaced`.
+std::vector<Merged> replay(std::vector<std::vector<Message>> deliveries, uint64_t pper_ps, size_t& misplaced) {
+    const size_t channels = deliveries.size();
+    Indexer indexer(channels, pper_ps, sub_acquisition_window(pper_ps));
+    std::vector<std::deque<Message>> rings(channels);
+    std::vector<size_t> delivered(channels, 0);
+    std::vector<Merged> merged;
+    size_t batches = 0;
+    misplaced = 0;
+
+    Clock::time_point now = Clock::time_point::max();
+    for (const auto& channel : deliveries) {
+        if (!channel.empty()) {
+            now = std::min(now, channel.front().arrival);
+        }
+    }
+
+    std::vector<Indexer::Head> heads(channels);
+    for (;;) {
+        Clock::time_point next_delivery = Clock::time_point::max();
+        for (size_t c = 0; c < channels; ++c) {
+            while (delivered[c] < deliveries[c].size() && deliveries[c][delivered[c]].arrival <= now) {
+                rings[c].push_back(deliveries[c][delivered[c]++]);
+            }
+            if (delivered[c] < deliveries[c].size()) {
+                next_delivery = std::min(next_delivery, deliveries[c][delivered[c]].arrival);
+            }
+            heads[c].present = !rings[c].empty();
+            heads[c].arrival = heads[c].present ? rings[c][0].arrival : Clock::time_point();
+            heads[c].has_following = rings[c].size() > 1;
+            heads[c].following = heads[c].has_following ? rings[c][1].arrival : Clock::time_point();
+            heads[c].ended = delivered[c] == deliveries[c].size();
+        }
+
+        Indexer::Batch batch = indexer.plan(heads, now);
+        if (batch.ready) {
+            indexer.commit(batch);
+            misplaced += batch.misplaced.size();
+            for (size_t c = 0; c < channels; ++c) {
+                for (int m = 0; m < batch.messages[c]; ++m) {
+                    merged.push_back(Merged{batches, batch.index, c, rings[c].front().sub_acquisition});
+                    rings[c].pop_front();
+                }
+            }
+            ++batches;
+            continue;
+        }
+        Clock::time_point wake = std::min(next_delivery, batch.deadline);
+        if (wake == Clock::time_point::max()) {
+            break;
+        }
+        now = std::max(now, wake);
+    }
+    return merged;
+}
+
+void test_jittered_skewed_arrivals() {
+    const uint64_t pper_ps = 200000000000ULL;  // 200 ms
+    const auto period = std::chrono::milliseconds(200);
+    const size_t channels = 3;
+    const uint64_t sub_acquisitions = 2000;
+    const std::chrono::milliseconds skew[channels] = {std::chrono::milliseconds(0), std::chrono::milliseconds(30),
+                                                      std::chrono::milliseconds(-15)};
+
+    std::mt19937_64 rng(12345);
+    std::uniform_int_distribution<int> jitter_us(-10000, 10000);
+    std::bernoulli_distribution silent(0.05);
+
+    std::vector<std::vector<Message>> deliveries(channels);
+    const Clock::time_point start = Clock::time_point() + std::chrono::hours(1);
+    for (uint64_t k = 0; k < sub_acquisitions; ++k) {
+        // Network latency steps up by 40 ms a third of the way in and back down by 60 ms later;
+        // the host clock runs 100 ppm fast against the Time Controller
+        auto latency = std::chrono::milliseconds(5);
+        if (k >= sub_acquisitions / 3) {
+            latency += std::chrono::milliseconds(40);
+        }
+        if (k >= 2 * sub_acquisitions / 3) {
+            latency -= std::chrono::milliseconds(60);
+        }
+        auto drift = std::chrono::microseconds(static_cast<int64_t>(k * 200000 * 100e-6));
+        // Every channel is silent for a stretch of sub-acquisitions
+        bool all_silent = k >= 500 && k < 504;
+        for (size_t c = 0; c < channels; ++c) {
+            if (k == 0 || (!all_silent && !silent(rng))) {
+                deliveries[c].push_back(Message{start + period * k + latency + drift + skew[c] +
+                                                std::chrono::microseconds(jitter_us(rng)), k});
+            }
+        }
+    }
+
+    size_t misplaced = 0;
+    std::vector<Merged> merged = replay(deliveries, pper_ps, misplaced);
+
+    size_t expected_count = 0;
+    for (const auto& channel : deliveries) {
+        expected_count += channel.size();
+    }
+    check(merged.size() == expected_count, "every message is merged once");
+    size_t wrong = 0;
+    for (const Merged& m : merged) {
+        if (m.index != m.sub_acquisition) {
+            if (wrong++ < 5) {
+                std::cerr << "  channel " << m.channel << ": sub-acquisition " << m.sub_acquisition
+                          << " merged at offset index " << m.index << std::endl;
+            }
+        }
+    }
+    check(wrong == 0, "every message is merged at its sub-acquisition's offset");
+    check(misplaced == 0, "no head is reported outside its slot");
+}
+
+void test_late_message_does_not_shift_channel() {
+    const uint64_t pper_ps = 200000000000ULL;
+    const auto period = std::chrono::milliseconds(200);
+    const Clock::time_point start = Clock::time_point() + std::chrono::hours(1);
+
+    // Channel 1's message for sub-acquisition 1 is held up past the window and arrives just before
+    // its message for sub-acquisition 2
+    std::vector<std::vector<Message>> deliveries(2);
+    for (uint64_t k = 0; k < 4; ++k) {
+        deliveries[0].push_back(Message{start + period * k, k});
+    }
+    deliveries[1].push_back(Message{start, 0});
+    deliveries[1].push_back(Message{start + period * 2 - std::chrono::milliseconds(5), 1});
+    deliveries[1].push_back(Message{start + period * 2, 2});
+    deliveries[1].push_back(Message{start + period * 3, 3});
+
+    size_t misplaced = 0;
+    std::vector<Merged> merged = replay(deliveries, pper_ps, misplaced);
+
+    // The held-up message takes slot 2, so channel 1's own message for 2 is stale: it is reported
+    // and merged with the following one; sub-acquisition 3 is back in its slot on both channels
+    check(merged.size() == 8, "late message: every message is merged once");
+    check(misplaced == 1, "late message: the stale head is reported outside its slot");
+    std::vector<size_t> last_batch(2, 0);
+    std::vector<uint64_t> last_index(2, 0);
+    std::vector<bool> seen(2, false);
+    bool increasing = true;
+    for (const Merged& m : merged) {
+        if (m.sub_acquisition == 3) {
+            check(m.index == 3, "late message: channel " + std::to_string(m.channel) + " recovers its slot");
+        }
+        if (seen[m.channel] && m.batch != last_batch[m.channel] && m.index <= last_index[m.channel]) {
+            increasing = false;
+        }
+        seen[m.channel] = true;
+        last_batch[m.channel] = m.batch;
+        last_index[m.channel] = m.index;
+    }
+    check(increasing, "late message: each channel's batch indices strictly increase");
+}
+
+} // namespace
+
+int main() {
+    test_jittered_skewed_arrivals();
+    test_late_message_does_not_shift_channel();
+    if (failures > 0) {
+        std::cerr << failures << " check(s) failed" << std::endl;
+        return 1;
+    }
+    std::cout << "sub_acquisition_index_test: all checks passed" << std::endl;
+    return 0;
+}
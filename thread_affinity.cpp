@@ -0,0 +1,170 @@
+#include "thread_affinity.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace {
+
+// "0-3,8" -> {0, 1, 2, 3, 8}
+std::vector<int> parse_ranges(const std::string& list) {
+    std::vector<int> cpus;
+    std::stringstream ss(list);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        item.erase(std::remove_if(item.begin(), item.end(), ::isspace), item.end());
+        if (item.empty()) {
+            continue;
+        }
+        size_t dash = item.find('-');
+        try {
+            int first = std::stoi(item.substr(0, dash));
+            int last = dash == std::string::npos ? first : std::stoi(item.substr(dash + 1));
+            if (first < 0 || last < first) {
+                throw std::invalid_argument(item);
+            }
+            for (int cpu = first; cpu <= last; ++cpu) {
+                cpus.push_back(cpu);
+            }
+        } catch (const std::logic_error&) {
+            throw std::runtime_error("Invalid CPU list \"" + list + "\"");
+        }
+    }
+    std::sort(cpus.begin(), cpus.end());
+    cpus.erase(std::unique(cpus.begin(), cpus.end()), cpus.end());
+    return cpus;
+}
+
+// {0, 1, 2, 3, 8} -> "0-3,8"
+std::string format_ranges(const std::vector<int>& cpus) {
+    std::ostringstream oss;
+    for (size_t i = 0; i < cpus.size();) {
+        size_t j = i;
+        while (j + 1 < cpus.size() && cpus[j + 1] == cpus[j] + 1) {
+            ++j;
+        }
+        oss << (i > 0 ? "," : "") << cpus[i];
+        if (j > i) {
+            oss << "-" << cpus[j];
+        }
+        i = j + 1;
+    }
+    return oss.str();
+}
+
+const char* const NUMA_NODES_DIR = "/sys/devices/system/node";
+
+std::string read_node_cpulist(int node) {
+    std::ifstream in(std::string(NUMA_NODES_DIR) + "/node" + std::to_string(node) + "/cpulist");
+    std::string list;
+    if (!in || !std::getline(in, list)) {
+        throw std::runtime_error("Unknown NUMA node " + std::to_string(node));
+    }
+    return list;
+}
+
+} // namespace
+
+std::string ThreadPlacement::describe() const {
+    std::string text = cpus.empty() ? "any CPU" : (cpus.size() == 1 ? "CPU " : "CPUs ") + format_ranges(cpus);
+    if (fifo_priority > 0) {
+        text += ", SCHED_FIFO " + std::to_string(fifo_priority);
+    }
+    return text;
+}
+
+std::vector<int> parse_cpu_list(const std::string& spec) {
+    if (spec.compare(0, 5, "node:") == 0) {
+        int node;
+        try {
+            node = std::stoi(spec.substr(5));
+        } catch (const std::logic_error&) {
+            throw std::runtime_error("Invalid NUMA node in \"" + spec + "\"");
+        }
+        return parse_ranges(read_node_cpulist(node));
+    }
+    std::vector<int> cpus = parse_ranges(spec);
+    if (cpus.empty()) {
+        throw std::runtime_error("Empty CPU list \"" + spec + "\"");
+    }
+    return cpus;
+}
+
+bool apply_thread_placement(const ThreadPlacement& placement, const std::string& name) {
+#ifdef __linux__
+    // Thread names are limited to 15 characters
+    pthread_setname_np(pthread_self(), name.substr(0, 15).c_str());
+    if (placement.empty()) {
+        return true;
+    }
+    bool ok = true;
+    if (!placement.cpus.empty()) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (int cpu : placement.cpus) {
+            if (cpu < CPU_SETSIZE) {
+                CPU_SET(cpu, &set);
+            }
+        }
+        int rc = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+        if (rc != 0) {
+            std::cerr << "[" << name << "] cannot pin to " << placement.describe() << ": " << std::strerror(rc) << std::endl;
+            ok = false;
+        }
+    }
+    if (placement.fifo_priority > 0) {
+        sched_param param{};
+        param.sched_priority = placement.fifo_priority;
+        int rc = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+        if (rc != 0) {
+            std::cerr << "[" << name << "] cannot use SCHED_FIFO " << placement.fifo_priority << ": " << std::strerror(rc)
+                      << " (needs CAP_SYS_NICE or an rtprio limit)" << std::endl;
+            ok = false;
+        }
+    }
+    if (ok) {
+        std::cerr << "[" << name << "] running on " << placement.describe() << std::endl;
+    }
+    return ok;
+#else
+    (void)name;
+    if (!placement.empty()) {
+        std::cerr << "Thread placement is only supported on Linux; ignoring " << placement.describe() << std::endl;
+    }
+    return placement.empty();
+#endif
+}
+
+std::string describe_cpu_topology() {
+    std::ostringstream oss;
+    oss << std::thread::hardware_concurrency() << " CPUs online";
+    std::vector<int> nodes;
+    std::error_code ec;
+    for (const auto& entry : std::filesystem::directory_iterator(NUMA_NODES_DIR, ec)) {
+        std::string name = entry.path().filename().string();
+        if (name.compare(0, 4, "node") == 0 && name.size() > 4 &&
+            std::all_of(name.begin() + 4, name.end(), ::isdigit)) {
+            nodes.push_back(std::stoi(name.substr(4)));
+        }
+    }
+    std::sort(nodes.begin(), nodes.end());
+    for (int node : nodes) {
+        try {
+            std::string cpus = read_node_cpulist(node);
+            oss << ", NUMA node " << node << ": CPUs " << cpus;
+        } catch (const std::exception&) {
+            // Node without a CPU list (e.g. memory-only); nothing to report
+        }
+    }
+    return oss.str();
+}
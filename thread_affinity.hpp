@@ -0,0 +1,35 @@
+#ifndef THREAD_AFFINITY_HPP
+#define THREAD_AFFINITY_HPP
+
+#include <string>
+#include <vector>
+
+// Where a latency-sensitive thread runs: the CPUs it may use and, optionally, a SCHED_FIFO
+// real-time priority. Receivers, the merger and the streams' ZeroMQ I/O thread can each be given
+// one, so they neither migrate between cores nor get preempted by the controllers' other threads.
+struct ThreadPlacement {
+    std::vector<int> cpus;   // empty: any CPU
+    int fifo_priority = 0;   // 1-99: SCHED_FIFO with this priority; 0: normal scheduling
+
+    bool empty() const { return cpus.empty() && fifo_priority == 0; }
+    bool operator==(const ThreadPlacement& other) const {
+        return cpus == other.cpus && fifo_priority == other.fifo_priority;
+    }
+    bool operator!=(const ThreadPlacement& other) const { return !(*this == other); }
+
+    // e.g. "CPUs 2-3, SCHED_FIFO 50" or "any CPU"
+    std::string describe() const;
+};
+
+// Parse a CPU list such as "2", "2,3,8-11" or "node:1" (the CPUs of NUMA node 1).
+// Throws std::runtime_error on a malformed list or an unknown NUMA node.
+std::vector<int> parse_cpu_list(const std::string& spec);
+
+// Apply `placement` to the calling thread and name it `name` (shown by top/ps). Failures, e.g.
+// missing permission for SCHED_FIFO, are logged and leave the thread as it was; returns false then.
+bool apply_thread_placement(const ThreadPlacement& placement, const std::string& name);
+
+// One-line summary of the machine: online CPUs and the CPUs of each NUMA node
+std::string describe_cpu_topology();
+
+#endif // THREAD_AFFINITY_HPP
@@ -0,0 +1,457 @@
+#include "timestamp_codec.hpp"
+#include "timestamp_file.hpp"
+#include "timestamp_file_view.hpp"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+// TT_CODEC_NO_SIMD selects the portable vertical packers on SSE2 targets as well (both produce the
+// same layout; the scalar build of timestamp_codec_test uses it)
+#if defined(__SSE2__) && !defined(TT_CODEC_NO_SIMD)
+#define TT_CODEC_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+constexpr size_t kBlock = COMPRESSED_BLOCK_RECORDS;
+static_assert(kBlock == 128, "the vertical bit-packing layout assumes 4 lanes x 32 values");
+
+unsigned bits_needed(uint64_t value) {
+    unsigned bits = 0;
+    while (value != 0) {
+        ++bits;
+        value >>= 1;
+    }
+    return bits;
+}
+
+uint64_t zigzag(int64_t value) {
+    return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+int64_t unzigzag(uint64_t value) {
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+void put_varint(std::vector<uint8_t>& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+uint64_t get_varint(const uint8_t*& p, const uint8_t* end) {
+    uint64_t value = 0;
+    for (unsigned shift = 0; shift < 64; shift += 7) {
+        if (p == end) {
+            throw std::runtime_error("Truncated compressed timestamp block");
+        }
+        uint8_t byte = *p++;
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            return value;
+        }
+    }
+    throw std::runtime_error("Corrupt varint in compressed timestamp block");
+}
+
+// --- Vertical bit-packing of 128 32-bit values ---
+// Value j goes to lane j % 4; each lane packs its 32 values into `bits` 32-bit words, and the
+// words of the four lanes are interleaved (word w of lane l at out[4 * w + l]). One 128-bit SIMD
+// register then holds the same word of all four lanes, so packing is a shift/or per 4 values.
+// Packed size: 16 * bits bytes.
+
+#if defined(TT_CODEC_SSE2)
+void pack_vertical(const uint32_t* in, unsigned bits, uint32_t* out) {
+    if (bits == 0) {
+        return;
+    }
+    if (bits == 32) {
+        std::memcpy(out, in, kBlock * sizeof(uint32_t));
+        return;
+    }
+    const __m128i* src = reinterpret_cast<const __m128i*>(in);
+    __m128i* dst = reinterpret_cast<__m128i*>(out);
+    __m128i acc = _mm_setzero_si128();
+    unsigned filled = 0;
+    for (unsigned p = 0; p < 32; ++p) {
+        __m128i v = _mm_loadu_si128(src + p);
+        acc = _mm_or_si128(acc, _mm_sll_epi32(v, _mm_cvtsi32_si128(static_cast<int>(filled))));
+        filled += bits;
+        if (filled >= 32) {
+            _mm_storeu_si128(dst++, acc);
+            filled -= 32;
+            // High bits of v that did not fit start the next word
+            acc = filled > 0 ? _mm_srl_epi32(v, _mm_cvtsi32_si128(static_cast<int>(bits - filled)))
+                             : _mm_setzero_si128();
+        }
+    }
+}
+
+void unpack_vertical(const uint32_t* in, unsigned bits, uint32_t* out) {
+    __m128i* dst = reinterpret_cast<__m128i*>(out);
+    if (bits == 0) {
+        std::memset(out, 0, kBlock * sizeof(uint32_t));
+        return;
+    }
+    if (bits == 32) {
+        std::memcpy(out, in, kBlock * sizeof(uint32_t));
+        return;
+    }
+    const __m128i* src = reinterpret_cast<const __m128i*>(in);
+    const __m128i mask = _mm_set1_epi32(static_cast<int>((1u << bits) - 1));
+    __m128i current = _mm_loadu_si128(src++);
+    unsigned used = 0;
+    for (unsigned p = 0; p < 32; ++p) {
+        __m128i v;
+        if (used + bits <= 32) {
+            v = _mm_srl_epi32(current, _mm_cvtsi32_si128(static_cast<int>(used)));
+            used += bits;
+            if (used == 32 && p < 31) {
+                current = _mm_loadu_si128(src++);
+                used = 0;
+            }
+        } else {
+            // The value straddles two words
+            __m128i next = _mm_loadu_si128(src++);
+            v = _mm_or_si128(_mm_srl_epi32(current, _mm_cvtsi32_si128(static_cast<int>(used))),
+                             _mm_sll_epi32(next, _mm_cvtsi32_si128(static_cast<int>(32 - used))));
+            used = used + bits - 32;
+            current = next;
+        }
+        _mm_storeu_si128(dst + p, _mm_and_si128(v, mask));
+    }
+}
+#else
+void pack_vertical(const uint32_t* in, unsigned bits, uint32_t* out) {
+    for (unsigned lane = 0; lane < 4; ++lane) {
+        uint64_t acc = 0;
+        unsigned filled = 0;
+        size_t word = 0;
+        for (unsigned p = 0; p < 32; ++p) {
+            acc |= static_cast<uint64_t>(in[4 * p + lane]) << filled;
+            filled += bits;
+            if (filled >= 32) {
+                out[4 * word + lane] = static_cast<uint32_t>(acc);
+                ++word;
+                acc >>= 32;
+                filled -= 32;
+            }
+        }
+    }
+}
+
+void unpack_vertical(const uint32_t* in, unsigned bits, uint32_t* out) {
+    const uint64_t mask = bits == 32 ? 0xFFFFFFFFull : ((uint64_t(1) << bits) - 1);
+    for (unsigned lane = 0; lane < 4; ++lane) {
+        uint64_t acc = 0;
+        unsigned available = 0;
+        size_t word = 0;
+        for (unsigned p = 0; p < 32; ++p) {
+            if (available < bits) {
+                acc |= static_cast<uint64_t>(in[4 * word + lane]) << available;
+                ++word;
+                available += 32;
+            }
+            out[4 * p + lane] = static_cast<uint32_t>(acc & mask);
+            acc >>= bits;
+            available -= bits;
+        }
+    }
+}
+#endif
+
+// Horizontal bit-packing of `count` values (bits <= 32), LSB first
+void pack_horizontal(const uint32_t* in, size_t count, unsigned bits, std::vector<uint8_t>& out) {
+    uint64_t acc = 0;
+    unsigned filled = 0;
+    for (size_t i = 0; i < count; ++i) {
+        acc |= static_cast<uint64_t>(in[i]) << filled;
+        filled += bits;
+        while (filled >= 8) {
+            out.push_back(static_cast<uint8_t>(acc));
+            acc >>= 8;
+            filled -= 8;
+        }
+    }
+    if (filled > 0) {
+        out.push_back(static_cast<uint8_t>(acc));
+    }
+}
+
+void unpack_horizontal(const uint8_t* in, size_t count, unsigned bits, uint32_t* out) {
+    const uint64_t mask = bits == 32 ? 0xFFFFFFFFull : ((uint64_t(1) << bits) - 1);
+    uint64_t acc = 0;
+    unsigned available = 0;
+    for (size_t i = 0; i < count; ++i) {
+        while (available < bits) {
+            acc |= static_cast<uint64_t>(*in++) << available;
+            available += 8;
+        }
+        out[i] = static_cast<uint32_t>(acc & mask);
+        acc >>= bits;
+        available -= bits;
+    }
+}
+
+size_t horizontal_bytes(size_t count, unsigned bits) {
+    return (count * bits + 7) / 8;
+}
+
+} // namespace
+
+size_t encode_timestamp_block(const uint64_t* timestamps, const int32_t* channels, size_t count,
+                              std::vector<uint8_t>& out) {
+    if (count == 0 || count > kBlock) {
+        throw std::invalid_argument("Invalid compressed block size");
+    }
+    const size_t start = out.size();
+    CompressedBlockHeader header{};
+    header.record_count = static_cast<uint16_t>(count);
+    header.first_timestamp = timestamps[0];
+    out.resize(start + sizeof(header));
+
+    // Timestamps: deltas relative to the previous record, minus the smallest delta of the block
+    uint64_t deltas[kBlock] = {};
+    bool sorted = true;
+    for (size_t i = 1; i < count; ++i) {
+        if (timestamps[i] < timestamps[i - 1]) {
+            sorted = false;
+        }
+    }
+    uint64_t base = UINT64_MAX;
+    for (size_t i = 1; i < count; ++i) {
+        deltas[i] = sorted ? timestamps[i] - timestamps[i - 1]
+                           : zigzag(static_cast<int64_t>(timestamps[i] - timestamps[i - 1]));
+        base = std::min(base, deltas[i]);
+    }
+    if (count == 1) {
+        base = 0;
+    }
+    uint64_t largest = 0;
+    for (size_t i = 1; i < count; ++i) {
+        deltas[i] -= base;
+        largest = std::max(largest, deltas[i]);
+    }
+    header.delta_base = base;
+    header.delta_mode = sorted ? 0 : DELTA_ZIGZAG;
+    header.delta_bits = static_cast<uint8_t>(bits_needed(largest));
+    if (header.delta_bits <= 32) {
+        uint32_t narrow[kBlock] = {};
+        for (size_t i = 1; i < count; ++i) {
+            narrow[i] = static_cast<uint32_t>(deltas[i]);
+        }
+        size_t offset = out.size();
+        out.resize(offset + 16 * header.delta_bits);
+        uint32_t packed[kBlock];
+        pack_vertical(narrow, header.delta_bits, packed);
+        std::memcpy(out.data() + offset, packed, 16 * header.delta_bits);
+    } else {
+        header.delta_mode |= DELTA_VARINT;
+        for (size_t i = 1; i < count; ++i) {
+            put_varint(out, deltas[i]);
+        }
+    }
+
+    // Channels: offsets from the smallest channel, bit-packed or run-length coded
+    int32_t low = channels[0];
+    int32_t high = channels[0];
+    size_t runs = 1;
+    for (size_t i = 1; i < count; ++i) {
+        low = std::min(low, channels[i]);
+        high = std::max(high, channels[i]);
+        runs += channels[i] != channels[i - 1];
+    }
+    header.channel_base = low;
+    header.channel_bits = static_cast<uint8_t>(bits_needed(static_cast<uint64_t>(static_cast<int64_t>(high) - low)));
+    uint32_t offsets[kBlock];
+    for (size_t i = 0; i < count; ++i) {
+        offsets[i] = static_cast<uint32_t>(static_cast<int64_t>(channels[i]) - low);
+    }
+    // A (value, length) pair costs at least two bytes
+    if (2 * runs < horizontal_bytes(count, header.channel_bits)) {
+        header.channel_mode = CHANNEL_RLE;
+        for (size_t i = 0; i < count;) {
+            size_t j = i + 1;
+            while (j < count && offsets[j] == offsets[i]) {
+                ++j;
+            }
+            put_varint(out, offsets[i]);
+            put_varint(out, j - i);
+            i = j;
+        }
+    } else {
+        header.channel_mode = CHANNEL_PACKED;
+        pack_horizontal(offsets, count, header.channel_bits, out);
+    }
+
+    header.payload_size = static_cast<uint32_t>(out.size() - start - sizeof(header));
+    std::memcpy(out.data() + start, &header, sizeof(header));
+    return out.size() - start;
+}
+
+size_t decode_timestamp_block(const uint8_t* data, size_t size, uint64_t* timestamps, int32_t* channels,
+                              size_t& count) {
+    CompressedBlockHeader header;
+    if (size < sizeof(header)) {
+        throw std::runtime_error("Truncated compressed timestamp block");
+    }
+    std::memcpy(&header, data, sizeof(header));
+    count = header.record_count;
+    if (count == 0 || count > kBlock || header.payload_size > size - sizeof(header) ||
+        header.channel_bits > 32 || header.delta_bits > 64) {
+        throw std::runtime_error("Corrupt compressed timestamp block");
+    }
+    const uint8_t* p = data + sizeof(header);
+    const uint8_t* end = p + header.payload_size;
+
+    uint64_t deltas[kBlock] = {};
+    if (header.delta_mode & DELTA_VARINT) {
+        for (size_t i = 1; i < count; ++i) {
+            deltas[i] = get_varint(p, end);
+        }
+    } else {
+        if (header.delta_bits > 32 || static_cast<size_t>(end - p) < 16u * header.delta_bits) {
+            throw std::runtime_error("Corrupt compressed timestamp block");
+        }
+        uint32_t packed[kBlock];
+        uint32_t narrow[kBlock];
+        std::memcpy(packed, p, 16 * header.delta_bits);
+        unpack_vertical(packed, header.delta_bits, narrow);
+        for (size_t i = 1; i < count; ++i) {
+            deltas[i] = narrow[i];
+        }
+        p += 16 * header.delta_bits;
+    }
+    timestamps[0] = header.first_timestamp;
+    for (size_t i = 1; i < count; ++i) {
+        uint64_t delta = deltas[i] + header.delta_base;
+        timestamps[i] = (header.delta_mode & DELTA_ZIGZAG)
+            ? timestamps[i - 1] + static_cast<uint64_t>(unzigzag(delta))
+            : timestamps[i - 1] + delta;
+    }
+
+    uint32_t offsets[kBlock];
+    if (header.channel_mode == CHANNEL_RLE) {
+        size_t i = 0;
+        while (i < count) {
+            uint64_t value = get_varint(p, end);
+            uint64_t length = get_varint(p, end);
+            if (length == 0 || length > count - i) {
+                throw std::runtime_error("Corrupt compressed timestamp block");
+            }
+            std::fill(offsets + i, offsets + i + length, static_cast<uint32_t>(value));
+            i += length;
+        }
+    } else {
+        if (static_cast<size_t>(end - p) < horizontal_bytes(count, header.channel_bits)) {
+            throw std::runtime_error("Corrupt compressed timestamp block");
+        }
+        unpack_horizontal(p, count, header.channel_bits, offsets);
+    }
+    for (size_t i = 0; i < count; ++i) {
+        channels[i] = static_cast<int32_t>(static_cast<int64_t>(header.channel_base) + offsets[i]);
+    }
+    return sizeof(header) + header.payload_size;
+}
+
+CompressedRecordWriter::CompressedRecordWriter(const std::string& path)
+    : file(path), staged(0), total_records(0), total_blocks(0)
+{
+    // Placeholder header; counts are patched in close()
+    CompressedFileHeader header{COMPRESSED_FILE_MAGIC, COMPRESSED_FILE_VERSION, sizeof(CompressedFileHeader), 0, 0, 0};
+    file.write(&header, sizeof(header));
+    encoded.reserve(sizeof(CompressedBlockHeader) + kBlock * 12);
+}
+
+CompressedRecordWriter::~CompressedRecordWriter() {
+    try {
+        close();
+    } catch (...) {
+        // Destructors must not throw; an explicit close() reports errors
+    }
+}
+
+void CompressedRecordWriter::flush_block() {
+    if (staged == 0) {
+        return;
+    }
+    encoded.clear();
+    encode_timestamp_block(timestamps, channels, staged, encoded);
+    file.write(encoded.data(), encoded.size());
+    total_records += staged;
+    ++total_blocks;
+    staged = 0;
+}
+
+void CompressedRecordWriter::close() {
+    if (!file.is_open()) {
+        return;
+    }
+    flush_block();
+    CompressedFileHeader header{COMPRESSED_FILE_MAGIC, COMPRESSED_FILE_VERSION, sizeof(CompressedFileHeader),
+                                total_records, total_blocks, 0};
+    file.write_at(0, &header, sizeof(header));
+    file.close();
+}
+
+CompressedRecordReader::CompressedRecordReader(const std::string& path)
+    : file(path, std::ios::binary)
+{
+    if (!file) {
+        throw std::runtime_error("Cannot open compressed timestamp file: " + path);
+    }
+    if (!file.read(reinterpret_cast<char*>(&file_header), sizeof(file_header)) ||
+        file_header.magic != COMPRESSED_FILE_MAGIC) {
+        throw std::runtime_error("Not a compressed timestamp file: " + path);
+    }
+    if (file_header.version > COMPRESSED_FILE_VERSION) {
+        throw std::runtime_error("Unsupported compressed timestamp file version " + std::to_string(file_header.version));
+    }
+    file.seekg(file_header.header_size);
+}
+
+bool CompressedRecordReader::read_block(std::vector<uint64_t>& timestamps, std::vector<int32_t>& channels) {
+    CompressedBlockHeader block;
+    if (!file.read(reinterpret_cast<char*>(&block), sizeof(block))) {
+        return false;
+    }
+    buffer.resize(sizeof(block) + block.payload_size);
+    std::memcpy(buffer.data(), &block, sizeof(block));
+    if (!file.read(reinterpret_cast<char*>(buffer.data() + sizeof(block)), block.payload_size)) {
+        throw std::runtime_error("Truncated compressed timestamp file");
+    }
+    timestamps.resize(kBlock);
+    channels.resize(kBlock);
+    size_t count = 0;
+    decode_timestamp_block(buffer.data(), buffer.size(), timestamps.data(), channels.data(), count);
+    timestamps.resize(count);
+    channels.resize(count);
+    return true;
+}
+
+uint64_t compress_record_file(const std::string& bin_path, const std::string& tsc_path) {
+    TimestampFileView view(bin_path);
+    CompressedRecordWriter writer(tsc_path);
+    for (size_t i = 0; i < view.size(); ++i) {
+        writer.append(view.timestamp(i), view.channel(i));
+    }
+    writer.close();
+    return writer.record_count();
+}
+
+uint64_t decompress_record_file(const std::string& tsc_path, const std::string& bin_path) {
+    CompressedRecordReader reader(tsc_path);
+    TimestampRecordWriter writer(bin_path);
+    std::vector<uint64_t> timestamps;
+    std::vector<int32_t> channels;
+    while (reader.read_block(timestamps, channels)) {
+        for (size_t i = 0; i < timestamps.size(); ++i) {
+            writer.append(timestamps[i], channels[i]);
+        }
+    }
+    writer.close();
+    return writer.record_count();
+}
@@ -0,0 +1,124 @@
+#ifndef TIMESTAMP_CODEC_HPP
+#define TIMESTAMP_CODEC_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "async_file_writer.hpp"
+
+// Compressed record format (".tsc" files), little-endian:
+//
+//   CompressedFileHeader
+//   repeated blocks of up to COMPRESSED_BLOCK_RECORDS records:
+//     CompressedBlockHeader
+//     delta payload     timestamp deltas minus the block's smallest delta; 128 values bit-packed
+//                       with delta_bits each (4-lane vertical layout, SIMD friendly), or LEB128
+//                       varints when a delta does not fit in 32 bits
+//     channel payload   channel minus channel_base, bit-packed with channel_bits each, or
+//                       (value, run length) varint pairs when that is smaller
+//
+// Sorted picosecond timestamps have small, similar deltas, so a block of 128 12-byte records
+// (1536 bytes) typically shrinks to a few hundred bytes. Unsorted input is still encoded
+// losslessly (zigzag deltas), just less compactly.
+
+constexpr uint32_t COMPRESSED_FILE_MAGIC = 0x5A435454;  // "TTCZ"
+constexpr uint16_t COMPRESSED_FILE_VERSION = 1;
+constexpr size_t COMPRESSED_BLOCK_RECORDS = 128;
+
+#pragma pack(push, 1)
+struct CompressedFileHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t header_size;       // sizeof(CompressedFileHeader), for forward compatibility
+    uint64_t record_count;      // total records in the file
+    uint64_t block_count;
+    uint64_t reserved;
+};
+
+struct CompressedBlockHeader {
+    uint16_t record_count;
+    uint8_t delta_mode;         // DELTA_* flags
+    uint8_t delta_bits;
+    uint8_t channel_mode;       // CHANNEL_*
+    uint8_t channel_bits;
+    uint16_t reserved;
+    int32_t channel_base;
+    uint32_t payload_size;      // delta + channel payload bytes following this header
+    uint64_t first_timestamp;
+    uint64_t delta_base;        // subtracted from every delta before packing
+};
+#pragma pack(pop)
+
+static_assert(sizeof(CompressedFileHeader) == 32, "CompressedFileHeader layout");
+static_assert(sizeof(CompressedBlockHeader) == 32, "CompressedBlockHeader layout");
+
+constexpr uint8_t DELTA_VARINT = 1 << 0;   // varints instead of bit-packing
+constexpr uint8_t DELTA_ZIGZAG = 1 << 1;   // deltas are zigzag-encoded (input not sorted)
+constexpr uint8_t CHANNEL_PACKED = 0;
+constexpr uint8_t CHANNEL_RLE = 1;
+
+// Encode up to COMPRESSED_BLOCK_RECORDS records as one block (header + payload) appended to `out`.
+// Returns the encoded size.
+size_t encode_timestamp_block(const uint64_t* timestamps, const int32_t* channels, size_t count,
+                              std::vector<uint8_t>& out);
+
+// Decode one block from `data` into `timestamps`/`channels` (room for COMPRESSED_BLOCK_RECORDS
+// each). Returns the bytes consumed and sets `count`; throws std::runtime_error on corrupt input.
+size_t decode_timestamp_block(const uint8_t* data, size_t size, uint64_t* timestamps, int32_t* channels,
+                              size_t& count);
+
+// Streams records into a .tsc file
+class CompressedRecordWriter {
+public:
+    explicit CompressedRecordWriter(const std::string& path);
+    ~CompressedRecordWriter();
+
+    void append(uint64_t timestamp, int channel) {
+        timestamps[staged] = timestamp;
+        channels[staged] = channel;
+        if (++staged == COMPRESSED_BLOCK_RECORDS) {
+            flush_block();
+        }
+    }
+
+    // Encode the last block and patch the file header
+    void close();
+
+    uint64_t record_count() const { return total_records; }
+    uint64_t bytes_written() const { return file.bytes_written(); }
+
+private:
+    void flush_block();
+
+    AsyncFileWriter file;
+    uint64_t timestamps[COMPRESSED_BLOCK_RECORDS];
+    int32_t channels[COMPRESSED_BLOCK_RECORDS];
+    size_t staged;
+    std::vector<uint8_t> encoded;
+    uint64_t total_records;
+    uint64_t total_blocks;
+};
+
+// Sequential reader for .tsc files
+class CompressedRecordReader {
+public:
+    explicit CompressedRecordReader(const std::string& path);
+
+    // Read the next block (replacing the contents of the vectors); returns false at end of file
+    bool read_block(std::vector<uint64_t>& timestamps, std::vector<int32_t>& channels);
+
+    const CompressedFileHeader& header() const { return file_header; }
+
+private:
+    std::ifstream file;
+    CompressedFileHeader file_header;
+    std::vector<uint8_t> buffer;
+};
+
+// Convert between the 12-byte record .bin layout and .tsc. Both return the number of records.
+uint64_t compress_record_file(const std::string& bin_path, const std::string& tsc_path);
+uint64_t decompress_record_file(const std::string& tsc_path, const std::string& bin_path);
+
+#endif // TIMESTAMP_CODEC_HPP
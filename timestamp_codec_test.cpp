@@ -0,0 +1,270 @@
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include <unistd.h>
+#include "timestamp_codec.hpp"
+#include "timestamp_file.hpp"
+#include "timestamp_file_view.hpp"
+
+// Round-trips records through the compressed timestamp format, one case per delta and channel
+// mode, and through compress_record_file/decompress_record_file. Built twice: with the SSE2
+// packers (where available) and with TT_CODEC_NO_SIMD; the encoded bytes of a fixed input are
+// checked against the same digest in both builds, so the two packers stay interchangeable.
+
+namespace fs = std::filesystem;
+
+namespace {
+
+int failures = 0;
+
+// FNV-1a of the encoding of sorted_records(1000, 1 << 20, 8, 11)
+constexpr uint64_t EXPECTED_DIGEST = 0xf5f51797b631c8c8ULL;
+
+void check(bool condition, const std::string& what) {
+    if (!condition) {
+        std::cerr << "FAIL: " << what << std::endl;
+        ++failures;
+    }
+}
+
+struct Records {
+    std::vector<uint64_t> timestamps;
+    std::vector<int32_t> channels;
+};
+
+// Encode in blocks of up to COMPRESSED_BLOCK_RECORDS, decode, and compare; returns the encoding
+std::vector<uint8_t> round_trip(const Records& records, const std::string& what) {
+    std::vector<uint8_t> encoded;
+    for (size_t start = 0; start < records.timestamps.size(); start += COMPRESSED_BLOCK_RECORDS) {
+        size_t count = std::min(COMPRESSED_BLOCK_RECORDS, records.timestamps.size() - start);
+        encode_timestamp_block(records.timestamps.data() + start, records.channels.data() + start, count, encoded);
+    }
+
+    Records decoded;
+    size_t offset = 0;
+    while (offset < encoded.size()) {
+        uint64_t timestamps[COMPRESSED_BLOCK_RECORDS];
+        int32_t channels[COMPRESSED_BLOCK_RECORDS];
+        size_t count = 0;
+        offset += decode_timestamp_block(encoded.data() + offset, encoded.size() - offset, timestamps, channels, count);
+        decoded.timestamps.insert(decoded.timestamps.end(), timestamps, timestamps + count);
+        decoded.channels.insert(decoded.channels.end(), channels, channels + count);
+    }
+    check(decoded.timestamps == records.timestamps, what + ": timestamps round-trip");
+    check(decoded.channels == records.channels, what + ": channels round-trip");
+    return encoded;
+}
+
+// Headers of the encoded blocks, in order
+std::vector<CompressedBlockHeader> block_headers(const std::vector<uint8_t>& encoded) {
+    std::vector<CompressedBlockHeader> headers;
+    size_t offset = 0;
+    while (offset + sizeof(CompressedBlockHeader) <= encoded.size()) {
+        CompressedBlockHeader header;
+        std::memcpy(&header, encoded.data() + offset, sizeof(header));
+        headers.push_back(header);
+        offset += sizeof(header) + header.payload_size;
+    }
+    return headers;
+}
+
+// Raw mt19937_64 output (unlike the <random> distributions, identical on every standard library)
+uint64_t next(std::mt19937_64& rng, uint64_t range) {
+    return rng() % range;
+}
+
+Records sorted_records(size_t count, uint64_t max_gap, int channels, uint64_t seed) {
+    std::mt19937_64 rng(seed);
+    Records records;
+    uint64_t t = 123456789;
+    for (size_t i = 0; i < count; ++i) {
+        t += next(rng, max_gap);
+        records.timestamps.push_back(t);
+        records.channels.push_back(1 + static_cast<int32_t>(next(rng, channels)));
+    }
+    return records;
+}
+
+uint64_t fnv1a(const std::vector<uint8_t>& bytes) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (uint8_t byte : bytes) {
+        hash = (hash ^ byte) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+void test_sorted() {
+    // 1000 records: seven full blocks and a partial one, every delta bit width up to 20
+    Records records = sorted_records(1000, 1000000, 8, 1);
+    std::vector<uint8_t> encoded = round_trip(records, "sorted");
+    for (const CompressedBlockHeader& header : block_headers(encoded)) {
+        check(header.delta_mode == 0, "sorted: bit-packed deltas");
+    }
+    check(encoded.size() < records.timestamps.size() * 12 / 2, "sorted: at least 2x smaller than records");
+
+    // Every delta bit width the packers handle, including 0 (constant rate) and 32
+    for (unsigned bits = 0; bits <= 32; ++bits) {
+        Records exact;
+        std::mt19937_64 rng(bits);
+        uint64_t t = 1000;
+        for (size_t i = 0; i < COMPRESSED_BLOCK_RECORDS; ++i) {
+            uint64_t extra = bits == 0 ? 0 : (i == 5 ? (uint64_t(1) << bits) - 1 : next(rng, uint64_t(1) << bits));
+            t += 7 + extra;
+            exact.timestamps.push_back(t);
+            exact.channels.push_back(3);
+        }
+        exact.timestamps[1] = exact.timestamps[0] + 7;  // smallest delta is the base, so offsets start at 0
+        round_trip(exact, "sorted, " + std::to_string(bits) + "-bit deltas");
+    }
+}
+
+void test_wide_gaps() {
+    // Gaps beyond 32 bits (idle periods of seconds at ps resolution) switch to varint deltas
+    Records records = sorted_records(300, 5000, 4, 2);
+    for (size_t i = 50; i < records.timestamps.size(); ++i) {
+        records.timestamps[i] += 10000000000000ULL;  // 10 s jump
+    }
+    for (size_t i = 200; i < records.timestamps.size(); ++i) {
+        records.timestamps[i] += uint64_t(1) << 40;
+    }
+    std::vector<uint8_t> encoded = round_trip(records, "gaps over 32 bits");
+    std::vector<CompressedBlockHeader> headers = block_headers(encoded);
+    check(headers.size() == 3, "gaps over 32 bits: three blocks");
+    check(headers.size() == 3 && (headers[0].delta_mode & DELTA_VARINT) && (headers[1].delta_mode & DELTA_VARINT),
+          "gaps over 32 bits: varint deltas");
+    check(headers.size() == 3 && !(headers[2].delta_mode & DELTA_VARINT), "gaps over 32 bits: packed again without a jump");
+}
+
+void test_unsorted() {
+    Records records = sorted_records(256, 100000, 8, 3);
+    std::mt19937_64 rng(4);
+    std::shuffle(records.timestamps.begin(), records.timestamps.begin() + 128, rng);
+    // Second block: locally out of order, with a jump back by more than 32 bits
+    std::swap(records.timestamps[130], records.timestamps[131]);
+    records.timestamps[200] -= uint64_t(1) << 36;
+    std::vector<uint8_t> encoded = round_trip(records, "unsorted");
+    std::vector<CompressedBlockHeader> headers = block_headers(encoded);
+    check(headers.size() == 2 && (headers[0].delta_mode & DELTA_ZIGZAG), "unsorted: zigzag deltas");
+    check(headers.size() == 2 && (headers[1].delta_mode & DELTA_ZIGZAG) && (headers[1].delta_mode & DELTA_VARINT),
+          "unsorted: zigzag varint deltas for a jump back over 32 bits");
+}
+
+void test_channels() {
+    // Negative and mixed channels in a bit-packed block
+    Records mixed = sorted_records(128, 1000, 8, 5);
+    std::mt19937_64 rng(6);
+    for (int32_t& channel : mixed.channels) {
+        channel = static_cast<int32_t>(next(rng, 2001)) - 1000;
+    }
+    const int32_t lowest = *std::min_element(mixed.channels.begin(), mixed.channels.end());
+    std::vector<uint8_t> encoded = round_trip(mixed, "negative and mixed channels");
+    std::vector<CompressedBlockHeader> headers = block_headers(encoded);
+    check(headers.size() == 1 && headers[0].channel_mode == CHANNEL_PACKED && headers[0].channel_base == lowest,
+          "negative and mixed channels: packed from the smallest channel");
+
+    // The full int32 range (32-bit channel offsets)
+    mixed.channels[17] = INT32_MIN;
+    mixed.channels[18] = INT32_MAX;
+    round_trip(mixed, "extreme channels");
+
+    // Long runs of one channel (one detector at a time) are run-length coded
+    Records runs = sorted_records(128, 1000, 8, 7);
+    for (size_t i = 0; i < runs.channels.size(); ++i) {
+        runs.channels[i] = i < 60 ? -2 : (i < 100 ? 5 : 6);
+    }
+    encoded = round_trip(runs, "channel runs");
+    headers = block_headers(encoded);
+    check(headers.size() == 1 && headers[0].channel_mode == CHANNEL_RLE, "channel runs: run-length coded");
+
+    // A single channel needs no channel bits at all
+    Records single = sorted_records(128, 1000, 1, 8);
+    round_trip(single, "single channel");
+}
+
+void test_tails() {
+    // A 1-record tail block, and a file of a single record
+    Records records = sorted_records(COMPRESSED_BLOCK_RECORDS + 1, 50000, 8, 9);
+    std::vector<uint8_t> encoded = round_trip(records, "1-record tail");
+    std::vector<CompressedBlockHeader> headers = block_headers(encoded);
+    check(headers.size() == 2 && headers[1].record_count == 1, "1-record tail: last block holds one record");
+
+    Records one = sorted_records(1, 50000, 8, 10);
+    round_trip(one, "single record");
+}
+
+void test_packers_agree() {
+    // Both builds (SSE2 and TT_CODEC_NO_SIMD) must produce exactly these bytes
+    Records records = sorted_records(1000, 1 << 20, 8, 11);
+    std::vector<uint8_t> encoded = round_trip(records, "digest input");
+    const uint64_t digest = fnv1a(encoded);
+    if (digest != EXPECTED_DIGEST) {
+        std::cerr << "  encoded digest " << std::hex << digest << std::dec << " (" << encoded.size() << " bytes)" << std::endl;
+    }
+    check(digest == EXPECTED_DIGEST, "encoded bytes match the reference digest");
+}
+
+void test_files() {
+    const fs::path dir = fs::temp_directory_path() / ("timestamp_codec_test_" + std::to_string(getpid()));
+    fs::create_directories(dir);
+    const std::string bin = (dir / "records.bin").string();
+    const std::string tsc = (dir / "records.tsc").string();
+    const std::string restored = (dir / "restored.bin").string();
+
+    Records records = sorted_records(10000, 200000, 8, 12);
+    std::vector<int> channels(records.channels.begin(), records.channels.end());
+    write_timestamp_records(bin, records.timestamps, channels);
+    check(compress_record_file(bin, tsc) == records.timestamps.size(), "file: every record compressed");
+    check(fs::file_size(tsc) < fs::file_size(bin), "file: compressed file is smaller");
+    {
+        CompressedRecordReader reader(tsc);
+        check(reader.header().record_count == records.timestamps.size(), "file: header record count");
+        check(reader.header().block_count == (records.timestamps.size() + COMPRESSED_BLOCK_RECORDS - 1) / COMPRESSED_BLOCK_RECORDS,
+              "file: header block count");
+    }
+    check(decompress_record_file(tsc, restored) == records.timestamps.size(), "file: every record restored");
+    check(fs::file_size(restored) == fs::file_size(bin), "file: restored size");
+    {
+        TimestampFileView original(bin);
+        TimestampFileView copy(restored);
+        bool same = original.size() == copy.size();
+        for (size_t i = 0; same && i < original.size(); ++i) {
+            same = original.timestamp(i) == copy.timestamp(i) && original.channel(i) == copy.channel(i);
+        }
+        check(same, "file: restored records match");
+    }
+
+    // An acquisition without events gives an empty file, which must survive the round trip too
+    const std::string empty_bin = (dir / "empty.bin").string();
+    const std::string empty_tsc = (dir / "empty.tsc").string();
+    const std::string empty_restored = (dir / "empty_restored.bin").string();
+    write_timestamp_records(empty_bin, {}, {});
+    check(compress_record_file(empty_bin, empty_tsc) == 0, "empty file: compressed");
+    check(decompress_record_file(empty_tsc, empty_restored) == 0, "empty file: restored");
+    check(fs::exists(empty_restored) && fs::file_size(empty_restored) == 0, "empty file: restored file is empty");
+
+    fs::remove_all(dir);
+}
+
+} // namespace
+
+int main() {
+    test_sorted();
+    test_wide_gaps();
+    test_unsorted();
+    test_channels();
+    test_tails();
+    test_packers_agree();
+    test_files();
+    if (failures > 0) {
+        std::cerr << failures << " check(s) failed" << std::endl;
+        return 1;
+    }
+    std::cout << "timestamp_codec_test: all checks passed" << std::endl;
+    return 0;
+}
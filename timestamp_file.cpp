@@ -0,0 +1,178 @@
+#include "timestamp_file.hpp"
+#include <stdexcept>
+#include <cstring>
+
+namespace {
+
+// Channel columns are padded so every block (and its timestamp column) stays 8-byte aligned
+size_t padded_channel_bytes(size_t count) {
+    return (count + 7) & ~static_cast<size_t>(7);
+}
+
+} // namespace
+
+MergedTimestampWriter::MergedTimestampWriter(const std::string& path, size_t block_capacity_)
+    : file(path), block_capacity(block_capacity_), sub_acquisition(0), total_records(0), total_blocks(0)
+{
+    timestamps.reserve(block_capacity);
+    channels.reserve(block_capacity);
+    // Placeholder header; counts are patched in close()
+    MergedFileHeader header{MERGED_FILE_MAGIC, MERGED_FILE_VERSION, sizeof(MergedFileHeader), 0, 0, 0};
+    file.write(&header, sizeof(header));
+}
+
+MergedTimestampWriter::~MergedTimestampWriter() {
+    try {
+        close();
+    } catch (...) {
+        // Destructors must not throw; an explicit close() reports errors
+    }
+}
+
+void MergedTimestampWriter::flush_block() {
+    if (timestamps.empty()) {
+        return;
+    }
+    MergedBlockHeader block{MERGED_BLOCK_MAGIC, static_cast<uint32_t>(timestamps.size()), sub_acquisition,
+                            timestamps.front(), timestamps.back()};
+    file.write(&block, sizeof(block));
+    file.write(timestamps.data(), timestamps.size() * sizeof(uint64_t));
+    channels.resize(padded_channel_bytes(channels.size()), 0);
+    file.write(channels.data(), channels.size());
+    total_records += timestamps.size();
+    ++total_blocks;
+    timestamps.clear();
+    channels.clear();
+}
+
+void MergedTimestampWriter::end_block(uint64_t next_sub_acquisition) {
+    flush_block();
+    sub_acquisition = next_sub_acquisition;
+}
+
+void MergedTimestampWriter::close() {
+    if (!file.is_open()) {
+        return;
+    }
+    flush_block();
+    MergedFileHeader header{MERGED_FILE_MAGIC, MERGED_FILE_VERSION, sizeof(MergedFileHeader),
+                            total_records, total_blocks, 0};
+    file.write_at(0, &header, sizeof(header));
+    file.close();
+}
+
+MergedTimestampReader::MergedTimestampReader(const std::string& path)
+    : file(path, std::ios::binary)
+{
+    if (!file) {
+        throw std::runtime_error("Cannot open merged timestamp file: " + path);
+    }
+    if (!file.read(reinterpret_cast<char*>(&file_header), sizeof(file_header)) ||
+        file_header.magic != MERGED_FILE_MAGIC) {
+        throw std::runtime_error("Not a merged timestamp file: " + path);
+    }
+    if (file_header.version > MERGED_FILE_VERSION) {
+        throw std::runtime_error("Unsupported merged timestamp file version " + std::to_string(file_header.version));
+    }
+    file.seekg(file_header.header_size);
+}
+
+bool MergedTimestampReader::read_block(std::vector<uint64_t>& timestamps, std::vector<uint8_t>& channels) {
+    MergedBlockHeader block;
+    if (!file.read(reinterpret_cast<char*>(&block), sizeof(block))) {
+        return false;
+    }
+    if (block.magic != MERGED_BLOCK_MAGIC) {
+        throw std::runtime_error("Corrupt merged timestamp file (bad block header)");
+    }
+    timestamps.resize(block.record_count);
+    channels.resize(padded_channel_bytes(block.record_count));
+    if (!file.read(reinterpret_cast<char*>(timestamps.data()), timestamps.size() * sizeof(uint64_t)) ||
+        !file.read(reinterpret_cast<char*>(channels.data()), channels.size())) {
+        throw std::runtime_error("Truncated merged timestamp file");
+    }
+    channels.resize(block.record_count);
+    return true;
+}
+
+uint64_t convert_merged_to_records(const std::string& merged_path, const std::string& bin_path) {
+    MergedTimestampReader reader(merged_path);
+    AsyncFileWriter bin_file(bin_path);
+    std::vector<uint64_t> timestamps;
+    std::vector<uint8_t> channels;
+    std::vector<char> records;
+    uint64_t total = 0;
+    while (reader.read_block(timestamps, channels)) {
+        // Interleave the columns into packed 12-byte records and write the block at once
+        records.resize(timestamps.size() * 12);
+        char* out = records.data();
+        for (size_t i = 0; i < timestamps.size(); ++i) {
+            int32_t channel = channels[i];
+            memcpy(out, &timestamps[i], sizeof(uint64_t));
+            memcpy(out + 8, &channel, sizeof(int32_t));
+            out += 12;
+        }
+        bin_file.write(records.data(), records.size());
+        total += timestamps.size();
+    }
+    bin_file.close();
+    return total;
+}
+
+TimestampRecordWriter::TimestampRecordWriter(const std::string& path)
+    : file(path), staged(0), total_records(0)
+{
+}
+
+TimestampRecordWriter::~TimestampRecordWriter() {
+    try {
+        close();
+    } catch (...) {
+        // Destructors must not throw; an explicit close() reports errors
+    }
+}
+
+void TimestampRecordWriter::flush_chunk() {
+    // Records are staged a chunk at a time so each write() is a single large copy
+    file.write(chunk, staged * 12);
+    staged = 0;
+}
+
+void TimestampRecordWriter::close() {
+    if (!file.is_open()) {
+        return;
+    }
+    flush_chunk();
+    file.close();
+}
+
+uint64_t write_timestamp_records(const std::string& bin_path, const std::vector<uint64_t>& timestamps,
+                                 const std::vector<int>& channels) {
+    if (timestamps.size() != channels.size()) {
+        throw std::invalid_argument("Timestamp and channel vectors differ in length");
+    }
+    TimestampRecordWriter writer(bin_path);
+    for (size_t i = 0; i < timestamps.size(); ++i) {
+        writer.append(timestamps[i], channels[i]);
+    }
+    writer.close();
+    return writer.record_count();
+}
+
+uint64_t write_merged_as_text(const std::string& merged_path, const std::string& txt_path) {
+    MergedTimestampReader reader(merged_path);
+    std::ofstream txt_file(txt_path);
+    if (!txt_file) {
+        throw std::runtime_error("Failed to open file for writing: " + txt_path);
+    }
+    std::vector<uint64_t> timestamps;
+    std::vector<uint8_t> channels;
+    uint64_t total = 0;
+    while (reader.read_block(timestamps, channels)) {
+        for (size_t i = 0; i < timestamps.size(); ++i) {
+            txt_file << static_cast<int>(channels[i]) << ";" << timestamps[i] << "\n";
+        }
+        total += timestamps.size();
+    }
+    return total;
+}
@@ -0,0 +1,147 @@
+#ifndef TIMESTAMP_FILE_HPP
+#define TIMESTAMP_FILE_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <fstream>
+#include "async_file_writer.hpp"
+
+// Binary columnar format written by TimestampsMergerThread (".tsm" files), little-endian:
+//
+//   MergedFileHeader
+//   repeated blocks:
+//     MergedBlockHeader
+//     uint64_t timestamps[record_count]      (picoseconds, time-ordered within the block)
+//     uint8_t  channels[record_count]        (zero-padded to a multiple of 8 bytes)
+//
+// record_count and block_count in the file header are patched when the writer is closed.
+// Blocks follow sub-acquisition boundaries; a large sub-acquisition may span several blocks.
+
+constexpr uint32_t MERGED_FILE_MAGIC = 0x424D5454;   // "TTMB"
+constexpr uint32_t MERGED_BLOCK_MAGIC = 0x4B4C4254;  // "TBLK"
+constexpr uint16_t MERGED_FILE_VERSION = 1;
+
+#pragma pack(push, 1)
+struct MergedFileHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t header_size;       // sizeof(MergedFileHeader), for forward compatibility
+    uint64_t record_count;      // total records in the file
+    uint64_t block_count;
+    uint64_t reserved;
+};
+
+struct MergedBlockHeader {
+    uint32_t magic;
+    uint32_t record_count;
+    uint64_t sub_acquisition;   // index of the sub-acquisition the block belongs to
+    uint64_t first_timestamp;
+    uint64_t last_timestamp;
+};
+#pragma pack(pop)
+
+static_assert(sizeof(MergedFileHeader) == 32, "MergedFileHeader layout");
+static_assert(sizeof(MergedBlockHeader) == 32, "MergedBlockHeader layout");
+
+// Writes merged (channel, timestamp) events as columnar blocks
+class MergedTimestampWriter {
+public:
+    explicit MergedTimestampWriter(const std::string& path, size_t block_capacity = 1 << 16);
+    ~MergedTimestampWriter();
+
+    // Append one event; the current block is written out when it reaches capacity
+    void append(int channel, uint64_t timestamp) {
+        if (timestamps.size() == block_capacity) {
+            flush_block();
+        }
+        timestamps.push_back(timestamp);
+        channels.push_back(static_cast<uint8_t>(channel));
+    }
+
+    // End the current block (called at sub-acquisition boundaries); `next_sub_acquisition`
+    // is recorded in the headers of the blocks that follow
+    void end_block(uint64_t next_sub_acquisition);
+
+    // Flush the last block and patch the file header; further appends are an error
+    void close();
+
+    uint64_t record_count() const { return total_records; }
+    bool is_open() const { return file.is_open(); }
+    // Bytes written, achieved MB/s and I/O backend of the underlying file
+    std::string io_summary() const { return file.summary(); }
+
+private:
+    void flush_block();
+
+    AsyncFileWriter file;
+    size_t block_capacity;
+    std::vector<uint64_t> timestamps;
+    std::vector<uint8_t> channels;
+    uint64_t sub_acquisition;
+    uint64_t total_records;
+    uint64_t total_blocks;
+};
+
+// Sequential reader for .tsm files
+class MergedTimestampReader {
+public:
+    explicit MergedTimestampReader(const std::string& path);
+
+    // Read the next block into `timestamps`/`channels`; returns false at end of file
+    bool read_block(std::vector<uint64_t>& timestamps, std::vector<uint8_t>& channels);
+
+    const MergedFileHeader& header() const { return file_header; }
+
+private:
+    std::ifstream file;
+    MergedFileHeader file_header;
+};
+
+// Convert a .tsm file to the 12-byte record .bin layout (uint64 timestamp + int32 channel) used for
+// transfers and synchronization. Returns the number of records written.
+uint64_t convert_merged_to_records(const std::string& merged_path, const std::string& bin_path);
+
+// Streams events into a 12-byte record .bin file (uint64 timestamp + int32 channel)
+class TimestampRecordWriter {
+public:
+    explicit TimestampRecordWriter(const std::string& path);
+    ~TimestampRecordWriter();
+
+    void append(uint64_t timestamp, int channel) {
+        if (staged == RECORDS_PER_CHUNK) {
+            flush_chunk();
+        }
+        int32_t ch = channel;
+        char* out = chunk + staged * 12;
+        memcpy(out, &timestamp, sizeof(uint64_t));
+        memcpy(out + 8, &ch, sizeof(int32_t));
+        ++staged;
+        ++total_records;
+    }
+
+    // Write the remaining records and close the file
+    void close();
+
+    uint64_t record_count() const { return total_records; }
+
+private:
+    static constexpr size_t RECORDS_PER_CHUNK = 4096;
+
+    void flush_chunk();
+
+    AsyncFileWriter file;
+    char chunk[RECORDS_PER_CHUNK * 12];
+    size_t staged;
+    uint64_t total_records;
+};
+
+// Write parallel timestamp/channel vectors as 12-byte records. Returns the number of records written.
+uint64_t write_timestamp_records(const std::string& bin_path, const std::vector<uint64_t>& timestamps,
+                                 const std::vector<int>& channels);
+
+// Optional post-process: write a .tsm file as "channel;timestamp" text lines
+uint64_t write_merged_as_text(const std::string& merged_path, const std::string& txt_path);
+
+#endif // TIMESTAMP_FILE_HPP
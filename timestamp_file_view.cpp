@@ -0,0 +1,115 @@
+#include "timestamp_file_view.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+TimestampFileView::TimestampFileView(const std::string& path, Layout layout)
+    : mapping(nullptr), mapping_size(0), records(nullptr), stride(0), count(0), file_layout(layout)
+{
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        throw std::runtime_error("Cannot open timestamp file: " + path + ": " + strerror(errno));
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        int err = errno;
+        ::close(fd);
+        throw std::runtime_error("Cannot stat timestamp file: " + path + ": " + strerror(err));
+    }
+    mapping_size = static_cast<size_t>(st.st_size);
+    if (mapping_size > 0) {
+        void* address = mmap(nullptr, mapping_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (address == MAP_FAILED) {
+            int err = errno;
+            ::close(fd);
+            throw std::runtime_error("Cannot map timestamp file: " + path + ": " + strerror(err));
+        }
+        mapping = static_cast<const char*>(address);
+    }
+    // The mapping stays valid after the descriptor is closed
+    ::close(fd);
+
+    if (file_layout == Layout::Records) {
+        stride = sizeof(uint64_t) + sizeof(int32_t);
+        records = mapping;
+        count = mapping_size / stride;
+    } else {
+        stride = sizeof(uint64_t);
+        if (mapping_size >= sizeof(uint64_t)) {
+            uint64_t declared;
+            memcpy(&declared, mapping, sizeof(declared));
+            records = mapping + sizeof(uint64_t);
+            count = static_cast<size_t>(std::min<uint64_t>(declared, (mapping_size - sizeof(uint64_t)) / stride));
+        }
+    }
+    advise_sequential();
+}
+
+TimestampFileView::~TimestampFileView() {
+    release();
+}
+
+TimestampFileView::TimestampFileView(TimestampFileView&& other) noexcept
+    : mapping(other.mapping), mapping_size(other.mapping_size), records(other.records),
+      stride(other.stride), count(other.count), file_layout(other.file_layout)
+{
+    other.mapping = nullptr;
+    other.mapping_size = 0;
+    other.records = nullptr;
+    other.count = 0;
+}
+
+TimestampFileView& TimestampFileView::operator=(TimestampFileView&& other) noexcept {
+    if (this != &other) {
+        release();
+        mapping = other.mapping;
+        mapping_size = other.mapping_size;
+        records = other.records;
+        stride = other.stride;
+        count = other.count;
+        file_layout = other.file_layout;
+        other.mapping = nullptr;
+        other.mapping_size = 0;
+        other.records = nullptr;
+        other.count = 0;
+    }
+    return *this;
+}
+
+void TimestampFileView::release() {
+    if (mapping) {
+        munmap(const_cast<char*>(mapping), mapping_size);
+        mapping = nullptr;
+    }
+}
+
+void TimestampFileView::advise_random() const {
+    if (mapping) {
+        madvise(const_cast<char*>(mapping), mapping_size, MADV_RANDOM);
+    }
+}
+
+void TimestampFileView::advise_sequential() const {
+    if (mapping) {
+        madvise(const_cast<char*>(mapping), mapping_size, MADV_SEQUENTIAL);
+    }
+}
+
+void TimestampFileView::release_range(size_t first, size_t last) const {
+    if (!mapping || first >= last) {
+        return;
+    }
+    // Only whole pages inside the byte range can be dropped
+    const uintptr_t page = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+    uintptr_t begin = reinterpret_cast<uintptr_t>(records + first * stride);
+    uintptr_t end = reinterpret_cast<uintptr_t>(records + std::min(last, count) * stride);
+    begin = (begin + page - 1) & ~(page - 1);
+    end &= ~(page - 1);
+    if (begin < end) {
+        madvise(reinterpret_cast<void*>(begin), end - begin, MADV_DONTNEED);
+    }
+}
@@ -0,0 +1,114 @@
+#ifndef TIMESTAMP_FILE_VIEW_HPP
+#define TIMESTAMP_FILE_VIEW_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <string>
+
+// Read-only, memory-mapped view of a binary timestamp file. Records are decoded on access
+// straight from the page cache, so a pass over a multi-GB capture needs no heap copies.
+//
+// Supported layouts:
+//   Records       packed 12-byte records: uint64_t timestamp + int32_t channel (.bin files written
+//                 by the controllers, see write_timestamp_records())
+//   CountPrefixed uint64_t count followed by `count` uint64_t timestamps (no channel; channel() is -1)
+// A trailing partial record is ignored.
+class TimestampFileView {
+public:
+    enum class Layout { Records, CountPrefixed };
+
+    struct Record {
+        uint64_t timestamp;
+        int channel;
+    };
+
+    // Random-access iterator yielding Record values
+    class iterator {
+    public:
+        using iterator_category = std::random_access_iterator_tag;
+        using value_type = Record;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = Record;
+
+        iterator() : view(nullptr), index(0) {}
+        iterator(const TimestampFileView* view_, size_t index_) : view(view_), index(index_) {}
+
+        Record operator*() const { return (*view)[index]; }
+        Record operator[](difference_type n) const { return (*view)[index + n]; }
+        iterator& operator++() { ++index; return *this; }
+        iterator operator++(int) { iterator old = *this; ++index; return old; }
+        iterator& operator--() { --index; return *this; }
+        iterator operator--(int) { iterator old = *this; --index; return old; }
+        iterator& operator+=(difference_type n) { index += n; return *this; }
+        iterator& operator-=(difference_type n) { index -= n; return *this; }
+        iterator operator+(difference_type n) const { return iterator(view, index + n); }
+        iterator operator-(difference_type n) const { return iterator(view, index - n); }
+        difference_type operator-(const iterator& other) const {
+            return static_cast<difference_type>(index) - static_cast<difference_type>(other.index);
+        }
+        bool operator==(const iterator& other) const { return index == other.index; }
+        bool operator!=(const iterator& other) const { return index != other.index; }
+        bool operator<(const iterator& other) const { return index < other.index; }
+        bool operator>(const iterator& other) const { return index > other.index; }
+        bool operator<=(const iterator& other) const { return index <= other.index; }
+        bool operator>=(const iterator& other) const { return index >= other.index; }
+
+    private:
+        const TimestampFileView* view;
+        size_t index;
+    };
+
+    // Map `path` read-only; throws std::runtime_error if the file cannot be opened or mapped
+    explicit TimestampFileView(const std::string& path, Layout layout = Layout::Records);
+    ~TimestampFileView();
+
+    TimestampFileView(TimestampFileView&& other) noexcept;
+    TimestampFileView& operator=(TimestampFileView&& other) noexcept;
+    TimestampFileView(const TimestampFileView&) = delete;
+    TimestampFileView& operator=(const TimestampFileView&) = delete;
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    Layout layout() const { return file_layout; }
+
+    // Records may be unaligned in the mapping (12-byte stride), so fields are read with memcpy
+    uint64_t timestamp(size_t i) const {
+        uint64_t value;
+        memcpy(&value, records + i * stride, sizeof(value));
+        return value;
+    }
+    int channel(size_t i) const {
+        if (file_layout != Layout::Records) {
+            return -1;
+        }
+        int32_t value;
+        memcpy(&value, records + i * stride + sizeof(uint64_t), sizeof(value));
+        return value;
+    }
+    Record operator[](size_t i) const { return Record{timestamp(i), channel(i)}; }
+
+    iterator begin() const { return iterator(this, 0); }
+    iterator end() const { return iterator(this, count); }
+
+    // Access-pattern hint for the kernel (the view starts out as MADV_SEQUENTIAL)
+    void advise_random() const;
+    void advise_sequential() const;
+    // Drop the resident pages that hold only records [first, last) (they are re-read from the file
+    // if accessed again); keeps memory bounded during a single streaming pass over a large capture
+    void release_range(size_t first, size_t last) const;
+
+private:
+    void release();
+
+    const char* mapping;      // start of the mapping (nullptr for an empty file)
+    size_t mapping_size;
+    const char* records;      // first record
+    size_t stride;            // bytes per record
+    size_t count;             // number of complete records
+    Layout file_layout;
+};
+
+#endif // TIMESTAMP_FILE_VIEW_HPP
@@ -0,0 +1,95 @@
+#ifndef TIMESTAMP_MERGE_HPP
+#define TIMESTAMP_MERGE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Read-only view of a contiguous run of timestamps (stand-in for std::span<const uint64_t> under C++17)
+struct TimestampSpan {
+    const uint64_t* ptr = nullptr;
+    size_t count = 0;
+
+    const uint64_t* begin() const { return ptr; }
+    const uint64_t* end() const { return ptr + count; }
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    uint64_t operator[](size_t i) const { return ptr[i]; }
+};
+
+// One time-ordered run of timestamps from a single channel; `offset` is added to every timestamp
+// (the sub-acquisition offset, which is the same for all runs of a batch and so preserves ordering)
+struct TimestampRun {
+    int channel;
+    TimestampSpan timestamps;
+    uint64_t offset;
+};
+
+// Merge k individually time-ordered runs into a single time-ordered stream in O(N log k),
+// calling emit(channel, timestamp) for each event as soon as it is known to be next.
+// A binary min-heap holds the current head of every non-empty run; equal timestamps are
+// emitted in run order so the output is deterministic.
+template <typename Emit>
+void kway_merge(const std::vector<TimestampRun>& runs, Emit&& emit) {
+    struct Cursor {
+        uint64_t ts;      // current head timestamp (offset applied)
+        size_t run;       // index into runs
+        size_t pos;       // index of the head within the run
+    };
+    auto less = [](const Cursor& a, const Cursor& b) {
+        return a.ts < b.ts || (a.ts == b.ts && a.run < b.run);
+    };
+
+    // Reused across calls on the same thread, so steady-state merging does not allocate
+    thread_local std::vector<Cursor> heap;
+    heap.clear();
+    for (size_t r = 0; r < runs.size(); ++r) {
+        if (!runs[r].timestamps.empty()) {
+            heap.push_back(Cursor{runs[r].timestamps[0] + runs[r].offset, r, 0});
+        }
+    }
+
+    // Single run: nothing to interleave
+    if (heap.size() == 1) {
+        const TimestampRun& run = runs[heap[0].run];
+        for (uint64_t ts : run.timestamps) {
+            emit(run.channel, ts + run.offset);
+        }
+        return;
+    }
+
+    auto sift_down = [&](size_t i) {
+        const size_t n = heap.size();
+        Cursor item = heap[i];
+        for (;;) {
+            size_t child = 2 * i + 1;
+            if (child >= n) break;
+            if (child + 1 < n && less(heap[child + 1], heap[child])) ++child;
+            if (!less(heap[child], item)) break;
+            heap[i] = heap[child];
+            i = child;
+        }
+        heap[i] = item;
+    };
+    for (size_t i = heap.size() / 2; i-- > 0;) {
+        sift_down(i);
+    }
+
+    while (!heap.empty()) {
+        Cursor& top = heap[0];
+        const TimestampRun& run = runs[top.run];
+        emit(run.channel, top.ts);
+        if (++top.pos < run.timestamps.size()) {
+            // Replace the head with the run's next timestamp and restore heap order
+            top.ts = run.timestamps[top.pos] + run.offset;
+        } else {
+            // Run exhausted: move the last cursor to the top
+            heap[0] = heap.back();
+            heap.pop_back();
+            if (heap.empty()) break;
+        }
+        sift_down(0);
+    }
+}
+
+#endif // TIMESTAMP_MERGE_HPP
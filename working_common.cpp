@@ -1,4 +1,5 @@
-#include "common.hpp"
+#include "working_common.hpp"
+#include <sstream>
 #include <cstdlib>  // for system() or _spawnl on Windows
 using json = nlohmann::json;
 
@@ -44,6 +45,49 @@ std::string zmq_exec(zmq::socket_t& socket, const std::string& cmd) {
     return ans;
 }
 
+ScpiBatch::ScpiBatch(zmq::socket_t& socket_, size_t max_line_)
+    : socket(socket_), max_line(max_line_), executed(0), requests(0), elapsed(0.0)
+{
+}
+
+ScpiBatch& ScpiBatch::add(const std::string& command) {
+    commands.push_back(command);
+    return *this;
+}
+
+std::vector<std::string> ScpiBatch::execute() {
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::string> replies;
+    std::string line;
+    for (const std::string& command : commands) {
+        if (!line.empty() && line.size() + 2 + command.size() > max_line) {
+            replies.push_back(zmq_exec(socket, line));
+            line.clear();
+        }
+        line += line.empty() ? command : ";:" + command;
+    }
+    if (!line.empty()) {
+        replies.push_back(zmq_exec(socket, line));
+    }
+    executed = commands.size();
+    requests = replies.size();
+    elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    commands.clear();
+    return replies;
+}
+
+std::string ScpiBatch::summary() const {
+    std::ostringstream oss;
+    oss.setf(std::ios::fixed);
+    oss.precision(2);
+    oss << executed << " commands in " << requests << (requests == 1 ? " round trip, " : " round trips, ")
+        << elapsed * 1e3 << " ms";
+    if (executed > 0) {
+        oss << " (" << elapsed * 1e3 / executed << " ms/command)";
+    }
+    return oss.str();
+}
+
 json dlt_exec(zmq::socket_t& dlt_socket, const std::string& cmd) {
     std::string ans = zmq_exec(dlt_socket, cmd);
     json result;
@@ -323,7 +367,9 @@ bool close_timestamps_acquisition(zmq::socket_t& tc_socket, zmq::socket_t& dlt_s
 }
 
 void configure_timestamps_references(zmq::socket_t& tc_socket, const std::vector<int>& channels) {
+    ScpiBatch batch(tc_socket);
     for (int ch : channels) {
-        zmq_exec(tc_socket, "RAW" + std::to_string(ch) + ":REF:LINK NONE");
+        batch.add("RAW" + std::to_string(ch) + ":REF:LINK NONE");
     }
+    batch.execute();
 }
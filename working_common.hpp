@@ -10,6 +10,7 @@
 #include <thread>
 #include <chrono>
 #include <iostream>
+#include <vector>
 
 // Default ports for Time Controller (SCPI) and DataLinkTarget (DLT) services
 constexpr int DLT_PORT = 6060;
@@ -31,6 +32,37 @@ zmq::socket_t connect_zmq(const std::string& address, int port);
 // Send a SCPI command string over ZMQ and return the response string
 std::string zmq_exec(zmq::socket_t& socket, const std::string& cmd);
 
+// Queue of SCPI commands sent to the Time Controller in as few round trips as possible.
+// Commands are joined into one line with ";:" (the Time Controller executes a ';'-separated line
+// in order and answers once; the leading ':' makes each command absolute again), so configuring N
+// settings costs one REQ/REP round trip instead of N. A line is split into several requests only
+// if it would exceed `max_line` characters.
+class ScpiBatch {
+public:
+    explicit ScpiBatch(zmq::socket_t& socket, size_t max_line = 1024);
+
+    ScpiBatch& add(const std::string& command);
+    size_t size() const { return commands.size(); }
+
+    // Send the queued commands and clear the queue; returns the reply of each request. Throws
+    // std::runtime_error if a reply does not arrive.
+    std::vector<std::string> execute();
+
+    // Round trips and time taken by the last execute()
+    size_t round_trips() const { return requests; }
+    double seconds() const { return elapsed; }
+    // e.g. "12 commands in 1 round trip, 0.8 ms (0.07 ms/command)"
+    std::string summary() const;
+
+private:
+    zmq::socket_t& socket;
+    size_t max_line;
+    std::vector<std::string> commands;
+    size_t executed;
+    size_t requests;
+    double elapsed;
+};
+
 // Send a DLT command string and parse the JSON response (throws DataLinkTargetError on error)
 nlohmann::json dlt_exec(zmq::socket_t& dlt_socket, const std::string& cmd);
 